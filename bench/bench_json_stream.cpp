@@ -0,0 +1,141 @@
+// Compares the streaming decoders in json_stream.hpp with the way responses
+// were read before: parse a JSON document, then append every entry to a
+// list. Counts allocations as well as time.
+//
+//   BenchJSONStream [recording] [rounds]
+//
+// If a recording made with --record is given, the bodies of the calls to the
+// jobs API and to WhatsOnChain for unspent outputs are taken from it.
+// Otherwise a jobs response with 300 jobs and an unspent response with 300
+// outputs are made up.
+
+#include <json_stream.hpp>
+#include <traffic.hpp>
+#include <gigamonkey/boost/boost.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> Allocations {0};
+    std::atomic<uint64_t> Allocated {0};
+}
+
+void *operator new (std::size_t size) {
+    Allocations++;
+    Allocated += size;
+    if (void *p = std::malloc (size)) return p;
+    throw std::bad_alloc {};
+}
+
+void operator delete (void *p) noexcept {
+    std::free (p);
+}
+
+void operator delete (void *p, std::size_t) noexcept {
+    std::free (p);
+}
+
+namespace {
+    using namespace BoostPOW;
+
+    // as get_jobs_query::operator () used to do it.
+    list<Bitcoin::prevout> document_jobs (const string &body) {
+        list<Bitcoin::prevout> jobs;
+        for (const JSON &job : JSON::parse (body).at ("jobs")) {
+            digest256 txid {string {"0x"} + string (job.at ("txid"))};
+            maybe<bytes> script = encoding::hex::read (string (job.at ("script")));
+            if (!txid.valid () || !bool (script) || !Boost::output_script {*script}.valid ()) throw std::logic_error {"invalid job"};
+            jobs = jobs << Bitcoin::prevout {
+                Bitcoin::outpoint {txid, uint32 (job.at ("vout"))},
+                Bitcoin::output {Bitcoin::satoshi {int64 (job.at ("value"))}, *script}};
+        }
+        return jobs;
+    }
+
+    // as whatsonchain::scripts::get_unspent used to do it.
+    list<UTXO> document_unspent (const string &body) {
+        list<UTXO> utxos;
+        for (const JSON &item : JSON::parse (body)) {
+            UTXO u (item);
+            if (!u.valid ()) throw std::logic_error {"invalid UTXO"};
+            utxos <<= u;
+        }
+        return utxos;
+    }
+
+    string made_up_jobs (uint32 count) {
+        JSON jobs = JSON::array ();
+        for (uint32 i = 0; i < count; i++) {
+            bytes script = Boost::output_script::bounty (
+                int32_little {0},
+                digest256 {"0x00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"},
+                work::compact {work::difficulty {.001 * (i + 1)}},
+                bytes {}, uint32_little {i}, bytes {}, true).write ();
+            std::stringstream txid;
+            txid << std::hex << std::setw (64) << std::setfill ('0') << i + 1;
+            jobs.push_back (JSON {
+                {"txid", txid.str ()}, {"vout", i % 3}, {"value", 1000 + i},
+                {"script", encoding::hex::write (script)},
+                {"content", "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"},
+                {"difficulty", .001 * (i + 1)}, {"tags", JSON::array ()}});
+        }
+        return JSON {{"jobs", jobs}}.dump ();
+    }
+
+    string made_up_unspent (uint32 count) {
+        JSON utxos = JSON::array ();
+        for (uint32 i = 0; i < count; i++) {
+            std::stringstream txid;
+            txid << std::hex << std::setw (64) << std::setfill ('0') << i + 1;
+            utxos.push_back (JSON {{"height", 800000 + i}, {"tx_pos", i % 3}, {"tx_hash", txid.str ()}, {"value", 1000 + i}});
+        }
+        return utxos.dump ();
+    }
+
+    template <typename f> void measure (const std::string &name, const std::vector<string> &bodies, uint32 rounds, f read) {
+        size_t entries = 0;
+        uint64_t allocations = Allocations;
+        uint64_t allocated = Allocated;
+        auto begin = std::chrono::steady_clock::now ();
+
+        for (uint32 r = 0; r < rounds; r++) for (const string &body : bodies) entries += read (body);
+
+        double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+        double calls = double (rounds) * bodies.size ();
+
+        std::cout << std::left << std::setw (18) << name << std::right << std::fixed <<
+            std::setw (12) << std::setprecision (1) << seconds * 1e6 / calls << " us/call" <<
+            std::setw (12) << std::setprecision (0) << (Allocations - allocations) / calls << " allocations/call" <<
+            std::setw (12) << (Allocated - allocated) / calls / 1024 << " KiB/call" <<
+            std::setw (8) << entries / calls << " entries" << std::endl;
+    }
+}
+
+int main (int arg_count, char **arg_values) {
+    std::vector<string> jobs {};
+    std::vector<string> unspent {};
+
+    if (arg_count > 1) for (const auto &x : traffic::load (arg_values[1])) {
+        if (x.Kind != traffic::exchange::http || x.Status != 200) continue;
+        if (x.URL.find ("/api/v1/boost/jobs") != string::npos) jobs.push_back (x.Body);
+        else if (x.URL.find ("/script/") != string::npos && x.URL.ends_with ("/unspent")) unspent.push_back (x.Body);
+    }
+
+    uint32 rounds = arg_count > 2 ? std::atoi (arg_values[2]) : 20;
+
+    if (jobs.empty ()) jobs.push_back (made_up_jobs (300));
+    if (unspent.empty ()) unspent.push_back (made_up_unspent (300));
+
+    std::cout << "jobs responses: " << jobs.size () << "; unspent responses: " << unspent.size () << std::endl;
+
+    measure ("jobs document", jobs, rounds, [] (const string &b) { return data::size (document_jobs (b)); });
+    measure ("jobs stream", jobs, rounds, [] (const string &b) { return json_stream::read_jobs (b).size (); });
+    measure ("unspent document", unspent, rounds, [] (const string &b) { return data::size (document_unspent (b)); });
+    measure ("unspent stream", unspent, rounds, [] (const string &b) { return json_stream::read_unspent (b).size (); });
+
+    return 0;
+}
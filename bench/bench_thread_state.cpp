@@ -0,0 +1,86 @@
+// Compares per-thread counters packed next to each other with counters that
+// have cache lines of their own, as in manager::redeemer and stratum_worker.
+// Each thread counts as fast as it can and reads its job epoch, while a
+// manager thread reads every counter and posts new epochs, as when measuring
+// the hashrate and handing out jobs.
+
+#include <cache_line.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using BoostPOW::cache_line;
+
+    struct packed {
+        std::atomic<uint64_t> Hashes {0};
+        std::atomic<uint64_t> Epoch {0};
+    };
+
+    struct padded {
+        alignas (cache_line) std::atomic<uint64_t> Hashes {0};
+        alignas (cache_line) std::atomic<uint64_t> Epoch {0};
+    };
+
+    // counts per second over all threads.
+    template <typename state>
+    double run (uint32_t threads, double seconds) {
+        std::unique_ptr<state[]> states {new state[threads]};
+        std::atomic<bool> stop {false};
+
+        std::vector<std::thread> workers {};
+        for (uint32_t i = 0; i < threads; i++) workers.emplace_back ([&stop, &s = states[i]] () {
+            uint64_t epoch = s.Epoch.load (std::memory_order_relaxed);
+            while (!stop.load (std::memory_order_relaxed)) {
+                s.Hashes.fetch_add (1, std::memory_order_relaxed);
+                if (uint64_t e = s.Epoch.load (std::memory_order_relaxed); e != epoch) epoch = e;
+            }
+        });
+
+        std::thread manager {[&] () {
+            while (!stop.load (std::memory_order_relaxed)) {
+                uint64_t total = 0;
+                for (uint32_t i = 0; i < threads; i++) total += states[i].Hashes.load (std::memory_order_relaxed);
+                for (uint32_t i = 0; i < threads; i++) states[i].Epoch.fetch_add (1, std::memory_order_relaxed);
+                std::this_thread::sleep_for (std::chrono::microseconds (100));
+            }
+        }};
+
+        auto begin = std::chrono::steady_clock::now ();
+        std::this_thread::sleep_for (std::chrono::duration<double> (seconds));
+        stop = true;
+
+        for (auto &w : workers) w.join ();
+        manager.join ();
+
+        double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < threads; i++) total += states[i].Hashes.load ();
+        return total / elapsed;
+    }
+
+}
+
+int main (int arg_count, char **arg_values) {
+    double seconds = arg_count > 1 ? std::stod (arg_values[1]) : 1;
+    uint32_t cores = std::max (std::thread::hardware_concurrency (), 1u);
+
+    std::cout << "threads      packed/s      padded/s   speedup" << std::endl;
+    for (uint32_t n = 1; n <= cores; n = n < cores && n * 2 > cores ? cores : n * 2) {
+        double a = run<packed> (n, seconds);
+        double b = run<padded> (n, seconds);
+        std::cout << std::setw (7) << n << std::setw (14) << std::scientific << std::setprecision (3) << a
+            << std::setw (14) << b << std::setw (10) << std::fixed << std::setprecision (2) << b / a << std::endl;
+        if (n == cores) break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef BOOSTMINER_AFFINITY
+#define BOOSTMINER_AFFINITY
+
+#include <gigamonkey/types.hpp>
+#include <vector>
+
+namespace BoostPOW {
+    using namespace Gigamonkey;
+
+    // Where to run mining threads and the IO thread. With pinning turned on,
+    // mining threads get one physical core each before any SMT siblings are
+    // used, and the IO thread gets a core of its own if there is one left.
+    //
+    // Memory that a thread touches first is put on that thread's NUMA node
+    // by Linux, so per-thread state should be created after the thread has
+    // been pinned, by the thread itself.
+    namespace affinity {
+
+        enum class mode {
+            off,
+            // at most one mining thread per physical core.
+            cores,
+            // SMT siblings are used once every physical core has a thread.
+            smt
+        };
+
+        maybe<mode> read_mode (const string &);
+
+        struct cpu {
+            uint32 Logical;
+            int32 Package;
+            int32 Core;
+            int32 Node;
+        };
+
+        // from /sys/devices/system/cpu. Empty if it can't be read.
+        std::vector<cpu> topology ();
+
+        // -1 means not pinned.
+        struct plan {
+            std::vector<int32> Mining;
+            int32 IO;
+        };
+
+        plan place (const std::vector<cpu> &, uint32 threads, mode);
+
+        // pin the calling thread to a logical cpu. Returns false if that isn't possible here.
+        bool pin (int32 logical);
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef BOOSTMINER_AGGREGATOR
+#define BOOSTMINER_AGGREGATOR
+
+#include <network.hpp>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <mutex>
+
+namespace BoostPOW {
+
+    // Solved puzzles are held for a short time so that several of them can
+    // be redeemed in one transaction with a single output, which saves the
+    // fee for the rest of the transaction on all but one of them.
+    struct aggregator {
+        struct entry {
+            Boost::puzzle Puzzle;
+            work::solution Solution;
+        };
+
+        // one transaction that redeems every puzzle and pays everything minus the fee to one script.
+        static Bitcoin::transaction redeem (const std::vector<entry> &, const bytes &pay_script, double fee_rate);
+
+        // bytes of a transaction other than its inputs, which are saved on every puzzle after the first.
+        static uint64 overhead ();
+
+        // a transaction is made once the oldest entry has waited window_seconds or
+        // once max_entries entries are waiting, whichever comes first.
+        aggregator (
+            double window_seconds,
+            uint32 max_entries,
+            fees &,
+            // a new script to pay to.
+            function<bytes ()> pay_script,
+            // throws if the transaction is not accepted.
+            function<void (const bytes &)> broadcast);
+
+        // anything still waiting is redeemed before this returns.
+        ~aggregator ();
+
+        void add (entry);
+
+    private:
+        std::chrono::duration<double> Window;
+        uint32 MaxEntries;
+        fees &Fees;
+        function<bytes ()> PayScript;
+        function<void (const bytes &)> Broadcast;
+
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        std::vector<entry> Waiting;
+        std::chrono::steady_clock::time_point Opened;
+        bool Stop;
+
+        std::thread Thread;
+
+        void run ();
+
+        // redeem these entries together, or one by one if that doesn't work.
+        void redeem (std::vector<entry>);
+    };
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BOOSTMINER_AUTOTUNE
+#define BOOSTMINER_AUTOTUNE
+
+#include <miner.hpp>
+#include <filesystem>
+
+namespace BoostPOW {
+
+    // Measure how fast this machine hashes with different numbers of threads
+    // and remember the best configuration for each CPU model, so that later
+    // starts can skip calibration.
+    namespace autotune {
+
+        struct configuration {
+            // the hash function used. There is only one so far.
+            string Backend {"cpu"};
+            uint32 Threads {1};
+
+            // total hashes/second of all threads together, as measured.
+            double Hashrate {0};
+
+            explicit operator JSON () const;
+            static maybe<configuration> read (const JSON &);
+        };
+
+        // the model name from /proc/cpuinfo and the number of logical cores.
+        string cpu_model ();
+
+        // $XDG_CACHE_HOME/boostminer/tune.json or ~/.cache/boostminer/tune.json
+        std::filesystem::path default_cache ();
+
+        // hashes/second with the given number of threads, measured over about the given time.
+        double measure (uint32 threads, double seconds);
+
+        // try thread counts up to the number of logical cores, SMT siblings included,
+        // or as many as the cgroup allows if that is fewer. See governor.hpp.
+        configuration calibrate (double seconds_per_trial);
+
+        maybe<configuration> cached (const std::filesystem::path &, const string &cpu_model);
+        void save (const std::filesystem::path &, const string &cpu_model, const configuration &);
+
+        // use the cached configuration for this CPU if there is one. Otherwise calibrate and save.
+        configuration tuned (const std::filesystem::path &, double seconds_per_trial = 3);
+
+    }
+
+}
+
+#endif
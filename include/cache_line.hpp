@@ -0,0 +1,16 @@
+#ifndef BOOSTMINER_CACHE_LINE
+#define BOOSTMINER_CACHE_LINE
+
+#include <cstddef>
+
+namespace BoostPOW {
+
+    // Values written by one thread and read by another are kept on cache lines
+    // of their own, so that a write doesn't take the line away from whoever is
+    // using the values next to it. std::hardware_destructive_interference_size
+    // would be the right thing, but not every compiler we use has it.
+    constexpr std::size_t cache_line = 64;
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef BOOSTMINER_CONNECTION_POOL
+#define BOOSTMINER_CONNECTION_POOL
+
+#include <data/net/HTTP_client.hpp>
+#include <gigamonkey/types.hpp>
+#include <traffic.hpp>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+namespace BoostPOW {
+    using namespace Gigamonkey;
+
+    // Connections to API hosts are kept open between requests with HTTP/1.1
+    // keep-alive. When a new connection has to be made, the TLS session of
+    // the last one is resumed, which saves a round trip and the key exchange.
+    // Responses are requested with gzip and decoded here. Every host has a
+    // limit on how many requests may be made to it at once, and optionally
+    // on how often. A request fails if any step of it takes too long, so that
+    // a host that stops answering does not keep its connections forever.
+    struct connection_pool {
+
+        struct statistics {
+            uint64 Requests {0};
+
+            // requests that used a connection that was already open, so no handshake was needed.
+            uint64 Reused {0};
+
+            // connections made, and of those, how many resumed a TLS session.
+            uint64 Connections {0};
+            uint64 Resumed {0};
+
+            // size of gzipped bodies as received and after they were decoded.
+            uint64 Compressed {0};
+            uint64 Decompressed {0};
+
+            explicit operator JSON () const;
+        };
+
+        explicit connection_pool (ptr<net::HTTP::SSL>, uint32 max_connections_per_host = 4);
+        ~connection_pool ();
+
+        // no more than this many requests to the host in this many seconds.
+        void limit (const string &host, uint32 requests, uint32 seconds);
+
+        net::HTTP::response operator () (const net::HTTP::request &);
+
+        // write every request and response to a recording, or answer every
+        // request from one instead of the network. Set before any request is made.
+        void record (ptr<traffic::recorder> r) {
+            Recorder = r;
+        }
+
+        void replay (ptr<traffic::player> p) {
+            Player = p;
+        }
+
+        statistics stats () const;
+
+        struct endpoint {
+            bool TLS;
+            string Host;
+            uint16 Port;
+            // path and query.
+            string Target;
+        };
+
+        static maybe<endpoint> read_url (const string &);
+
+        static maybe<string> gunzip (const string &);
+
+    private:
+        struct connection;
+        struct host;
+
+        ptr<net::HTTP::SSL> SSL;
+        uint32 MaxConnections;
+
+        std::mutex Mutex;
+        std::map<string, std::unique_ptr<host>> Hosts;
+
+        std::atomic<uint64> Requests;
+        std::atomic<uint64> Reused;
+        std::atomic<uint64> Connections;
+        std::atomic<uint64> Resumed;
+        std::atomic<uint64> Compressed;
+        std::atomic<uint64> Decompressed;
+
+        ptr<traffic::recorder> Recorder;
+        ptr<traffic::player> Player;
+
+        net::HTTP::response send (const net::HTTP::request &);
+
+        host &get (const string &name);
+        std::unique_ptr<connection> connect (host &, const endpoint &);
+    };
+
+    // an API client whose requests go through a connection pool. Without a
+    // pool, it is an ordinary client that makes a new connection every time.
+    struct pooled_client : net::HTTP::client_blocking {
+        ptr<connection_pool> Pool;
+
+        pooled_client (ptr<connection_pool> pool, ptr<net::HTTP::SSL> ssl, net::HTTP::REST rest, uint32 requests, uint32 seconds) :
+            net::HTTP::client_blocking {ssl, rest, tools::rate_limiter {requests, seconds}}, Pool {pool} {
+            Pool->limit (rest.Host, requests, seconds);
+        }
+
+        pooled_client (net::HTTP::REST rest, uint32 requests, uint32 seconds) :
+            net::HTTP::client_blocking {rest, tools::rate_limiter {requests, seconds}}, Pool {} {}
+
+        net::HTTP::response operator () (const net::HTTP::request &r) {
+            return Pool == nullptr ? net::HTTP::client_blocking::operator () (r) : (*Pool) (r);
+        }
+    };
+
+}
+
+#endif
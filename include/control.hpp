@@ -0,0 +1,57 @@
+#ifndef BOOSTMINER_CONTROL
+#define BOOSTMINER_CONTROL
+
+#include <miner.hpp>
+#include <deque>
+
+namespace BoostPOW {
+
+    // a running miner that can be changed without restarting it.
+    struct controllable {
+        virtual JSON status () = 0;
+
+        // start or stop threads until there are this many.
+        virtual void set_threads (uint32) = 0;
+
+        virtual void pause (bool) = 0;
+
+        // filters that are not given stay as they are.
+        virtual void set_filters (maybe<double> minimum_profitability, maybe<double> maximum_difficulty) = 0;
+
+        virtual ~controllable () {}
+    };
+
+    // Commands are JSON objects such as
+    //   {"command": "threads", "threads": 4}
+    //   {"command": "pause"}
+    //   {"command": "resume"}
+    //   {"command": "filters", "min_profitability": 0.5, "max_difficulty": 100}
+    //   {"command": "status"}
+    // The reply is {"ok": true, "status": ...} or {"ok": false, "error": ...}.
+    JSON control (controllable &, const JSON &command);
+
+    // Accepts connections on a Unix socket. Every line read is a command and
+    // every reply is written as one line. Anyone who can open the socket can
+    // control the miner, so it should be somewhere only we can write.
+    struct control_server : std::enable_shared_from_this<control_server> {
+        using protocol = net::asio::local::stream_protocol;
+
+        // an old socket file at the path is replaced.
+        control_server (controllable &, net::asio::io_context &, const string &path);
+        ~control_server ();
+
+        void start ();
+
+    private:
+        struct connection;
+
+        controllable &Controlled;
+        string Path;
+        protocol::acceptor Acceptor;
+
+        void accept ();
+    };
+
+}
+
+#endif
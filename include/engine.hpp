@@ -0,0 +1,89 @@
+#ifndef BOOSTMINER_ENGINE
+#define BOOSTMINER_ENGINE
+
+#include <search_space.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace BoostPOW {
+
+    // A pool of mining threads for programs that embed the miner. Puzzles are
+    // submitted with a priority and optionally a time limit and a stop token,
+    // and the result comes back through a future or a callback. Every thread
+    // works on the puzzle with the highest priority, the oldest first among
+    // equals, and moves to a new one within 2^16 hashes when it arrives.
+    // The engine never writes to stdout.
+    struct engine {
+
+        struct result {
+            enum status {
+                solved,
+                // the stop token was triggered.
+                cancelled,
+                // the time limit passed.
+                expired,
+                // the engine was destroyed first.
+                stopped
+            };
+
+            status Status;
+
+            // valid only if Status is solved.
+            work::proof Proof;
+        };
+
+        struct statistics {
+            uint32 Threads;
+            uint64 Hashes;
+
+            // since the last call to stats, or since the engine started.
+            double Hashrate;
+
+            // puzzles waiting or being worked on.
+            uint64 Queued;
+
+            uint64 Solved;
+            uint64 Cancelled;
+            uint64 Expired;
+
+            explicit operator JSON () const;
+        };
+
+        // cpus gives the logical cpu for each thread, or -1 if it is not pinned.
+        engine (uint32 threads, uint32 worker_id = 0, std::vector<int32> cpus = {});
+        engine (const engine &) = delete;
+        engine &operator = (const engine &) = delete;
+
+        // puzzles that are not done get result::stopped.
+        ~engine ();
+
+        // higher priorities are worked on first. A max_seconds of zero means no limit.
+        std::future<result> submit (const work::puzzle &,
+            int32 priority = 0, double max_seconds = 0, std::stop_token = {});
+
+        // the callback is called once, on a mining thread or on the thread
+        // that triggers the stop token.
+        void submit (function<void (const result &)> done, const work::puzzle &,
+            int32 priority = 0, double max_seconds = 0, std::stop_token = {});
+
+        statistics stats ();
+
+    private:
+        struct task;
+        struct state;
+
+        ptr<state> State;
+        std::vector<std::thread> Threads;
+
+        void run (uint32 index, uint32 worker_id, int32 cpu);
+    };
+
+}
+
+#endif
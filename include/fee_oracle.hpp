@@ -0,0 +1,76 @@
+#ifndef BOOSTMINER_FEE_ORACLE
+#define BOOSTMINER_FEE_ORACLE
+
+#include <network.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+namespace BoostPOW {
+
+    // Keeps a fee quote that is refreshed in the background so that
+    // getting a fee rate when a solution is found costs nothing.
+    struct fee_oracle final : fees {
+
+        static constexpr double default_fee_rate = .05;
+        static constexpr uint32 default_ttl_seconds = 300;
+
+        // returns a fee rate in satoshis/byte, or throws. A rate that is
+        // not positive is not a quote.
+        using source = function<double ()>;
+
+        // quotes are taken from every MAPI host given and the median is used.
+        fee_oracle (
+            list<string> mapi_hosts = {"mapi.gorillapool.io"},
+            uint32 ttl_seconds = default_ttl_seconds,
+            double default_fee = default_fee_rate);
+
+        fee_oracle (std::vector<source>, uint32 ttl_seconds = default_ttl_seconds, double default_fee = default_fee_rate);
+
+        virtual ~fee_oracle ();
+
+        // return the last good quote right away. Until the first quote is
+        // received, that is the seed if there is one and otherwise the default.
+        // This never waits, since it is called with the manager's lock held.
+        double get () final override;
+
+        // wait until a quote has been received or the timeout has passed.
+        // For callers that are not holding anything up and would rather not
+        // pay the default. Returns whether there is a quote.
+        bool wait_for_quote (std::chrono::steady_clock::duration timeout);
+
+        // get new quotes now. Returns false if no MAPI host gave a valid quote,
+        // in which case the last good value is kept.
+        bool refresh ();
+
+        // use an old quote until a new one arrives, so that get doesn't wait.
+        // Ignored if a quote has already been received.
+        void seed (double fee_rate);
+
+        // of a list that is not empty.
+        static double median (std::vector<double>);
+
+    private:
+        std::vector<source> Sources;
+        uint32 TTL;
+
+        std::atomic<double> FeeRate;
+
+        // whether FeeRate came from a MAPI host. Only changed with Mutex locked.
+        bool Quoted;
+
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        std::condition_variable Received;
+        bool Stop;
+
+        std::thread Refresher;
+
+        void run ();
+    };
+
+}
+
+#endif
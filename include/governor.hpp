@@ -0,0 +1,57 @@
+#ifndef BOOSTMINER_GOVERNOR
+#define BOOSTMINER_GOVERNOR
+
+#include <gigamonkey/types.hpp>
+#include <filesystem>
+
+namespace BoostPOW {
+    using namespace Gigamonkey;
+
+    // How much CPU we may use. In a container, the cgroup may give us less
+    // than the machine has, either as a quota of cpu time (cpu.max) or as a
+    // set of cpus (cpuset.cpus.effective). Threads beyond that only get the
+    // whole cgroup throttled.
+    //
+    // Separately, hashing can be limited to a fraction of the time, so that
+    // we use a steady share of the cpu rather than all of it.
+    namespace governor {
+
+        // "max 100000" means no quota. "150000 100000" means 1.5 cpus.
+        maybe<double> read_cpu_max (const string &);
+
+        // a list like "0-3,6" as found in cpuset files. Zero if it can't be read.
+        uint32 count_cpus (const string &);
+
+        // the cgroup v2 path from the contents of /proc/self/cgroup.
+        maybe<string> read_cgroup_path (const string &);
+
+        struct limits {
+            // cpus we may run on.
+            uint32 CPUs;
+
+            // cpus worth of time we may use, if there is a quota.
+            maybe<double> Quota;
+
+            // the most threads worth running, at least one.
+            uint32 threads () const;
+        };
+
+        // read from /proc/self/cgroup and the cgroup v2 hierarchy under root.
+        // Quotas of parent cgroups count too.
+        limits detect (const std::filesystem::path &root = "/sys/fs/cgroup");
+
+        // the fraction of the time that mining threads may hash, in (0, 1].
+        void set_duty_cycle (double);
+        double duty_cycle ();
+
+        // A thread calls begin when it starts to hash and rest every slice of
+        // hashes. If the duty cycle is less than one, rest sleeps long enough
+        // to keep the thread's share of the time at the duty cycle.
+        void begin ();
+        void rest ();
+
+    }
+
+}
+
+#endif
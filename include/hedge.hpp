@@ -0,0 +1,142 @@
+#ifndef BOOSTMINER_HEDGE
+#define BOOSTMINER_HEDGE
+
+#include <gigamonkey/types.hpp>
+#include <data/io/exception.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace BoostPOW {
+    using namespace Gigamonkey;
+
+    // recent response times of an API endpoint.
+    struct latency {
+        explicit latency (uint32 window = 128) : Mutex {}, Idle {}, Samples {}, Window {window}, Count {0}, Pending {0} {}
+
+        void record (double seconds);
+
+        // a request to the endpoint has started or finished. Attempts that lose
+        // a race are still running after the race is over.
+        void begin ();
+        void end ();
+
+        // wait for every request that has begun to end. Whoever owns what the
+        // requests use calls this before it goes away.
+        void wait () const;
+
+        // the given fraction of recent requests were answered within this many
+        // seconds. Until there have been a few requests, otherwise is returned.
+        double percentile (double fraction, double otherwise) const;
+
+        uint64 count () const;
+
+    private:
+        mutable std::mutex Mutex;
+        mutable std::condition_variable Idle;
+        std::vector<double> Samples;
+        uint32 Window;
+        uint64 Count;
+        uint32 Pending;
+    };
+
+    // A request that any of several endpoints can answer. It is sent to the
+    // first endpoint and, if that has not answered after the given percentile
+    // of its usual latency, to the next as well, and so on. An endpoint that
+    // fails passes the request on right away. Whichever answers first is
+    // taken; the others are left to finish on their own threads, and their
+    // latency is still recorded. Each thread keeps its latency alive, and
+    // the owner of the endpoints waits on it before they are destroyed. If
+    // all fail, the first endpoint's exception is thrown. With only one
+    // endpoint there is nothing to race, so it is read on the calling thread.
+    template <typename X> struct hedge {
+        struct attempt {
+            ptr<latency> Latency;
+            function<X ()> Request;
+        };
+
+        // used for the threshold until an endpoint has a history.
+        static constexpr double default_threshold = 1;
+
+        static X read (std::vector<attempt>, double percentile = .95);
+    };
+
+    template <typename X> X inline hedged (std::vector<typename hedge<X>::attempt> attempts, double percentile = .95) {
+        return hedge<X>::read (std::move (attempts), percentile);
+    }
+
+    template <typename X> X hedge<X>::read (std::vector<attempt> attempts, double percentile) {
+        if (attempts.size () == 0) throw data::exception {"no endpoints to read from"};
+
+        if (attempts.size () == 1) {
+            auto begin = std::chrono::steady_clock::now ();
+            X x = attempts[0].Request ();
+            attempts[0].Latency->record (std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ());
+            return x;
+        }
+
+        struct race {
+            std::mutex Mutex;
+            std::condition_variable Done;
+            std::optional<X> Result;
+            std::vector<std::exception_ptr> Errors;
+            size_t Failed {0};
+        };
+
+        auto r = std::make_shared<race> ();
+        r->Errors.resize (attempts.size ());
+
+        auto start = [r] (size_t index, attempt a) {
+            a.Latency->begin ();
+            std::thread {[r, index, a] () {
+                auto begin = std::chrono::steady_clock::now ();
+                try {
+                    X x = a.Request ();
+                    a.Latency->record (std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ());
+
+                    std::lock_guard<std::mutex> lock (r->Mutex);
+                    if (!bool (r->Result)) r->Result = std::move (x);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock (r->Mutex);
+                    r->Errors[index] = std::current_exception ();
+                    r->Failed++;
+                }
+
+                r->Done.notify_all ();
+                a.Latency->end ();
+            }}.detach ();
+        };
+
+        std::unique_lock<std::mutex> lock (r->Mutex);
+        for (size_t i = 0; i < attempts.size (); i++) {
+            size_t failed = r->Failed;
+            double threshold = attempts[i].Latency->percentile (percentile, default_threshold);
+            start (i, attempts[i]);
+
+            // the last one is waited for without a limit below.
+            if (i + 1 == attempts.size ()) break;
+
+            r->Done.wait_for (lock, std::chrono::duration<double> (threshold), [&r, failed] () {
+                return bool (r->Result) || r->Failed > failed;
+            });
+
+            if (bool (r->Result)) return std::move (*r->Result);
+        }
+
+        r->Done.wait (lock, [&r, &attempts] () {
+            return bool (r->Result) || r->Failed == attempts.size ();
+        });
+
+        if (bool (r->Result)) return std::move (*r->Result);
+
+        for (const auto &err : r->Errors) if (err != nullptr) std::rethrow_exception (err);
+        throw data::exception {"every endpoint failed"};
+    }
+
+}
+
+#endif
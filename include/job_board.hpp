@@ -0,0 +1,75 @@
+#ifndef BOOSTMINER_JOB_BOARD
+#define BOOSTMINER_JOB_BOARD
+
+#include <jobs.hpp>
+
+namespace BoostPOW {
+
+    // The table of verified jobs in POSIX shared memory, so that several
+    // miner processes on one host can share a single process that calls the
+    // APIs. The table is written in the format of warm_start.hpp into one
+    // of two slots in turn, each with a sequence number that is odd while the
+    // slot is being written. Readers parse the table straight out of the
+    // shared region and check afterwards that the sequence did not change,
+    // so neither side ever waits for the other. A slot is only written again
+    // two tables later, so a reader has a whole refresh interval to read it.
+    struct job_board {
+
+        // room for a few thousand jobs.
+        static constexpr size_t default_slot_size = 1 << 22;
+
+        // readers should look for a new board if the table is older than this,
+        // in case the publisher died without closing it.
+        static constexpr int64 stale_seconds = 600;
+
+        // create the region, replacing any other with the same name. It is
+        // closed and removed when the board is destroyed.
+        static ptr<job_board> create (const string &name, size_t slot_size = default_slot_size);
+
+        // attach to a region that another process created. Null if there is none.
+        static ptr<job_board> attach (const string &name);
+
+        // only for the board that created the region. Throws if the table does not fit in a slot.
+        void publish (const jobs &);
+
+        // zero until the first table is published.
+        uint64 version () const;
+
+        // whether the publisher has gone away.
+        bool closed () const;
+
+        struct table {
+            uint64 Version;
+
+            // seconds since the Unix epoch.
+            int64 Published;
+
+            jobs Jobs;
+        };
+
+        // nothing if no table has been published yet, or if the publisher
+        // was too quick to read a consistent one.
+        maybe<table> read () const;
+
+        ~job_board ();
+
+        job_board (const job_board &) = delete;
+        job_board &operator = (const job_board &) = delete;
+
+    private:
+        struct layout;
+
+        string Name;
+        bool Publisher;
+        layout *Region;
+        size_t Size;
+
+        job_board (const string &name, bool publisher, layout *region, size_t size) :
+            Name {name}, Publisher {publisher}, Region {region}, Size {size} {}
+
+        byte *slot (uint64 version) const;
+    };
+
+}
+
+#endif
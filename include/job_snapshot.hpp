@@ -0,0 +1,76 @@
+#ifndef BOOSTMINER_JOB_SNAPSHOT
+#define BOOSTMINER_JOB_SNAPSHOT
+
+#include <jobs.hpp>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace BoostPOW {
+
+    // A job as it is given to mining threads. A snapshot is never changed once it
+    // has been made, so the threads working on a job and the code that checks
+    // their solutions can all share one copy without locking. Everything about
+    // the job that hashing needs is worked out when the snapshot is made, so a
+    // thread that switches to it can start hashing right away.
+    struct job_snapshot {
+        digest256 ID;
+        Boost::puzzle Puzzle;
+
+        // the work string is derived from the script here rather than by the thread.
+        work::puzzle Work;
+
+        // Work.Candidate.Target expanded.
+        uint256 Target;
+
+        job_snapshot (const digest256 &id, const Boost::puzzle &p) :
+            ID {id}, Puzzle {p}, Work (p), Target {Work.Candidate.Target.expand ()} {}
+
+        // whether this was made from the job as it is now. A job that has
+        // gained or lost outputs needs a new snapshot.
+        bool current (const working &) const;
+    };
+
+    using snapshot = ptr<const job_snapshot>;
+
+    // Makes snapshots on a background thread for the jobs that are likely to
+    // be mined next, so that whoever assigns a thread to one of them doesn't
+    // have to choose a key and derive the work string while holding its lock.
+    struct snapshot_builder {
+        using maker = function<snapshot (const digest256 &, const working &)>;
+
+        snapshot_builder (maker);
+        ~snapshot_builder ();
+
+        // the jobs we want snapshots of, most important first. Anything that was
+        // wanted before and isn't now is dropped, whether or not it is ready.
+        void prepare (std::vector<std::pair<digest256, working>>);
+
+        // a snapshot of the job as it is now, if one is ready. It is given up by the builder.
+        snapshot take (const digest256 &id, const working &);
+
+        // how many snapshots are ready.
+        size_t ready ();
+
+    private:
+        maker Make;
+
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        bool Stop;
+
+        // everything in the last call to prepare.
+        std::set<digest256> Wanted;
+        std::list<std::pair<digest256, working>> Pending;
+        std::map<digest256, snapshot> Ready;
+
+        std::thread Builder;
+
+        void run ();
+    };
+
+}
+
+#endif
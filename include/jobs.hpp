@@ -16,7 +16,12 @@ namespace BoostPOW {
         working (): Boost::candidate {}, Workers {} {}
         
         // used to select random jobs. 
-        double weight (double minimum_profitability, double tilt) const;
+        double weight (double minimum_profitability, double tilt) const {
+            return weight (minimum_profitability, tilt, data::size (Workers));
+        }
+
+        // weight if the job had the given number of workers.
+        double weight (double minimum_profitability, double tilt, uint32 workers) const;
     };
     
     struct jobs {
@@ -42,13 +47,20 @@ namespace BoostPOW {
         map<digest160, Bitcoin::secret> Past;
         list<Bitcoin::secret> Next;
 
+        // how many keys have been taken from Keys.
+        uint32 Drawn;
+
         explicit map_key_database (ptr<key_source> keys, uint32 max_look_ahead = 0) :
-            Keys {keys}, MaxLookAhead {max_look_ahead}, Past {}, Next {} {}
+            Keys {keys}, MaxLookAhead {max_look_ahead}, Past {}, Next {}, Drawn {0} {}
 
         Bitcoin::secret next () override;
 
         Bitcoin::secret operator [] (const digest160 &addr);
 
+        // take keys from Keys until this many have been taken, as they were by an
+        // earlier run of the program. Keys are never written to disk, only the count.
+        void restore (uint32 drawn);
+
     };
     
     string write (const Bitcoin::txid &);
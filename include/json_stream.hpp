@@ -0,0 +1,27 @@
+#ifndef BOOSTMINER_JSON_STREAM
+#define BOOSTMINER_JSON_STREAM
+
+#include <whatsonchain_api.hpp>
+#include <string_view>
+#include <vector>
+
+namespace BoostPOW {
+
+    // Decoders for the two large responses we get on every refresh. The body
+    // is read with a SAX parser straight into a vector, so no JSON document
+    // is built, and the vector is reserved up front from the size of the
+    // body. Fields that we don't use are skipped. Throws data::exception if
+    // the body is not what we expect.
+    namespace json_stream {
+
+        // {"jobs": [{"txid": ..., "vout": ..., "value": ..., "script": ..., ...}, ...], ...}
+        std::vector<Bitcoin::prevout> read_jobs (std::string_view body);
+
+        // [{"height": ..., "tx_pos": ..., "tx_hash": ..., "value": ...}, ...]
+        std::vector<UTXO> read_unspent (std::string_view body);
+
+    }
+
+}
+
+#endif
@@ -3,13 +3,77 @@
 
 #include <boost/date_time.hpp>
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <ostream>
 
 using nlohmann::json;
 
+// Events below this level are dropped without looking at the runtime level.
+// Code guarded by logger::enabled for such a level is removed by the compiler.
+#ifndef BOOSTMINER_LOG_LEVEL
+#define BOOSTMINER_LOG_LEVEL 1
+#endif
+
 namespace logger {
 
-  void log (std::string event, json j);
+    enum level : int {
+        trace = 0,
+        debug = 1,
+        info = 2,
+        warning = 3,
+        error = 4,
+        off = 5
+    };
+
+    // JSON writes one object per line. binary writes length-prefixed CBOR.
+    enum class format {
+        JSON,
+        binary
+    };
+
+    extern std::atomic<int> Level;
+
+    bool constexpr compiled (level l) {
+        return l >= BOOSTMINER_LOG_LEVEL;
+    }
+
+    // check this before building an expensive message. The arguments of log
+    // are built before it can check the level itself.
+    bool inline enabled (level l) {
+        return compiled (l) && l >= Level.load (std::memory_order_relaxed);
+    }
+
+    void set_level (level);
+    void set_format (format);
+
+    // events are written to std::cout unless another stream is given.
+    void set_output (std::ostream &);
+
+    // read a level from a string such as "debug" or "warning".
+    level read_level (const std::string &);
+
+    // write at most this many events of a given type per second.
+    void limit (const std::string &event, uint32_t per_second);
+
+    // write only one in every n events of a given type.
+    void sample (const std::string &event, uint32_t n);
+
+    // Events are put on a queue belonging to the calling thread and written
+    // out in batches by a background thread, so this never blocks. If the
+    // queue is full, the event is dropped and counted.
+    void write (level, std::string event, json j);
+
+    void inline log (level l, std::string event, json j) {
+        if (enabled (l)) write (l, std::move (event), std::move (j));
+    }
+
+    void inline log (std::string event, json j) {
+        log (info, std::move (event), std::move (j));
+    }
+
+    // wait until everything logged so far has been written.
+    void flush ();
 
 }
 
-#endif 
+#endif
@@ -4,6 +4,16 @@
 #include <gigamonkey/schema/keysource.hpp>
 #include <gigamonkey/work/solver.hpp>
 #include <network.hpp>
+#include <redeem_template.hpp>
+#include <aggregator.hpp>
+#include <scheduler.hpp>
+#include <search_space.hpp>
+#include <affinity.hpp>
+#include <warm_start.hpp>
+#include <job_board.hpp>
+#include <job_snapshot.hpp>
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
@@ -40,7 +50,55 @@ namespace BoostPOW {
     
     Bitcoin::transaction redeem_puzzle (const Boost::puzzle &puzzle, const work::solution &solution, list<Bitcoin::output> pay);
 
-    void mining_thread (work::selector *, random *, uint32);
+    // search for a solution starting from initial for at most max_time_seconds. Only
+    // the nonce and timestamp are changed, so the search also stops once every nonce
+    // has been tried. Hashes are counted in hashes if it is not null. If epoch is not
+    // null, the search also stops soon after its value changes.
+    work::proof cpu_solve (const work::puzzle &, const work::solution &initial, double max_time_seconds,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch = nullptr);
+
+    // the same, with the target of the puzzle already expanded.
+    work::proof cpu_solve (const work::puzzle &, const uint256 &target, const work::solution &initial,
+        double max_time_seconds, std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch = nullptr);
+
+    // search ranges claimed from the partition until a solution is found or time runs out,
+    // or until epoch changes if it is not null.
+    work::proof solve (search_partition &, const work::puzzle &, double max_time_seconds,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch = nullptr);
+
+    // the same, for a job whose target has been expanded already.
+    work::proof solve (search_partition &, const job_snapshot &, double max_time_seconds,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch = nullptr);
+
+    // hashes are counted in the given variable if it is not null.
+    void mining_thread (work::selector *, search_partition *, uint32, std::atomic<uint64> *hashes);
+
+    // a job that is expected to take a small fraction of a second for one thread.
+    using micro_job = snapshot;
+
+    struct micro_solution {
+        micro_job Job;
+        work::solution Solution;
+    };
+
+    // micro jobs given to a thread, with the hashrate of one thread as it was
+    // measured then, by which we know how long each job should take.
+    struct micro_batch {
+        std::vector<micro_job> Jobs;
+        double ThreadHashrate;
+
+        size_t size () const {
+            return Jobs.size ();
+        }
+    };
+
+    // a micro job is skipped once it has taken this many times as long as expected.
+    constexpr double micro_job_patience = 4;
+
+    // solve micro jobs one after another. The whole batch is given up if epoch
+    // changes, so that a thread can be stopped or given something else.
+    std::vector<micro_solution> solve_batch (search_partition &, const micro_batch &,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch = nullptr);
     
     struct channel : virtual work::selector, virtual work::solver {
         std::mutex Mutex;
@@ -81,13 +139,18 @@ namespace BoostPOW {
     
     struct multithreaded : channel {
         multithreaded (
-            uint32 threads, uint64 random_seed) :
-            Threads {threads}, Seed {random_seed}, Workers {} {}
+            uint32 threads, uint32 worker_id, std::vector<int32> cpus = {}) :
+            Threads {threads}, WorkerID {worker_id}, CPUs {cpus}, Workers {} {}
         
         virtual ~multithreaded ();
         
         uint32 Threads; 
-        uint64 Seed;
+
+        // extra nonce 1 of every thread. See search_space.hpp.
+        uint32 WorkerID;
+
+        // the logical cpu for each thread, or -1 if it is not pinned. See affinity.hpp.
+        std::vector<int32> CPUs;
         
         // start threads if not already. 
         void start_threads ();
@@ -101,10 +164,39 @@ namespace BoostPOW {
     };
     
     struct redeemer : virtual work::selector, virtual work::solver {
-        redeemer () : work::selector {}, Mutex {}, Out {}, Current {} {}
+        redeemer () : work::selector {}, Epoch {0}, Mutex {}, Out {}, In {},
+            Current {}, Last {}, Batch {}, Solved {false}, Stopped {false}, Published {} {}
         virtual ~redeemer () {};
         
-        void mine (const std::pair<digest256, Boost::puzzle> &p);
+        // a null snapshot means stop mining.
+        void mine (snapshot);
+
+        void mine (const std::pair<digest256, Boost::puzzle> &p) {
+            mine (p.second.valid () ? std::make_shared<const job_snapshot> (p.first, p.second) : snapshot {});
+        }
+
+        // give the thread a batch of micro jobs to solve back to back instead of a single puzzle.
+        void mine (micro_batch batch);
+
+        // called by the mining thread. If a batch has been given, take it.
+        micro_batch take_batch ();
+
+        // the job that the thread should be working on, or null if there is none.
+        // Threads call this between slices of work without taking the lock.
+        snapshot job () const {
+            return Published.load (std::memory_order_acquire);
+        }
+
+        // block until there is a job or a batch. False if the redeemer has been stopped.
+        bool wait_for_job ();
+
+        void stop ();
+
+        // called by a thread that has solved the job.
+        void solved (const snapshot &, const work::solution &);
+
+        // solutions to a batch are submitted together. By default they are submitted one by one.
+        virtual void submit_batch (const std::vector<micro_solution> &);
         
         void wait_for_solution () {
             std::unique_lock<std::mutex> lock {Mutex};
@@ -114,32 +206,57 @@ namespace BoostPOW {
 
         digest256 current () {
             std::unique_lock<std::mutex> lock {Mutex};
-            return Current.first;
+            return Current == nullptr ? digest256 {} : Current->ID;
         }
+
+        // incremented whenever the thread is given something new so that it stops
+        // hashing the old job. The thread reads it while it hashes, so it is kept
+        // apart from everything the manager writes under Mutex.
+        alignas (cache_line) std::atomic<uint64> Epoch;
         
     protected:
         std::mutex Mutex;
         std::condition_variable Out;
+        std::condition_variable In;
         
-        std::pair<digest256, Boost::puzzle> Current;
-        std::pair<digest256, Boost::puzzle> Last;
+        snapshot Current;
+        snapshot Last;
+
+        micro_batch Batch;
         
         bool Solved;
+        bool Stopped;
+
+        // the same as Current, for readers that don't lock.
+        std::atomic<snapshot> Published;
         
+        // for threads that get their puzzles from select.
         void solved (const work::solution &) override;
         
         virtual void submit (const std::pair<digest256, Boost::puzzle> &, const work::solution &) = 0;
     };
+
+    // like mining_thread, but also solves batches of micro jobs given to the redeemer.
+    void redeeming_thread (redeemer *, search_partition *, uint32, std::atomic<uint64> *hashes);
     
     struct manager : std::enable_shared_from_this<manager> {
         
         struct redeemer : BoostPOW::redeemer {
             manager *Manager;
-            redeemer (manager *m) : BoostPOW::redeemer {}, Manager {m} {}
+
+            // total hashes done by the thread. Written by the thread and
+            // read by the manager, so it has a cache line of its own.
+            alignas (cache_line) std::atomic<uint64> Hashes;
+
+            redeemer (manager *m) : BoostPOW::redeemer {}, Manager {m}, Hashes {0} {}
             
             void submit (const std::pair<digest256, Boost::puzzle> &puzzle, const work::solution &solution) final override {
                 Manager->submit (puzzle, solution);
             }
+
+            void submit_batch (const std::vector<micro_solution> &solutions) final override {
+                Manager->submit (this, solutions);
+            }
             
             virtual ~redeemer () {}
         };
@@ -152,22 +269,64 @@ namespace BoostPOW {
             uint64 random_seed,
             double maximum_difficulty,
             double minimum_profitability, 
-            uint64 min_value);
-        
-        void run (bool websockets, uint32 refresh_interval);
+            uint64 min_value,
+            ptr<scheduling_policy> policy = std::make_shared<expected_value_policy> (),
+            // initial guess at the hashrate of other miners, in hashes/second.
+            double competitor_hashrate = 0,
+            // jobs expected to take less than this many seconds on one thread are
+            // solved in batches. Zero means no batching.
+            double micro_job_seconds = 0,
+            // solved jobs may wait this long to be redeemed together with others.
+            // Zero means every job gets its own transaction.
+            double aggregate_seconds = 0);
+        
+        // calls to the jobs API are made on a thread of their own, so that the
+        // io_context is free to handle websocket messages while they run.
+        // if a state file is given, what we know is saved to it after every call to
+        // the jobs API and when we are stopped by a signal. See warm_start.hpp.
+        void run (bool websockets, uint32 refresh_interval, const std::filesystem::path &state_file = {});
+
+        // start mining the jobs of a previous run, if they are recent, without
+        // waiting for the API. The keys it used are derived again.
+        void restore (const warm_start::state &);
+        warm_start::state saved_state ();
+
+        // share jobs with other processes on this host through a job board of
+        // the given name. A publisher calls the API and writes every job table
+        // to the board. Otherwise jobs are read from the board instead of the
+        // API, and the board is looked for again if it goes away. See job_board.hpp.
+        void share_jobs (const string &board, bool publish);
         
         void update_jobs (const BoostPOW::jobs &j);
         
         int add_new_miner (ptr<redeemer>);
 
+        // the miner's job goes to whoever else is left.
+        void remove_miner (ptr<redeemer>);
+
         void new_job (const Bitcoin::prevout &p);
         void solved_job (const Bitcoin::outpoint &p);
+
+        // while paused, no thread is given a job but jobs are still tracked.
+        void pause (bool);
+
+        // jobs that no longer pass are dropped right away. Jobs that pass
+        // looser filters come back with the next call to the API.
+        void set_filters (double minimum_profitability, double maximum_difficulty);
+
+        JSON status ();
         
         virtual ~manager () {}
         
         void submit (const std::pair<digest256, Boost::puzzle> &, const work::solution &);
-        
-    private:
+        void submit (redeemer *, const std::vector<micro_solution> &);
+
+    protected:
+        // the clock used to measure hashrates and how long jobs last.
+        virtual std::chrono::steady_clock::time_point now () {
+            return std::chrono::steady_clock::now ();
+        }
+
         std::mutex Mutex;
         
         network &Net;
@@ -187,8 +346,126 @@ namespace BoostPOW {
         std::vector<ptr<redeemer>> Redeemers;
 
         bool Mining;
-        
-        void select_job (int i);
+        bool Paused;
+
+        ptr<scheduling_policy> Policy;
+
+        // hashes/second of one of our threads, as measured.
+        double ThreadHashrate;
+
+        // hashes/second of other miners, estimated from how long bounty jobs last.
+        double CompetitorHashrate;
+
+        // the thread hashrate used in the last allocation.
+        double AllocatedHashrate;
+
+        std::map<digest256, std::chrono::steady_clock::time_point> FirstSeen;
+
+        uint64 LastHashes;
+        std::chrono::steady_clock::time_point LastMeasured;
+
+        double MicroJobSeconds;
+
+        // threads that are working on a batch of micro jobs, and the jobs in the batch.
+        std::map<int, std::vector<digest256>> Batches;
+
+        // the script that redeem transactions for a job pay to. Every template
+        // for the job uses the same one, so an address is drawn from Addresses
+        // once per job. Scripts of jobs that go away without being redeemed by
+        // us were never used, so they are given to the next job instead.
+        std::map<digest256, bytes> PayScripts;
+        std::vector<bytes> SparePayScripts;
+
+        // the key for each bounty job, kept in the same way, so that snapshots
+        // that are made again or thrown away don't draw more keys from Keys.
+        std::map<digest256, Bitcoin::secret> BountyKeys;
+        std::vector<Bitcoin::secret> SpareKeys;
+
+        // redeem transactions are prepared for jobs as they are assigned.
+        template_builder Templates;
+
+        // every thread on a job is given the same snapshot. A snapshot is taken from
+        // Precompiled or made the first time a job is assigned, and forgotten when the job changes.
+        std::map<digest256, snapshot> Snapshots;
+
+        double AggregateSeconds;
+
+        // null if solved jobs are not aggregated.
+        std::unique_ptr<aggregator> Aggregator;
+
+        // only touched by refreshes, which never run at the same time.
+        string BoardName;
+        bool PublishJobs;
+        ptr<job_board> Board;
+        uint64 BoardVersion;
+        int64 BoardPublished;
+
+        // get jobs from a refresh of the API or from the job board.
+        void refresh_jobs ();
+
+        // a redeem transaction from the job's template if one is ready, and
+        // otherwise made from scratch. Called without Mutex.
+        bytes redeem (const digest256 &id, const Boost::puzzle &, const work::solution &);
+
+        // broadcast a redeem transaction and log it. Called without Mutex,
+        // since the broadcast waits on several hosts.
+        bool broadcast (const bytes &redeem_tx);
+
+        // snapshots of the most profitable jobs that no thread is on are made
+        // on a background thread, so that switching to them costs nothing.
+        // Declared last so that its thread is stopped before anything it uses goes.
+        snapshot_builder Precompiled;
+
+        // The functions below must be called with Mutex locked.
+
+        // allocate threads to jobs according to the scheduling policy. Threads
+        // are only moved if their job needs fewer threads. If reissue is set,
+        // threads that stay on their job are given a new puzzle for it anyway.
+        void rebalance (bool reissue = false);
+
+        void assign (int i, std::map<digest256, working>::iterator);
+
+        // give batches of micro jobs to some of the available threads and remove them from the list.
+        void batch_micro_jobs (std::vector<int> &available);
+        bool micro (const working &) const;
+        void unassign (int i);
+        void rest (int i);
+
+        market current_market ();
+        void measure_hashrate ();
+        void estimate_competition (const digest256 &, const working &);
+
+        // whether a solved job should wait to be redeemed together with others.
+        bool hold (const working &);
+
+        // remove a job and everything we prepared for it. Redeemed is whether
+        // we have made a transaction that redeems it. Returns the next job.
+        std::map<digest256, working>::iterator forget_job (std::map<digest256, working>::iterator, bool redeemed = false);
+
+        // remove a job and reallocate its threads.
+        void remove_job (std::map<digest256, working>::iterator, bool redeemed = false);
+
+        // called periodically between calls to the API.
+        void tick ();
+
+        Boost::puzzle make_puzzle (const digest256 &id, const working &);
+
+        // contract jobs use the key they name. Bounty jobs are given one the first time they are asked for.
+        Bitcoin::secret key_for (const digest256 &id, const working &);
+        void release_key (const digest256 &id, bool redeemed);
+
+        // tell Precompiled which jobs are likely to be mined next.
+        void prepare_snapshots ();
+
+        snapshot snapshot_of (std::map<digest256, working>::iterator);
+
+        bytes pay_script_for (const digest256 &id);
+
+        // redeemed is whether the script has been paid to.
+        void release_pay_script (const digest256 &id, bool redeemed);
+
+        // the outputs of a redeem transaction for this puzzle. Called without Mutex.
+        list<Bitcoin::output> pay (const Boost::puzzle &);
         
     };
     
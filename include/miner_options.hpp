@@ -6,6 +6,7 @@
 #include <optional>
 #include <argh.h>
 #include "jobs.hpp"
+#include "affinity.hpp"
 
 namespace BoostPOW {
     using namespace Gigamonkey;
@@ -61,12 +62,36 @@ namespace BoostPOW {
 
         uint32 Threads {1};
 
+        // if set by --threads=auto, the number of threads is taken from
+        // the autotuner. See autotune.hpp.
+        bool AutoThreads {false};
+
+        // where autotuning results are kept. Empty means the default location.
+        string TuneCache {};
+
+        // whether to pin threads to cpus.
+        affinity::mode Affinity {affinity::mode::off};
+
+        // the fraction of the time that threads hash. See governor.hpp.
+        double DutyCycle {1};
+
+        // extra nonce 1 for every thread, so that hosts and processes mining the
+        // same job never search the same space. Written host.process or as one
+        // number. If not provided, it is chosen at random.
+        uint32 WorkerID {0};
+
         // if not provided, look up fee rate from GorillaPool MAPI.
         maybe<double> FeeRate {};
 
-        // Where to call the Boost API.
-        // If not provided, use pow.co.
-        maybe<string> APIHost {};
+        // MAPI hosts to get fee quotes from if no fee rate is given.
+        list<string> MAPIHosts {"mapi.gorillapool.io"};
+
+        // how often to get a new fee quote, in seconds.
+        uint32 FeeQuoteInterval {300};
+
+        // Where to call the Boost API. Reads go to the first host and are
+        // hedged to the others when it is slow.
+        list<string> APIHosts {"pow.co"};
     };
 
     struct mining_options : redeeming_options {
@@ -75,15 +100,79 @@ namespace BoostPOW {
         int64 MinValue {300};
         bool Websockets {false};
         uint32 RefreshInterval {90};
+
+        // how threads are allocated to jobs. See scheduler.hpp.
+        string Policy {"expected_value"};
+
+        // initial guess at the hashes/second of other miners working on bounty jobs.
+        double CompetitorHashrate {0};
+
+        // jobs expected to take less than this many seconds on one thread
+        // are solved in batches. Zero turns batching off.
+        double MicroJobSeconds {0};
+
+        // solved jobs may wait this many seconds to be redeemed
+        // together in one transaction. Zero turns this off.
+        double AggregateSeconds {0};
+
+        // path of a Unix socket on which the running miner can be controlled.
+        // Empty means no socket. See control.hpp.
+        string ControlSocket {};
+
+        // file where jobs, the number of keys used and the fee rate are kept
+        // between runs. Empty means nothing is kept. See warm_start.hpp.
+        string WarmStart {};
+
+        // write all API traffic to a file, or play it back from one instead
+        // of calling the APIs. At most one may be given. See traffic.hpp.
+        string Record {};
+        string Replay {};
+
+        // how much faster than recorded to play it back. Zero means without waiting.
+        double ReplaySpeed {1};
+
+        // name of a job board in shared memory to publish the jobs we get from
+        // the API to, or to read jobs from instead of the API. At most one may
+        // be given. See job_board.hpp.
+        string PublishJobs {};
+        string JobBoard {};
+    };
+
+    // a worker gets jobs from a Stratum server rather than the Boost API
+    // and holds no keys.
+    struct worker_options {
+        string Host {};
+        uint16 Port {3333};
+
+        // the name we give when we authorize.
+        string Name {"BoostMiner"};
+
+        uint32 Threads {1};
+        bool AutoThreads {false};
+        string TuneCache {};
+        affinity::mode Affinity {affinity::mode::off};
+        double DutyCycle {1};
     };
 
+    // measure the hashrate with different numbers of threads and save the best.
+    struct tuning_options {
+        double Seconds {3};
+        string TuneCache {};
+    };
+
+    // read the options for mine. The key and address may be given as the
+    // second and third positional arguments.
+    mining_options read_mining_options (const argh::parser &);
+
     // validate options and call the appropriate function.
     int run (const argh::parser &,
         int (*help) (),
         int (*version) (),
         int (*spend) (const script_options &),
         int (*redeem) (const Bitcoin::outpoint &, const bytes &script, int64 value, const redeeming_options &),
-        int (*mine) (const mining_options &));
+        int (*mine) (const mining_options &),
+        int (*worker) (const worker_options &),
+        int (*tune) (const tuning_options &));
 }
 
 #endif
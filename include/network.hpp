@@ -5,6 +5,7 @@
 #include <pow_co_api.hpp>
 #include <whatsonchain_api.hpp>
 #include <jobs.hpp>
+#include <hedge.hpp>
 #include <ctime>
 
 using namespace Gigamonkey;
@@ -14,18 +15,63 @@ namespace BoostPOW {
     struct network {
         net::asio::io_context IO;
         ptr<net::HTTP::SSL> SSL;
+
+        // shared by every client except MAPI, whose requests are made inside gigamonkey.
+        ptr<connection_pool> Pool;
+
         whatsonchain WhatsOnChain;
         pow_co PowCo;
         BitcoinAssociation::MAPI Gorilla;
-        net::HTTP::client_blocking CoinGecko;
-        
-        network (string api_host = "pow.co") : IO {}, SSL {std::make_shared<net::HTTP::SSL> (net::HTTP::SSL::tlsv12_client)},
-            WhatsOnChain {SSL}, PowCo {IO, SSL, api_host},
+        pooled_client CoinGecko;
+
+        // other hosts of the Boost API. Reads from PowCo are hedged to these.
+        // Writes only go to PowCo.
+        std::vector<ptr<pow_co>> Mirrors;
+
+        // PowCo first, then the mirrors.
+        std::vector<ptr<latency>> PowCoLatency;
+
+        // at most one of these is set. See traffic.hpp.
+        ptr<traffic::recorder> Recorder;
+        ptr<traffic::player> Player;
+
+        network (list<string> api_hosts = {"pow.co"}) : IO {}, SSL {std::make_shared<net::HTTP::SSL> (net::HTTP::SSL::tlsv12_client)},
+            Pool {std::make_shared<connection_pool> (SSL)},
+            WhatsOnChain {Pool, SSL}, PowCo {IO, Pool, SSL, data::empty (api_hosts) ? string {"pow.co"} : api_hosts.first ()},
             Gorilla {net::HTTP::REST {"https", "mapi.gorillapool.io"}},
-            CoinGecko {net::HTTP::REST {"https", "api.coingecko.com"}, tools::rate_limiter {1, 10}} {
+            CoinGecko {Pool, SSL, net::HTTP::REST {"https", "api.coingecko.com"}, 1, 10},
+            Mirrors {}, PowCoLatency {}, Recorder {}, Player {} {
             SSL->set_default_verify_paths ();
             SSL->set_verify_mode (net::asio::ssl::verify_peer);
+
+            PowCoLatency.push_back (std::make_shared<latency> ());
+            if (!data::empty (api_hosts)) for (const string &host : api_hosts.rest ()) {
+                Mirrors.push_back (std::make_shared<pow_co> (IO, Pool, SSL, host));
+                PowCoLatency.push_back (std::make_shared<latency> ());
+            }
+        }
+
+        // reads that lost a hedge may still be using our clients.
+        ~network () {
+            for (const auto &l : PowCoLatency) l->wait ();
         }
+
+        // record everything that goes through the connection pool and every
+        // websocket message. Must be called before anything is requested.
+        void record (const std::filesystem::path &file) {
+            Recorder = std::make_shared<traffic::recorder> (file);
+            Pool->record (Recorder);
+        }
+
+        // answer requests from a recording. Nothing is broadcast and there are
+        // no fee quotes, since MAPI calls are made inside gigamonkey.
+        void replay (const std::filesystem::path &file, double speed = 1) {
+            Player = std::make_shared<traffic::player> (file, speed);
+            Pool->replay (Player);
+        }
+
+        // read from the Boost API, hedged across PowCo and the mirrors if there are any.
+        template <typename X> X read_api (function<X (pow_co &)>);
         
         BoostPOW::jobs jobs (uint32 limit = 10, double max_difficulty = -1, int64 min_value = 1);
         
@@ -34,6 +80,9 @@ namespace BoostPOW {
         satoshi_per_byte mining_fee ();
         
         Boost::candidate job (const Bitcoin::outpoint &);
+
+        // unspent outputs of a script from whatsonchain.
+        std::vector<UTXO> get_unspent (const digest256 &script_hash);
         
         struct broadcast_error {
             enum error {
@@ -88,7 +137,22 @@ namespace BoostPOW {
         }
     };
 
+    template <typename X> X network::read_api (function<X (pow_co &)> read) {
+        std::vector<typename hedge<X>::attempt> attempts {};
+        attempts.push_back ({PowCoLatency[0], [this, read] () -> X {
+            return read (PowCo);
+        }});
+
+        for (size_t i = 0; i < Mirrors.size (); i++)
+            attempts.push_back ({PowCoLatency[i + 1], [mirror = Mirrors[i], read] () -> X {
+                return read (*mirror);
+            }});
+
+        return hedged<X> (std::move (attempts));
+    }
+
     network::broadcast_error inline network::broadcast_solution (const bytes &tx) {
+        if (Player != nullptr) return broadcast (tx);
         PowCo.submit_proof (tx);
         return broadcast (tx);
     }
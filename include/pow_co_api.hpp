@@ -2,7 +2,7 @@
 #define BOOSTMINER_POW_CO_API
 
 #include <data/net/asio/session.hpp>
-#include <data/net/HTTP_client.hpp>
+#include <connection_pool.hpp>
 #include <gigamonkey/boost/boost.hpp>
 
 using namespace Gigamonkey;
@@ -17,13 +17,13 @@ struct inpoint : Bitcoin::outpoint {
     inpoint (const Bitcoin::txid &t, uint32 i) : outpoint {t, i} {}
 };
 
-struct pow_co : net::HTTP::client_blocking {
+struct pow_co : BoostPOW::pooled_client {
 
     net::asio::io_context &IO;
     ptr<net::HTTP::SSL> SSL;
     
-    pow_co (net::asio::io_context &io, ptr<net::HTTP::SSL> ssl, string host = "pow.co") :
-        net::HTTP::client_blocking {ssl, net::HTTP::REST {"https", host}, tools::rate_limiter {3, 1}}, IO {io}, SSL {ssl} {}
+    pow_co (net::asio::io_context &io, ptr<BoostPOW::connection_pool> pool, ptr<net::HTTP::SSL> ssl, string host = "pow.co") :
+        BoostPOW::pooled_client {pool, ssl, net::HTTP::REST {"https", host}, 3, 1}, IO {io}, SSL {ssl} {}
 
     struct get_jobs_query {
         get_jobs_query &limit (uint32);
@@ -32,7 +32,7 @@ struct pow_co : net::HTTP::client_blocking {
         get_jobs_query &max_difficulty (double);
         get_jobs_query &min_difficulty (double);
 
-        list<Bitcoin::prevout> operator () ();
+        std::vector<Bitcoin::prevout> operator () ();
 
         get_jobs_query (pow_co &pc) : PowCo {pc} {}
 
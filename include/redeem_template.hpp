@@ -0,0 +1,88 @@
+#ifndef BOOSTMINER_REDEEM_TEMPLATE
+#define BOOSTMINER_REDEEM_TEMPLATE
+
+#include <jobs.hpp>
+#include <condition_variable>
+#include <thread>
+#include <list>
+#include <mutex>
+
+namespace BoostPOW {
+
+    // A redeem transaction that has been signed in advance. The signature
+    // commits to the outputs but not to the input scripts, so once a solution
+    // is found it only needs to be written into the serialized transaction.
+    struct redeem_template {
+        Boost::puzzle Puzzle;
+        list<Bitcoin::output> Pay;
+
+        // signed transaction containing a placeholder solution.
+        bytes Transaction;
+
+        // where a solution field appears in Transaction, once per input.
+        struct field {
+            std::vector<size_t> Offsets;
+            size_t Size;
+            bool BigEndian;
+        };
+
+        field Timestamp;
+        field Nonce;
+        field ExtraNonce1;
+        field ExtraNonce2;
+        maybe<field> Bits;
+
+        bool valid () const {
+            return Transaction.size () != 0;
+        }
+
+        // Sign the transaction and find where the solution goes. The result
+        // is checked against Boost::puzzle::redeem and is invalid if the two
+        // would not produce the same transaction.
+        static redeem_template make (random &, const Boost::puzzle &, list<Bitcoin::output> pay);
+
+        // the complete redeem transaction for this solution.
+        bytes redeem (const work::solution &) const;
+    };
+
+    // Builds redeem templates on a background thread for jobs that are being mined.
+    struct template_builder {
+        // the outputs that a redeem tx for this puzzle should pay to.
+        using payment = function<list<Bitcoin::output> (const Boost::puzzle &)>;
+
+        template_builder (payment pay, uint64 random_seed);
+        ~template_builder ();
+
+        // start building a template for this puzzle if we don't have one already.
+        // A job has one key, so its puzzle only changes if it gains or loses
+        // outputs, and then the template for its last puzzle is replaced.
+        void prepare (const digest256 &id, const Boost::puzzle &);
+
+        // return a template for this puzzle if one is ready.
+        ptr<const redeem_template> get (const digest256 &id, const Boost::puzzle &);
+
+        void remove (const digest256 &id);
+
+        // remove templates for all jobs that don't satisfy this.
+        void retain (function<bool (const digest256 &)>);
+
+    private:
+        payment Pay;
+        casual_random Random;
+
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        bool Stop;
+
+        // at most one of each per job.
+        std::list<std::pair<digest256, Boost::puzzle>> Pending;
+        std::map<digest256, ptr<const redeem_template>> Ready;
+
+        std::thread Builder;
+
+        void run ();
+    };
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef BOOSTMINER_SCHEDULER
+#define BOOSTMINER_SCHEDULER
+
+#include <jobs.hpp>
+
+namespace BoostPOW {
+
+    // What we know about our own mining and the other miners when deciding how to allocate threads.
+    struct market {
+        // measured hashes per second of one of our threads.
+        double ThreadHashrate {1 << 20};
+
+        // estimated hashes per second of everyone else working on a given bounty job.
+        double CompetitorHashrate {0};
+
+        // seconds of hashing a thread loses when its job is solved and it has to be reassigned.
+        double SwitchCost {.5};
+
+        // sats per byte that will be paid to redeem a job.
+        double FeeRate {.05};
+
+        // jobs below this sats/difficulty are not worked on.
+        double MinProfitability {0};
+    };
+
+    // expected hashes to solve a job.
+    double inline expected_hashes (const working &j) {
+        return j.difficulty () * 4294967296.;
+    }
+
+    // value of a job after the fee to redeem it.
+    double net_value (const working &, const market &);
+
+    // expected sats per second earned from a job if n of our threads work on it.
+    // Each solution costs every thread working on the job SwitchCost seconds, so
+    // piling threads onto a job that is solved quickly has diminishing returns.
+    double expected_revenue (const working &, uint32 threads, const market &);
+
+    // decides how many threads should be working on each job.
+    struct scheduling_policy {
+        virtual std::map<digest256, uint32> allocate (
+            const std::map<digest256, working> &, uint32 threads, const market &, random &) = 0;
+
+        // whether the allocation should be redone periodically even if nothing has changed.
+        virtual bool periodic () const {
+            return false;
+        }
+
+        virtual ~scheduling_policy () {}
+
+        static ptr<scheduling_policy> make (const string &name);
+    };
+
+    // the original strategy: each thread picks a job at random, weighted by profitability.
+    struct random_policy final : scheduling_policy {
+        double Tilt;
+        random_policy (double tilt = .025) : Tilt {tilt} {}
+
+        std::map<digest256, uint32> allocate (
+            const std::map<digest256, working> &, uint32 threads, const market &, random &) final override;
+
+        bool periodic () const final override {
+            return true;
+        }
+    };
+
+    // give each thread to the job where it adds the most expected revenue.
+    struct expected_value_policy final : scheduling_policy {
+        std::map<digest256, uint32> allocate (
+            const std::map<digest256, working> &, uint32 threads, const market &, random &) final override;
+    };
+
+}
+
+#endif
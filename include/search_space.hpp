@@ -0,0 +1,51 @@
+#ifndef BOOSTMINER_SEARCH_SPACE
+#define BOOSTMINER_SEARCH_SPACE
+
+#include <gigamonkey/work/solver.hpp>
+#include <cache_line.hpp>
+
+namespace BoostPOW {
+    using namespace Gigamonkey;
+
+    // The space of extra nonces is divided up so that no two threads ever
+    // search the same range, whether they are in one process or on many hosts.
+    //
+    //   extra nonce 1 is the worker id. By convention the high 16 bits are
+    //   the host and the low 16 bits are the process on that host.
+    //
+    //   extra nonce 2 is the thread number (high 16 bits) followed by a
+    //   counter (low 48 bits) that is advanced every time a range is claimed.
+    //
+    // One range is one value of extra nonce 2, over which every nonce is tried.
+    // The counter starts at the current time in seconds shifted left by 16 bits
+    // so that a restarted process does not repeat ranges that it searched before.
+    //
+    // Each mining thread has its own partition and advances it all the time.
+    struct alignas (cache_line) search_partition {
+
+        static uint32 worker_id (uint16 host, uint16 process) {
+            return (uint32 (host) << 16) | process;
+        }
+
+        search_partition (uint32 worker_id, uint16 thread);
+        search_partition (uint32 worker_id, uint16 thread, uint64 first);
+
+        Stratum::session_id ExtraNonce1;
+        uint16 Thread;
+
+        // claim the next range and return a solution at the beginning of it.
+        work::solution next (const work::puzzle &);
+
+        // number of ranges claimed so far.
+        uint64 claimed () const {
+            return Counter - First;
+        }
+
+    private:
+        uint64 First;
+        uint64 Counter;
+    };
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef BOOSTMINER_STRATUM
+#define BOOSTMINER_STRATUM
+
+#include <miner.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <deque>
+#include <optional>
+
+namespace BoostPOW {
+
+    // Messages of the Stratum protocol as used to hand out Boost puzzles.
+    // Every message is one JSON object on one line.
+    namespace stratum {
+
+        // size of extra nonce 2 in bytes.
+        constexpr uint32 extra_nonce_2_size = 8;
+
+        // a peer that sends a longer line than this is disconnected. A
+        // mining.notify carries a whole script, so this is generous.
+        constexpr size_t max_line_size = 1 << 20;
+
+        // about four seconds of work for a thread hashing at 2^20 hashes/second.
+        constexpr double default_share_difficulty = .001;
+
+        string write_uint32 (uint32);
+        maybe<uint32> read_uint32 (const JSON &);
+
+        // mining.notify parameters are
+        //   [job_id, content, header, body, merkle branch, category, target, ntime, clean, mask]
+        // Boost puzzles have no merkle branch, so it is always empty. The mask
+        // is an addition to standard Stratum for version 2 scripts.
+        JSON notify (const string &job_id, const work::puzzle &, Bitcoin::timestamp, bool clean);
+
+        struct job {
+            string ID;
+            work::puzzle Puzzle;
+            bool Clean;
+        };
+
+        maybe<job> read_notify (const JSON &params);
+
+        // mining.set_difficulty parameters are [difficulty]. Shares of the jobs
+        // that follow must be at least that difficult, or as difficult as the
+        // job itself if it is easier. Every share is sent to the server, which
+        // counts them to measure the worker's hashrate.
+        JSON set_difficulty (double);
+        maybe<double> read_set_difficulty (const JSON &params);
+
+        // the target that shares of a puzzle must meet. Never harder than the
+        // puzzle's own. A difficulty of zero means only solutions are shares.
+        uint256 share_target (const work::puzzle &, double share_difficulty);
+
+        // mining.submit parameters are
+        //   [worker, job_id, extra_nonce_2, ntime, nonce, bits]
+        // where bits is only present for version 2 scripts.
+        JSON submit (const string &worker, const string &job_id, const work::solution &);
+
+        struct share {
+            string Worker;
+            string JobID;
+            work::solution Solution;
+        };
+
+        // extra nonce 1 is not in the message. It was given to the worker by mining.subscribe.
+        maybe<share> read_submit (const JSON &params, Stratum::session_id extra_nonce_1);
+
+        JSON request (uint64 id, const string &method, JSON params);
+        JSON response (const JSON &id, JSON result);
+        JSON error (const JSON &id, int code, const string &message);
+
+    }
+
+    // Accepts Stratum connections and gives each of them to the manager as
+    // a miner. Every connection gets its own extra nonce 1, so that no two
+    // workers search the same space. Workers send shares at the given
+    // difficulty, which are counted as their hashes. Shares that also solve
+    // the Boost puzzle are given to the manager to be redeemed.
+    struct stratum_server : std::enable_shared_from_this<stratum_server> {
+
+        stratum_server (ptr<manager>, net::asio::io_context &, uint16 port, uint32 first_extra_nonce_1,
+            double share_difficulty = stratum::default_share_difficulty);
+
+        // begin accepting connections on the io_context.
+        void start ();
+
+        uint16 port () const {
+            return Acceptor.local_endpoint ().port ();
+        }
+
+        // shares accepted from every connection so far.
+        uint64 shares () const {
+            return Shares.load (std::memory_order_relaxed);
+        }
+
+    private:
+        struct connection;
+
+        ptr<manager> Manager;
+        net::asio::io_context &IO;
+        net::asio::ip::tcp::acceptor Acceptor;
+        uint32 NextExtraNonce1;
+
+        double ShareDifficulty;
+        std::atomic<uint64> Shares;
+
+        // solutions are redeemed here rather than on IO, which serves every
+        // connection, since a redeem waits for the broadcast.
+        boost::asio::thread_pool Redeeming;
+
+        void accept ();
+    };
+
+    // Connects to a Stratum server and mines whatever it is given with a
+    // pool of threads. The worker holds no keys. Solutions are sent back to
+    // the server, which redeems them.
+    struct stratum_worker {
+
+        // cpus gives the logical cpu for each thread, or -1 if it is not pinned.
+        stratum_worker (uint32 threads, std::vector<int32> cpus = {});
+        ~stratum_worker ();
+
+        // connect and mine until the connection is closed.
+        void run (const string &host, uint16 port, const string &name);
+
+        // close the connection, so that run returns. Any thread may call this once run has connected.
+        void stop ();
+
+    private:
+        struct assignment {
+            string JobID;
+            work::puzzle Puzzle;
+
+            // of shares, which is never harder than the puzzle's.
+            uint256 Target;
+
+            Stratum::session_id ExtraNonce1;
+
+            // the connection on which the job was given.
+            uint64 Session;
+
+            // when the mining.notify was read.
+            std::chrono::steady_clock::time_point Received;
+        };
+
+        std::mutex Mutex;
+        std::condition_variable In;
+        std::optional<assignment> Current;
+        bool Stop;
+
+        // incremented every time the assignment changes so that threads know to stop.
+        // Every thread reads it while it hashes.
+        alignas (cache_line) std::atomic<uint64> Epoch;
+
+        // the last epoch on which any thread started hashing.
+        alignas (cache_line) std::atomic<uint64> Started;
+
+        alignas (cache_line) std::atomic<uint64> Hashes;
+
+        // time from mining.notify to the first hash, in microseconds.
+        alignas (cache_line) uint64 LatencyCount;
+        double LatencyTotal;
+        double LatencyMax;
+
+        std::vector<std::thread> Threads;
+
+        // only touched on the IO thread.
+        net::asio::io_context IO;
+        std::optional<net::asio::ip::tcp::socket> Socket;
+        net::asio::streambuf Buffer;
+        std::deque<string> Outgoing;
+        string Name;
+        maybe<Stratum::session_id> ExtraNonce1;
+        uint64 NextRequest;
+
+        // from the last mining.set_difficulty. Zero until we are sent one.
+        double ShareDifficulty;
+
+        // counts connections. A solution found on an earlier one may still be
+        // queued on IO, and is dropped rather than sent to the server again.
+        uint64 Session;
+
+        void assign (std::optional<assignment>);
+        void mine (uint32 index, int32 cpu);
+        void started (uint64 epoch, std::chrono::steady_clock::time_point received);
+        void found (const assignment &, const work::solution &);
+
+        void send (const JSON &);
+        void write ();
+        void read ();
+        void handle (const JSON &);
+    };
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef BOOSTMINER_TRAFFIC
+#define BOOSTMINER_TRAFFIC
+
+#include <data/net/HTTP_client.hpp>
+#include <gigamonkey/types.hpp>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace BoostPOW {
+    using namespace Gigamonkey;
+
+    // Recordings of the traffic with the APIs, so that a slow refresh or a
+    // missed job can be reproduced offline and profiled as often as we like.
+    namespace traffic {
+
+        // an HTTP request and its response, or a websocket message.
+        struct exchange {
+            enum kind : byte {
+                http = 1,
+                websocket = 2
+            };
+
+            kind Kind {http};
+
+            // seconds from the start of the recording to when the request was made or the message arrived.
+            double Time {0};
+
+            // seconds until the response came.
+            double Duration {0};
+
+            string Method {};
+            string URL {};
+            string RequestBody {};
+
+            // zero if the request failed, in which case Error says why.
+            uint32 Status {0};
+            string Error {};
+
+            // for a websocket message, the message.
+            string Body {};
+
+            bool operator == (const exchange &) const = default;
+        };
+
+        // all numbers are little endian and strings are preceded by a uint32 size.
+        //   "BMTR" version
+        // followed by any number of
+        //   kind time duration method url request_body status error body
+        bytes write (const exchange &);
+        bytes write_header ();
+
+        // returns the exchanges read before the first one that is incomplete,
+        // so that a recording cut off by a crash can still be played back.
+        // Throws if the header is wrong.
+        std::vector<exchange> read (const byte *, size_t);
+
+        // read a whole recording from a file.
+        std::vector<exchange> load (const std::filesystem::path &);
+
+        // the file is gzipped, since it is mostly JSON. Every exchange is
+        // flushed as it is written.
+        struct recorder {
+            explicit recorder (const std::filesystem::path &);
+            ~recorder ();
+
+            void http (const net::HTTP::request &, const net::HTTP::response &,
+                std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+            void http_failed (const net::HTTP::request &, const string &error,
+                std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+            void websocket (const string &message);
+
+            uint64 count () const;
+
+        private:
+            mutable std::mutex Mutex;
+            void *File;
+            std::chrono::steady_clock::time_point Start;
+            uint64 Count;
+
+            void put (const exchange &);
+        };
+
+        // Serves a recording back. A request gets the responses recorded for
+        // the same method, URL and body in the order they were recorded; once
+        // those run out, the last one is repeated. Every response is delayed
+        // by as long as it originally took divided by the speed, and not at
+        // all if the speed is zero.
+        struct player {
+            explicit player (const std::filesystem::path &, double speed = 1);
+            player (std::vector<exchange>, double speed = 1);
+
+            net::HTTP::response operator () (const net::HTTP::request &);
+
+            // websocket messages in the order they arrived.
+            const std::vector<exchange> &messages () const {
+                return Messages;
+            }
+
+            // when a recorded event should happen, counting from the start of the replay.
+            std::chrono::duration<double> when (const exchange &x) const;
+
+            double Speed;
+
+        private:
+            std::mutex Mutex;
+            std::map<string, std::deque<exchange>> Responses;
+            std::vector<exchange> Messages;
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BOOSTMINER_WARM_START
+#define BOOSTMINER_WARM_START
+
+#include <jobs.hpp>
+#include <filesystem>
+
+namespace BoostPOW {
+
+    // What the miner knew when it last ran, so that a restart can begin
+    // hashing before the first call to the jobs API has returned, which
+    // takes a while since every job is checked. Private keys are not saved,
+    // only how many have been taken from the key source.
+    namespace warm_start {
+
+        struct state {
+            // seconds since the Unix epoch.
+            int64 Saved {0};
+            double FeeRate {0};
+            uint32 KeysDrawn {0};
+            jobs Jobs {};
+        };
+
+        // saved jobs older than this are not mined.
+        constexpr int64 max_age_seconds = 3600;
+
+        // all numbers are little endian.
+        //   "BMWS" version saved fee_rate keys_drawn scripts
+        // and then for every script
+        //   size script prevouts
+        // and for every prevout
+        //   txid index value
+        bytes write (const state &);
+        maybe<state> read (const byte *, size_t);
+
+        // the file is memory mapped. Nothing is returned if it is missing or can't be read.
+        maybe<state> load (const std::filesystem::path &);
+
+        // written to a temporary file first, so that a crash never leaves half a file.
+        void save (const std::filesystem::path &, const state &);
+
+    }
+
+}
+
+#endif
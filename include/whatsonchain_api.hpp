@@ -1,7 +1,7 @@
 #ifndef BOOSTMINER_WHATSONCHAIN_API
 #define BOOSTMINER_WHATSONCHAIN_API
 
-#include <data/net/HTTP_client.hpp>
+#include <connection_pool.hpp>
 #include <gigamonkey/address.hpp>
 
 using namespace Gigamonkey;
@@ -28,10 +28,10 @@ std::ostream inline &operator << (std::ostream &o, const UTXO &u) {
     return o << "UTXO {" << u.Outpoint << ", " << u.Value << ", " << u.Height << "}" << std::endl;
 }
 
-struct whatsonchain : net::HTTP::client_blocking {
-    whatsonchain (ptr<net::HTTP::SSL> ssl) :
-        net::HTTP::client_blocking {ssl, net::HTTP::REST {"https", "api.whatsonchain.com"}, tools::rate_limiter {3, 1}} {}
-    whatsonchain (): net::HTTP::client_blocking {net::HTTP::REST {"https", "api.whatsonchain.com"}, tools::rate_limiter {3, 1}} {}
+struct whatsonchain : BoostPOW::pooled_client {
+    whatsonchain (ptr<BoostPOW::connection_pool> pool, ptr<net::HTTP::SSL> ssl) :
+        BoostPOW::pooled_client {pool, ssl, net::HTTP::REST {"https", "api.whatsonchain.com"}, 3, 1} {}
+    whatsonchain (): BoostPOW::pooled_client {net::HTTP::REST {"https", "api.whatsonchain.com"}, 3, 1} {}
     
     struct addresses {
         struct balance {
@@ -70,7 +70,7 @@ struct whatsonchain : net::HTTP::client_blocking {
     
     struct scripts {
         
-        list<UTXO> get_unspent (const digest256& script_hash);
+        std::vector<UTXO> get_unspent (const digest256& script_hash);
         list<Bitcoin::txid> get_history (const digest256& script_hash);
         
         whatsonchain &API;
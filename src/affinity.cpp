@@ -0,0 +1,122 @@
+#include <affinity.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace BoostPOW::affinity {
+
+    maybe<mode> read_mode (const string &x) {
+        if (x == "off") return mode::off;
+        if (x == "cores") return mode::cores;
+        if (x == "smt") return mode::smt;
+        return {};
+    }
+
+    namespace {
+
+        int32 read_int (const std::filesystem::path &p) {
+            std::ifstream file {p};
+            int32 x;
+            if (!(file >> x)) return -1;
+            return x;
+        }
+
+    }
+
+    std::vector<cpu> topology () {
+        namespace fs = std::filesystem;
+
+        std::vector<cpu> cpus {};
+
+        std::error_code err;
+        for (const auto &entry : fs::directory_iterator {"/sys/devices/system/cpu", err}) {
+            string name = entry.path ().filename ().string ();
+            if (name.size () < 4 || name.rfind ("cpu", 0) != 0 ||
+                name.find_first_not_of ("0123456789", 3) != string::npos) continue;
+
+            // offline cpus have no topology.
+            if (!fs::exists (entry.path () / "topology" / "core_id", err)) continue;
+
+            cpu c {uint32 (std::stoul (name.substr (3))),
+                read_int (entry.path () / "topology" / "physical_package_id"),
+                read_int (entry.path () / "topology" / "core_id"), 0};
+
+            for (const auto &link : fs::directory_iterator {entry.path (), err}) {
+                string n = link.path ().filename ().string ();
+                if (n.size () > 4 && n.rfind ("node", 0) == 0 && n.find_first_not_of ("0123456789", 4) == string::npos)
+                    c.Node = int32 (std::stol (n.substr (4)));
+            }
+
+            cpus.push_back (c);
+        }
+
+        std::sort (cpus.begin (), cpus.end (), [] (const cpu &a, const cpu &b) {
+            return a.Logical < b.Logical;
+        });
+
+        return cpus;
+    }
+
+    plan place (const std::vector<cpu> &cpus, uint32 threads, mode m) {
+        plan p {std::vector<int32> (threads, -1), -1};
+        if (m == mode::off || cpus.size () == 0) return p;
+
+        // logical cpus grouped by physical core, in order of package and core.
+        std::map<std::pair<int32, int32>, std::vector<uint32>> by_core {};
+        for (const cpu &c : cpus) by_core[{c.Package, c.Core}].push_back (c.Logical);
+
+        std::vector<std::vector<uint32>> cores {};
+        for (auto &[_, logical] : by_core) {
+            std::sort (logical.begin (), logical.end ());
+            cores.push_back (logical);
+        }
+
+        auto slots_on = [m] (const std::vector<uint32> &core) -> size_t {
+            return m == mode::smt ? core.size () : 1;
+        };
+
+        size_t slots = 0;
+        for (const auto &core : cores) slots += slots_on (core);
+
+        // give the IO thread the last core if the mining threads fit on the others.
+        bool reserve = cores.size () > 1 && threads <= slots - slots_on (cores.back ());
+        if (reserve) {
+            p.IO = int32 (cores.back ().front ());
+            cores.pop_back ();
+        }
+
+        // first siblings of every core, then second siblings, and so on.
+        std::vector<int32> order {};
+        for (size_t rank = 0; order.size () < threads; rank++) {
+            bool any = false;
+            for (const auto &core : cores) if (rank < slots_on (core) && rank < core.size ()) {
+                order.push_back (int32 (core[rank]));
+                any = true;
+            }
+
+            if (!any) break;
+        }
+
+        for (size_t i = 0; i < threads && i < order.size (); i++) p.Mining[i] = order[i];
+        return p;
+    }
+
+    bool pin (int32 logical) {
+        if (logical < 0) return false;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        CPU_SET (logical, &set);
+        return pthread_setaffinity_np (pthread_self (), sizeof (cpu_set_t), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+}
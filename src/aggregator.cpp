@@ -0,0 +1,155 @@
+#include <aggregator.hpp>
+#include <miner.hpp>
+#include <logger.hpp>
+#include <gigamonkey/fees.hpp>
+#include <gigamonkey/incomplete.hpp>
+#include <gigamonkey/script/pattern/pay_to_address.hpp>
+#include <cmath>
+
+namespace BoostPOW {
+
+    uint64 aggregator::overhead () {
+        return estimate_size (0, pay_to_address::script (digest160 {}).size ());
+    }
+
+    Bitcoin::transaction aggregator::redeem (const std::vector<entry> &entries, const bytes &pay_script, double fee_rate) {
+        if (entries.size () == 0) throw data::exception {"nothing to redeem"};
+
+        list<transaction_design::input> inputs {};
+
+        // what goes into each input script, in the same order as the inputs.
+        struct signer {
+            Bitcoin::secret Key;
+            work::solution Solution;
+            Boost::type Type;
+        };
+
+        list<signer> signers {};
+
+        Bitcoin::satoshi value {0};
+        uint64 inputs_size {0};
+
+        for (const entry &e : entries) {
+            uint64 input_size = e.Puzzle.expected_size () / data::size (e.Puzzle.Prevouts);
+            Boost::type type = Boost::output_script::type (e.Puzzle.Script);
+
+            for (const auto &p : e.Puzzle.Prevouts.values ()) {
+                inputs <<= transaction_design::input (static_cast<Bitcoin::prevout> (p), input_size);
+                signers <<= signer {e.Puzzle.Key, e.Solution, type};
+                value += p.value ();
+            }
+
+            inputs_size += e.Puzzle.expected_size ();
+        }
+
+        Bitcoin::satoshi fee {int64 (std::ceil (fee_rate * estimate_size (inputs_size, pay_script.size ())))};
+        if (fee > value) throw data::exception {"Cannot pay tx fee with boost outputs"};
+
+        transaction_design tx {1, inputs, {Bitcoin::output {value - fee, pay_script}}, 0};
+
+        Bitcoin::incomplete::transaction incomplete (tx);
+
+        return incomplete.complete (
+            data::map_thread ([] (const signer &s, const Bitcoin::sighash::document &doc) -> bytes {
+                return Boost::input_script::make (
+                    s.Key.sign (doc), s.Key.to_public (), s.Solution, s.Type, bool (s.Solution.Share.Bits)).write ();
+            }, signers, tx.documents ()));
+    }
+
+    aggregator::aggregator (
+        double window_seconds,
+        uint32 max_entries,
+        fees &f,
+        function<bytes ()> pay_script,
+        function<void (const bytes &)> broadcast) :
+        Window {window_seconds}, MaxEntries {max_entries}, Fees {f},
+        PayScript {pay_script}, Broadcast {broadcast},
+        Mutex {}, Wake {}, Waiting {}, Opened {}, Stop {false},
+        Thread {[this] () {
+            run ();
+        }} {}
+
+    aggregator::~aggregator () {
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            Stop = true;
+        }
+
+        Wake.notify_all ();
+        Thread.join ();
+    }
+
+    void aggregator::add (entry e) {
+        std::unique_lock<std::mutex> lock (Mutex);
+        if (Waiting.size () == 0) Opened = std::chrono::steady_clock::now ();
+        Waiting.push_back (std::move (e));
+        Wake.notify_all ();
+    }
+
+    void aggregator::run () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        while (true) {
+            if (Waiting.size () == 0) {
+                if (Stop) return;
+                Wake.wait (lock);
+                continue;
+            }
+
+            auto deadline = Opened + std::chrono::duration_cast<std::chrono::steady_clock::duration> (Window);
+            if (!Stop && Waiting.size () < MaxEntries && std::chrono::steady_clock::now () < deadline) {
+                Wake.wait_until (lock, deadline);
+                continue;
+            }
+
+            std::vector<entry> ready = std::move (Waiting);
+            Waiting.clear ();
+
+            lock.unlock ();
+            redeem (std::move (ready));
+            lock.lock ();
+        }
+    }
+
+    void aggregator::redeem (std::vector<entry> entries) {
+        try {
+            bytes tx = bytes (redeem (entries, PayScript (), Fees.get ()));
+
+            logger::log ("job.complete.transaction", JSON {
+                {"txid", BoostPOW::write (Bitcoin::txid {Hash256 (tx)})},
+                {"puzzles", entries.size ()},
+                {"txhex", encoding::hex::write (tx)}
+            });
+
+            Broadcast (tx);
+            return;
+        } catch (const std::exception &x) {
+            logger::log (logger::warning, "aggregator.failed", JSON {
+                {"puzzles", entries.size ()},
+                {"error", x.what ()}
+            });
+        }
+
+        // if the puzzles can't be redeemed together, try them separately.
+        for (const entry &e : entries) try {
+            bytes pay_script = PayScript ();
+            auto value = e.Puzzle.value ();
+            Bitcoin::satoshi fee {int64 (std::ceil (Fees.get () * estimate_size (e.Puzzle.expected_size (), pay_script.size ())))};
+            if (fee > value) throw data::exception {"Cannot pay tx fee with boost output"};
+
+            bytes tx = bytes (redeem_puzzle (e.Puzzle, e.Solution, {Bitcoin::output {value - fee, pay_script}}));
+
+            logger::log ("job.complete.transaction", JSON {
+                {"txid", BoostPOW::write (Bitcoin::txid {Hash256 (tx)})},
+                {"txhex", encoding::hex::write (tx)}
+            });
+
+            Broadcast (tx);
+        } catch (const std::exception &x) {
+            logger::log (logger::error, "aggregator.failed", JSON {
+                {"script_hash", BoostPOW::write (e.Puzzle.id ())},
+                {"error", x.what ()}
+            });
+        }
+    }
+
+}
@@ -0,0 +1,181 @@
+#include <autotune.hpp>
+#include <logger.hpp>
+#include <governor.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace BoostPOW::autotune {
+
+    configuration::operator JSON () const {
+        return JSON {
+            {"backend", Backend},
+            {"threads", Threads},
+            {"hashrate", Hashrate}
+        };
+    }
+
+    maybe<configuration> configuration::read (const JSON &j) {
+        if (!j.is_object () || !j.contains ("backend") || !j["backend"].is_string () ||
+            !j.contains ("threads") || !j["threads"].is_number_unsigned () ||
+            !j.contains ("hashrate") || !j["hashrate"].is_number ()) return {};
+
+        configuration x {string (j["backend"]), uint32 (j["threads"]), double (j["hashrate"])};
+        if (x.Backend != "cpu" || x.Threads == 0) return {};
+        return x;
+    }
+
+    string cpu_model () {
+        string model {"unknown"};
+
+        std::ifstream cpuinfo {"/proc/cpuinfo"};
+        string line;
+        while (std::getline (cpuinfo, line)) if (line.rfind ("model name", 0) == 0) {
+            auto colon = line.find (':');
+            if (colon != string::npos && colon + 2 <= line.size ()) model = line.substr (colon + 2);
+            break;
+        }
+
+        // virtual machines with the same processor may be given different numbers of cores.
+        return model + " x" + std::to_string (std::thread::hardware_concurrency ());
+    }
+
+    std::filesystem::path default_cache () {
+        if (const char *xdg = std::getenv ("XDG_CACHE_HOME"); xdg != nullptr && *xdg != 0)
+            return std::filesystem::path {xdg} / "boostminer" / "tune.json";
+
+        if (const char *home = std::getenv ("HOME"); home != nullptr && *home != 0)
+            return std::filesystem::path {home} / ".cache" / "boostminer" / "tune.json";
+
+        return std::filesystem::path {"boostminer_tune.json"};
+    }
+
+    namespace {
+
+        // a puzzle that will not be solved while we are measuring.
+        work::puzzle calibration_puzzle () {
+            work::puzzle p {};
+            p.Candidate.Category = 0;
+            p.Candidate.Digest = uint256 {};
+            p.Candidate.Target = work::compact {work::difficulty {1e12}};
+            p.Header = bytes (32);
+            p.Body = bytes (32);
+            p.Mask = -1;
+            return p;
+        }
+
+    }
+
+    double measure (uint32 threads, double seconds) {
+        work::puzzle p = calibration_puzzle ();
+
+        std::atomic<uint64> hashes {0};
+        std::atomic<uint64> epoch {0};
+
+        auto begin = std::chrono::steady_clock::now ();
+
+        std::vector<std::thread> workers {};
+        for (uint32 i = 0; i < threads; i++) workers.emplace_back ([&p, &hashes, &epoch, i] () {
+            search_partition s {0, uint16 (i)};
+            while (epoch.load () == 0) cpu_solve (p, s.next (p), 3600, &hashes, &epoch);
+        });
+
+        std::this_thread::sleep_for (std::chrono::duration<double> (seconds));
+        epoch++;
+
+        for (std::thread &t : workers) t.join ();
+
+        // threads stop within 2^16 hashes of being told, so this is a slight overestimate.
+        return hashes.load () / std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+    }
+
+    configuration calibrate (double seconds_per_trial) {
+        // only as many as the cgroup lets us use.
+        uint32 cores = governor::detect ().threads ();
+
+        std::vector<uint32> trials {};
+        for (uint32 n = 1; n < cores; n *= 2) trials.push_back (n);
+        // with SMT, the last few logical cores may or may not help.
+        if (cores > 2 && cores % 2 == 0 && trials.back () != cores / 2) trials.push_back (cores / 2);
+        trials.push_back (cores);
+
+        configuration best {};
+        for (uint32 n : trials) {
+            double rate = measure (n, seconds_per_trial);
+
+            logger::log ("autotune.trial", JSON {
+                {"backend", best.Backend},
+                {"threads", n},
+                {"hashrate", rate}
+            });
+
+            // more threads must be clearly better to be worth taking cores away from everything else.
+            if (rate > best.Hashrate * 1.02) {
+                best.Threads = n;
+                best.Hashrate = rate;
+            }
+        }
+
+        return best;
+    }
+
+    namespace {
+
+        JSON read_cache (const std::filesystem::path &path) {
+            std::ifstream file {path};
+            if (!file) return JSON::object ();
+
+            std::stringstream ss;
+            ss << file.rdbuf ();
+
+            try {
+                JSON j = JSON::parse (ss.str ());
+                if (j.is_object ()) return j;
+            } catch (const JSON::exception &) {}
+
+            // a damaged cache is ignored and will be overwritten.
+            return JSON::object ();
+        }
+
+    }
+
+    maybe<configuration> cached (const std::filesystem::path &path, const string &model) {
+        JSON j = read_cache (path);
+        if (!j.contains (model)) return {};
+        return configuration::read (j[model]);
+    }
+
+    void save (const std::filesystem::path &path, const string &model, const configuration &x) {
+        JSON j = read_cache (path);
+        j[model] = JSON (x);
+
+        std::error_code err;
+        if (path.has_parent_path ()) std::filesystem::create_directories (path.parent_path (), err);
+
+        std::ofstream file {path};
+        if (!file) throw data::exception {} << "could not write " << path.string ();
+        file << j.dump (2) << std::endl;
+    }
+
+    configuration tuned (const std::filesystem::path &path, double seconds_per_trial) {
+        string model = cpu_model ();
+
+        if (auto x = cached (path, model); bool (x)) {
+            logger::log ("autotune.cached", JSON {{"cpu", model}, {"configuration", JSON (*x)}});
+            return *x;
+        }
+
+        std::cout << "calibrating for " << model << "; this takes a few seconds." << std::endl;
+        configuration x = calibrate (seconds_per_trial);
+        logger::log ("autotune.calibrated", JSON {{"cpu", model}, {"configuration", JSON (x)}});
+
+        try {
+            save (path, model, x);
+        } catch (const data::exception &e) {
+            logger::log (logger::warning, "autotune.save_failed", JSON {{"error", e.what ()}});
+        }
+
+        return x;
+    }
+
+}
@@ -1,8 +1,14 @@
 #include <ctime>
 #include <logger.hpp>
 #include <network.hpp>
+#include <fee_oracle.hpp>
 #include <miner.hpp>
+#include <engine.hpp>
 #include <miner_options.hpp>
+#include <stratum.hpp>
+#include <autotune.hpp>
+#include <control.hpp>
+#include <governor.hpp>
 #include <gigamonkey/p2p/var_int.hpp>
 #include <gigamonkey/script/pattern/pay_to_address.hpp>
 #include <gigamonkey/script/typed_data_bip_276.hpp>
@@ -96,52 +102,33 @@ int spend (const BoostPOW::script_options &options) {
     return 0;
 }
 
-struct redeemer final : BoostPOW::redeemer, BoostPOW::multithreaded {
-    BoostPOW::network &Net;
-    BoostPOW::fees &Fees;
-    digest160 Address;
-    
-    redeemer (
-        BoostPOW::network &net, 
-        BoostPOW::fees &fees, 
-        const digest160 &address,
-        uint32 threads, uint64 random_seed) : 
-        Net {net}, Fees {fees}, Address {address},
-        BoostPOW::redeemer {}, BoostPOW::multithreaded {threads, random_seed} {
-        this->start_threads ();
-    }
-    
-    void submit (const std::pair<digest256, Boost::puzzle> &puzzle, const work::solution &solution) final override {
-        
-        double fee_rate {Fees.get ()};
-        
-        auto value = puzzle.second.value ();
-        bytes pay_script = pay_to_address::script (Address);
-        auto expected_inputs_size = puzzle.second.expected_size ();
-        auto estimated_size = BoostPOW::estimate_size (expected_inputs_size, pay_script.size ());
+// the number of threads given, or the best number for this machine if threads=auto.
+uint32 threads (uint32 given, bool automatic, const string &tune_cache) {
+    uint32 wanted = !automatic ? given : BoostPOW::autotune::tuned (tune_cache == "" ?
+        BoostPOW::autotune::default_cache () :
+        std::filesystem::path {tune_cache}).Threads;
 
-        Bitcoin::satoshi fee {int64 (ceil (fee_rate * estimated_size))};
-        
-        if (fee > value) throw data::exception {"Cannot pay tx fee with boost output"};
-        
-        auto redeem_tx = BoostPOW::redeem_puzzle (puzzle.second, solution, {Bitcoin::output {value - fee, pay_script}});
-        
-        logger::log ("job.complete.transaction", JSON {
-            {"txid", BoostPOW::write (redeem_tx.id ())},
-            {"txhex", encoding::hex::write (bytes (redeem_tx))}
-        });
-        
-        if (!Net.broadcast (bytes (redeem_tx))) std::cout << "broadcast failed!" << std::endl;
-        
-        std::unique_lock<std::mutex> lock (BoostPOW::redeemer::Mutex);
-        Solved = true;
-        Last = std::pair<digest256, Boost::puzzle> {};
-        std::cout << "about to close channel" << std::endl;
-        this->close ();
+    // more threads than the cgroup lets us run only get us throttled.
+    auto limits = BoostPOW::governor::detect ();
+    uint32 allowed = limits.threads ();
+    if (wanted <= allowed) return wanted;
 
-        Out.notify_one ();
-    }
-};
+    JSON limited {{"wanted", wanted}, {"threads", allowed}, {"cpus", limits.CPUs}};
+    if (bool (limits.Quota)) limited["quota"] = *limits.Quota;
+    logger::log (logger::warning, "governor.limited", limited);
+
+    return allowed;
+}
+
+// where to pin mining threads and the IO thread.
+BoostPOW::affinity::plan placement (uint32 threads, BoostPOW::affinity::mode m) {
+    auto p = BoostPOW::affinity::place (BoostPOW::affinity::topology (), threads, m);
+    if (m != BoostPOW::affinity::mode::off) logger::log ("affinity.placed", JSON {
+        {"mining", p.Mining},
+        {"io", p.IO}
+    });
+    return p;
+}
 
 int redeem (
     const Bitcoin::outpoint &outpoint,
@@ -149,9 +136,7 @@ int redeem (
     int64 value,
     const BoostPOW::redeeming_options &options) {
 
-    BoostPOW::network Net = (options.APIHost) ?
-        BoostPOW::network {*options.APIHost} :
-        BoostPOW::network {};
+    BoostPOW::network Net {options.APIHosts};
 
     Boost::candidate Job {};
 
@@ -189,7 +174,7 @@ int redeem (
     
     BoostPOW::fees *Fees = bool (options.FeeRate) ?
         (BoostPOW::fees *) (new BoostPOW::given_fees (*options.FeeRate)) :
-        (BoostPOW::fees *) (new BoostPOW::network_fees (Net));
+        (BoostPOW::fees *) (new BoostPOW::fee_oracle (options.MAPIHosts, options.FeeQuoteInterval));
 
     auto key = options.SigningKeys->next ();
     auto address = options.ReceivingAddresses->next ();
@@ -203,29 +188,71 @@ int redeem (
       {"recipient", string (address)}
     });
     
-    redeemer r {Net, *Fees, address.Digest, options.Threads,
-        std::chrono::system_clock::now ().time_since_epoch ().count () * 5090567 + 337};
-    
-    r.mine ({Job.id (), Boost::puzzle {Job, key}});
-    
-    r.wait_for_shutdown ();
+    BoostPOW::governor::set_duty_cycle (options.DutyCycle);
+    uint32 redeem_threads = threads (options.Threads, options.AutoThreads, options.TuneCache);
+
+    Boost::puzzle puzzle {Job, key};
+
+    auto result = BoostPOW::engine {redeem_threads, options.WorkerID,
+        placement (redeem_threads, options.Affinity).Mining}.submit (work::puzzle (puzzle)).get ();
+
+    if (result.Status != BoostPOW::engine::result::solved) throw data::exception {"mining stopped without a solution"};
+
+    // an easy job may be solved before the first quote comes back. There is
+    // only one transaction to pay for, so we wait a little rather than pay the default.
+    if (auto oracle = dynamic_cast<BoostPOW::fee_oracle *> (Fees); oracle != nullptr && !oracle->wait_for_quote (std::chrono::seconds {15}))
+        logger::log (logger::warning, "fee.quote.missing", JSON {{"fee_rate", oracle->get ()}});
+
+    double fee_rate {Fees->get ()};
     delete Fees;
+
+    bytes pay_script = pay_to_address::script (address.Digest);
+    Bitcoin::satoshi fee {int64 (ceil (fee_rate * BoostPOW::estimate_size (puzzle.expected_size (), pay_script.size ())))};
+
+    if (fee > value) throw data::exception {"Cannot pay tx fee with boost output"};
+
+    auto redeem_tx = BoostPOW::redeem_puzzle (puzzle, result.Proof.Solution, {Bitcoin::output {value - fee, pay_script}});
+
+    logger::log ("job.complete.transaction", JSON {
+        {"txid", BoostPOW::write (redeem_tx.id ())},
+        {"txhex", encoding::hex::write (bytes (redeem_tx))}
+    });
+
+    if (!Net.broadcast (bytes (redeem_tx))) std::cout << "broadcast failed!" << std::endl;
     return 0;
 }
 
-struct manager : BoostPOW::manager {
+struct manager : BoostPOW::manager, BoostPOW::controllable {
     
-    struct local_redeemer final : BoostPOW::manager::redeemer, BoostPOW::channel {
+    struct local_redeemer final : BoostPOW::manager::redeemer {
         std::thread Worker;
+
+        // the thread takes its jobs straight from the redeemer.
+        void pose (const work::puzzle &) final override {}
+        work::puzzle select () final override {
+            auto j = job ();
+            return j == nullptr ? work::puzzle {} : j->Work;
+        }
+
         local_redeemer (
             manager *m, 
-            uint64 random_seed, uint32 index) : 
+            uint32 worker_id, uint32 index, int32 cpu) : 
             manager::redeemer {m},
-            BoostPOW::channel {},
-            Worker {std::thread {BoostPOW::mining_thread,
-                &static_cast<work::selector &> (*this),
-                new BoostPOW::casual_random {random_seed}, index}} {}
+            Worker {[this, worker_id, index, cpu] () {
+                BoostPOW::affinity::pin (cpu);
+                // created after pinning so that it is on this thread's NUMA node.
+                BoostPOW::redeeming_thread (static_cast<BoostPOW::redeemer *> (this),
+                    new BoostPOW::search_partition {worker_id, uint16 (index)}, index, &this->Hashes);
+            }} {}
+
+        ~local_redeemer () {
+            stop ();
+            Worker.join ();
+        }
     };
+
+    uint32 WorkerID;
+    BoostPOW::affinity::mode Affinity;
         
     manager (
         BoostPOW::network &net, 
@@ -235,12 +262,67 @@ struct manager : BoostPOW::manager {
         uint64 random_seed, 
         double maximum_difficulty, 
         double minimum_profitability, 
-        uint64 min_value, int threads):
-        BoostPOW::manager {net, f, keys, addresses, random_seed, maximum_difficulty, minimum_profitability, min_value} {
+        uint64 min_value, uint32 worker_id,
+        // the logical cpu for each thread, or -1 if it is not pinned.
+        const std::vector<int32> &cpus,
+        // used to place threads that are added later.
+        BoostPOW::affinity::mode affinity,
+        ptr<BoostPOW::scheduling_policy> policy,
+        double competitor_hashrate,
+        double micro_job_seconds,
+        double aggregate_seconds):
+        BoostPOW::manager {net, f, keys, addresses, random_seed, maximum_difficulty,
+            minimum_profitability, min_value, policy, competitor_hashrate, micro_job_seconds, aggregate_seconds},
+        WorkerID {worker_id}, Affinity {affinity} {
         
-        std::cout << "starting " << threads << " threads." << std::endl;
-        for (int i = 1; i <= threads; i++) 
-            this->add_new_miner (ptr<BoostPOW::manager::redeemer> {new local_redeemer (this, random_seed + i, i)});
+        std::cout << "starting " << cpus.size () << " threads." << std::endl;
+        for (int i = 1; i <= cpus.size (); i++) 
+            this->add_new_miner (ptr<BoostPOW::manager::redeemer> {new local_redeemer (this, worker_id, i, cpus[i - 1])});
+    }
+
+    uint32 threads () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        return Redeemers.size ();
+    }
+
+    // only called from the IO thread, so nobody else changes the number of threads meanwhile.
+    void set_threads (uint32 n) final override {
+        uint32 current = threads ();
+        if (current == n) return;
+
+        logger::log ("control.threads", JSON {{"from", current}, {"to", n}});
+
+        if (current < n) {
+            auto place = BoostPOW::affinity::place (BoostPOW::affinity::topology (), n, Affinity);
+            for (uint32 i = current + 1; i <= n; i++)
+                this->add_new_miner (ptr<BoostPOW::manager::redeemer> {new local_redeemer (this, WorkerID, i, place.Mining[i - 1])});
+            return;
+        }
+
+        for (uint32 i = current; i > n; i--) {
+            ptr<BoostPOW::manager::redeemer> last;
+            {
+                std::unique_lock<std::mutex> lock (Mutex);
+                last = Redeemers.back ();
+            }
+
+            this->remove_miner (last);
+            // the thread is joined here, outside the lock, since it may be waiting for it.
+        }
+    }
+
+    void pause (bool paused) final override {
+        BoostPOW::manager::pause (paused);
+    }
+
+    void set_filters (maybe<double> minimum_profitability, maybe<double> maximum_difficulty) final override {
+        BoostPOW::manager::set_filters (
+            bool (minimum_profitability) ? *minimum_profitability : MinProfitability,
+            bool (maximum_difficulty) ? *maximum_difficulty : MaxDifficulty);
+    }
+
+    JSON status () final override {
+        return BoostPOW::manager::status ();
     }
 };
 
@@ -248,23 +330,108 @@ int mine (const BoostPOW::mining_options &options) {
     
     std::cout << "about to start running" << std::endl;
 
-    BoostPOW::network Net = (options.APIHost) ?
-        BoostPOW::network {*options.APIHost} :
-        BoostPOW::network {};
+    // these are logged every time a thread is reassigned.
+    logger::limit ("job.selected", 10);
+    logger::limit ("worker.resting", 10);
+    logger::limit ("micro_batch.assigned", 10);
+    logger::limit ("micro_batch.solved", 10);
 
-    BoostPOW::fees *Fees = bool (options.FeeRate) ?
-        (BoostPOW::fees *) (new BoostPOW::given_fees (*options.FeeRate)) :
-        (BoostPOW::fees *) (new BoostPOW::network_fees (Net));
+    BoostPOW::network Net {options.APIHosts};
+    if (options.Record != "") Net.record (options.Record);
+    if (options.Replay != "") Net.replay (options.Replay, options.ReplaySpeed);
+
+    // fee quotes are not recorded, so a replay uses the given fee rate or the default.
+    BoostPOW::fees *Fees = bool (options.FeeRate) || options.Replay != "" ?
+        (BoostPOW::fees *) (new BoostPOW::given_fees (options.FeeRate ? *options.FeeRate : BoostPOW::fee_oracle::default_fee_rate)) :
+        (BoostPOW::fees *) (new BoostPOW::fee_oracle (options.MAPIHosts, options.FeeQuoteInterval));
     
-    std::make_shared<manager> (Net, *Fees, *options.SigningKeys, *options.ReceivingAddresses,
+    BoostPOW::governor::set_duty_cycle (options.DutyCycle);
+    auto place = placement (threads (options.Threads, options.AutoThreads, options.TuneCache), options.Affinity);
+    
+    auto m = std::make_shared<manager> (Net, *Fees, *options.SigningKeys, *options.ReceivingAddresses,
         std::chrono::system_clock::now ().time_since_epoch ().count () * 5090567 + 337,
         options.MaxDifficulty, options.MinProfitability, options.MinValue, 
-        options.Threads)->run (options.Websockets, options.RefreshInterval);
+        options.WorkerID, place.Mining, options.Affinity,
+        BoostPOW::scheduling_policy::make (options.Policy),
+        options.CompetitorHashrate, options.MicroJobSeconds,
+        options.AggregateSeconds);
+
+    // the IO thread is this one. It is pinned only after the mining threads
+    // have started so that they don't inherit its affinity.
+    BoostPOW::affinity::pin (place.IO);
+
+    ptr<BoostPOW::control_server> control {};
+    if (options.ControlSocket != "") {
+        control = std::make_shared<BoostPOW::control_server> (*m, Net.IO, options.ControlSocket);
+        control->start ();
+    }
+
+    if (options.PublishJobs != "") m->share_jobs (options.PublishJobs, true);
+    else if (options.JobBoard != "") m->share_jobs (options.JobBoard, false);
+
+    // hash the jobs we had last time while the API is called.
+    if (options.WarmStart != "")
+        if (auto saved = BoostPOW::warm_start::load (options.WarmStart); bool (saved)) {
+            if (auto oracle = dynamic_cast<BoostPOW::fee_oracle *> (Fees); oracle != nullptr) oracle->seed (saved->FeeRate);
+            m->restore (*saved);
+        }
+
+    m->run (options.Websockets, options.RefreshInterval, options.WarmStart);
+
+    // run only returns if we were told to stop. The threads must be done before the fees go.
+    m->set_threads (0);
     
     delete Fees;
     return 0;
 }
 
+int worker (const BoostPOW::worker_options &options) {
+
+    logger::limit ("stratum.notify_latency", 10);
+    logger::limit ("stratum.found", 10);
+
+    BoostPOW::governor::set_duty_cycle (options.DutyCycle);
+    uint32 worker_threads = threads (options.Threads, options.AutoThreads, options.TuneCache);
+
+    std::cout << "starting " << worker_threads << " threads." << std::endl;
+
+    auto place = placement (worker_threads, options.Affinity);
+
+    BoostPOW::stratum_worker w {worker_threads, place.Mining};
+
+    // after the mining threads have started so that they don't inherit this affinity.
+    BoostPOW::affinity::pin (place.IO);
+
+    // keep mining for the same server if the connection is lost.
+    while (true) {
+        try {
+            w.run (options.Host, options.Port, options.Name);
+        } catch (const std::exception &x) {
+            std::cout << "Stratum connection problem: " << x.what () << std::endl;
+        }
+
+        std::cout << "reconnecting to " << options.Host << ":" << options.Port << " in 10 seconds." << std::endl;
+        std::this_thread::sleep_for (std::chrono::seconds (10));
+    }
+
+    return 0;
+}
+
+int tune (const BoostPOW::tuning_options &options) {
+    std::filesystem::path cache = options.TuneCache == "" ?
+        BoostPOW::autotune::default_cache () :
+        std::filesystem::path {options.TuneCache};
+
+    string model = BoostPOW::autotune::cpu_model ();
+    std::cout << "calibrating for " << model << std::endl;
+
+    auto best = BoostPOW::autotune::calibrate (options.Seconds);
+    BoostPOW::autotune::save (cache, model, best);
+
+    std::cout << "best is " << best.Threads << " threads at " << best.Hashrate << " hashes/second; saved to " << cache.string () << std::endl;
+    return 0;
+}
+
 const char version_string[] = "BoostMiner 0.2.6";
 
 int version () {
@@ -279,6 +446,8 @@ int help () {
         "\n\tspend      -- create a Boost script."
         "\n\tredeem     -- mine and redeem an existing boost output."
         "\n\tmine       -- call the pow.co API to get jobs to mine."
+        "\n\tworker     -- get jobs from a Stratum server such as BoostStratum. No keys are needed."
+        "\n\ttune       -- find the best number of threads for this machine and remember it."
         "\nFor method \"spend\" provide the following as options or as arguments in order "
         "\n\tcontent    -- hex for correct order, hexidecimal for reversed."
         "\n\tdifficulty -- a positive number."
@@ -297,22 +466,48 @@ int help () {
         "\n\tkey        -- WIF or HD private key that will be used to redeem outputs."
         "\n\taddress    -- (optional) your address where you will put the redeemed sats."
         "\n\t              If not provided, addresses will be generated from the key. " 
+        "\nFor method \"worker\", provide the following as an option or as an argument"
+        "\n\tstratum    -- host:port of the Stratum server."
+        "\nadditional available options for worker are threads, affinity, duty_cycle and "
+        "\n\tname       -- the name given to the server. Default is BoostMiner."
+        "\nFor method \"tune\", available options are tune_cache and "
+        "\n\tseconds    -- how long to measure each number of threads. Default is 3."
         "\nadditional available options for redeem and mine are "
-        "\n\tapi_host          -- Host to call for Boost API. Default is pow.co"
-        "\n\tthreads           -- Number of threads to mine with. Default is 1."
+        "\n\tapi_host          -- Comma-separated hosts for the Boost API. Reads are hedged to the others. Default is pow.co"
+        "\n\tthreads           -- Number of threads to mine with, or auto to use the tuned number. Default is 1."
+        "\n\ttune_cache        -- where tuning results are kept. Default is ~/.cache/boostminer/tune.json"
+        "\n\taffinity          -- off (default), cores to pin one thread per physical core, or smt to use siblings too."
+        "\n\tduty_cycle        -- fraction of the time that threads hash, more than 0 and at most 1. Default is 1."
+        "\n\tworker_id         -- host.process, so that machines mining the same job search different nonces."
         "\n\tmin_profitability -- Boost jobs with less than this sats/difficulty will be ignored."
         "\n\tmax_difficulty    -- Boost jobs above this difficulty will be ignored."
         "\n\tfee_rate          -- Sats per byte of the final transaction."
         "\n\t                     If not provided we get a fee quote from Gorilla Pool."
+        "\n\tmapi_hosts        -- Comma-separated MAPI hosts to get fee quotes from. The median quote is used."
+        "\n\tfee_quote_interval -- Seconds between fee quotes. Default is 300."
         "\nadditional available options for mine are " <<
         "\n\tmin_value         -- minimum value of a Boost output to bother mining." <<
         "\n\twebsocket         -- use the websockets protocol if set." <<
-        "\n\trefresh_interval  -- how often to call the API for new jobs." << std::endl;
+        "\n\trefresh_interval  -- how often to call the API for new jobs." <<
+        "\n\tpolicy            -- how to allocate threads to jobs: expected_value (default) or random." <<
+        "\n\tcompetitor_hashrate -- initial estimate of other miners' hashes/second on bounty jobs." <<
+        "\n\tmicro_job_seconds -- jobs expected to take less than this on one thread are solved in batches." <<
+        "\n\taggregate_seconds -- solved jobs may wait this long to be redeemed together in one transaction." <<
+        "\n\tcontrol           -- path of a Unix socket to control the miner while it runs." <<
+        "\n\twarm_start        -- file in which to keep jobs between runs, so that mining starts right away." <<
+        "\n\trecord            -- file to which to write all API traffic, for profiling later." <<
+        "\n\treplay            -- file of API traffic to play back instead of calling the APIs. Nothing is broadcast." <<
+        "\n\treplay_speed      -- how many times faster to play back traffic. 0 means without waiting. Default is 1." <<
+        "\n\tpublish_jobs      -- name of a job board in shared memory to which to publish the jobs from the API." <<
+        "\n\tjob_board         -- name of a job board to read jobs from instead of calling the jobs API." <<
+        "\nadditional available options for all methods are " <<
+        "\n\tlog_level         -- trace, debug, info, warning, error, or off. Default is info." <<
+        "\n\tlog_format        -- JSON or binary (length-prefixed CBOR). Default is JSON." << std::endl;
 
     return 0;
 }
 
 int main (int arg_count, char **arg_values) {
-    return BoostPOW::run (argh::parser (arg_count, arg_values), help, version, spend, redeem, mine);
+    return BoostPOW::run (argh::parser (arg_count, arg_values), help, version, spend, redeem, mine, worker, tune);
 }
 
@@ -1,38 +1,82 @@
 #include <stratum.hpp>
-#include <boost/program_options.hpp>
+#include <miner_options.hpp>
+#include <fee_oracle.hpp>
+#include <logger.hpp>
+#include <argh.h>
 
-int command_connect (int arg_count, char** arg_values) {
-    throw data::exception {"function doesn't function"};
-}
+int help () {
+
+    std::cout << "BoostStratum hands out Boost jobs to remote workers over Stratum. Input should be"
+        "\n\tserve <key> [<address>] --<option>=<value>..."
+        "\nwhere key and address are as for BoostMiner mine. Options are"
+        "\n\tport              -- port to listen on. Default is 3333."
+        "\n\tshare_difficulty  -- difficulty of shares, which are counted to measure hashrate."
+        "\n\t                     Only shares that solve the puzzle are redeemed. Default is 0.001."
+        "\nas well as the options for BoostMiner mine, except threads and micro_job_seconds."
+        "\nEvery connection is treated as one mining thread." << std::endl;
 
-int command_serve (int arg_count, char** arg_values) {
-    throw data::exception {"function doesn't function"};
+    return 0;
 }
 
-int help() {
+int serve (const argh::parser &command_line) {
+    auto options = BoostPOW::read_mining_options (command_line);
+
+    uint16 port = 3333;
+    if (auto option = command_line ("port"); option) option >> port;
+
+    double share_difficulty = BoostPOW::stratum::default_share_difficulty;
+    if (auto option = command_line ("share_difficulty"); option) option >> share_difficulty;
+    if (!(share_difficulty > 0)) throw data::exception {} << "share_difficulty must be positive";
+
+    logger::limit ("job.selected", 10);
+    logger::limit ("worker.resting", 10);
+
+    BoostPOW::network Net {options.APIHosts};
+
+    BoostPOW::fees *Fees = bool (options.FeeRate) ?
+        (BoostPOW::fees *) (new BoostPOW::given_fees (*options.FeeRate)) :
+        (BoostPOW::fees *) (new BoostPOW::fee_oracle (options.MAPIHosts, options.FeeQuoteInterval));
+
+    uint64 seed = std::chrono::system_clock::now ().time_since_epoch ().count () * 5090567 + 337;
+
+    // micro jobs are not batched because a batch can't be sent in one mining.notify.
+    auto m = std::make_shared<BoostPOW::manager> (Net, *Fees, *options.SigningKeys, *options.ReceivingAddresses,
+        seed, options.MaxDifficulty, options.MinProfitability, options.MinValue,
+        BoostPOW::scheduling_policy::make (options.Policy), options.CompetitorHashrate,
+        0, options.AggregateSeconds);
+
+    auto server = std::make_shared<BoostPOW::stratum_server> (m, Net.IO, port, uint32 (seed >> 32), share_difficulty);
+    server->start ();
+    std::cout << "listening for Stratum connections on port " << server->port () << std::endl;
 
-    std::cout << "helllllp! " << std::endl;
-    
+    m->run (options.Websockets, options.RefreshInterval);
+
+    delete Fees;
     return 0;
 }
 
-int main(int arg_count, char** arg_values) {
-    if(arg_count == 1) return help();
-    //if (arg_count != 5) return help();
-    
-    string function{arg_values[1]};
-    
+int main (int arg_count, char** arg_values) {
+    argh::parser command_line (arg_count, arg_values);
+
     try {
-        if (function == "connect") return command_connect(arg_count - 1, arg_values + 2);
-        if (function == "serve") return command_connect(arg_count - 1, arg_values + 2);
-        if (function == "help") return help();
-        help();
-        
-    } catch (std::string x) {
-        std::cout << "Error: " << x << std::endl;
+        if (auto option = command_line ("log_level"); option) logger::set_level (logger::read_level (option.str ()));
+
+        if (!command_line (1)) return help ();
+
+        string method = command_line (1).str ();
+
+        if (method == "serve") return serve (command_line);
+        if (method == "help") return help ();
+
+        throw data::exception {} << "Invalid method " << method << " called. Must be serve or help";
+
+    } catch (const data::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return 1;
+    } catch (const std::exception &x) {
+        std::cout << "Unexpected error: " << x.what () << std::endl;
         return 1;
     }
-    
+
     return 0;
 }
-
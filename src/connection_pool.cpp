@@ -0,0 +1,381 @@
+#include <connection_pool.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <zlib.h>
+
+namespace BoostPOW {
+
+    namespace beast = boost::beast;
+    namespace http = boost::beast::http;
+    using tcp = net::asio::ip::tcp;
+
+    // idle connections older than this are probably closed on the other end.
+    constexpr auto max_idle = std::chrono::seconds {30};
+
+    // decoded bodies larger than this are an error.
+    constexpr size_t max_body = 64 * 1024 * 1024;
+
+    // connecting, the TLS handshake, writing the request and reading the
+    // response may each take this long before the request fails. Name
+    // resolution is left to the system's own timeout.
+    constexpr auto max_wait = std::chrono::seconds {20};
+
+    struct connection_pool::connection {
+        // every connection runs its operations on an io_context of its own, so
+        // that one request can wait for them without running anyone else's.
+        // Streams only time out on asynchronous operations.
+        net::asio::io_context IO;
+
+        endpoint Endpoint;
+        std::unique_ptr<beast::ssl_stream<beast::tcp_stream>> TLS;
+        std::unique_ptr<beast::tcp_stream> TCP;
+        beast::flat_buffer Buffer;
+        std::chrono::steady_clock::time_point LastUsed;
+
+        template <typename f> auto with_stream (f fun) {
+            return TLS != nullptr ? fun (*TLS) : fun (*TCP);
+        }
+
+        // run the operation that was just begun on the stream, whose
+        // deadline has been set. Throws if it failed or timed out.
+        void complete (const boost::system::error_code &err) {
+            IO.restart ();
+            IO.run ();
+            if (err) throw boost::system::system_error {err};
+        }
+    };
+
+    struct connection_pool::host {
+        std::mutex Mutex;
+        std::condition_variable Free;
+        std::deque<std::unique_ptr<connection>> Idle;
+        uint32 Active {0};
+
+        // the session of the last TLS connection, to be resumed by the next one.
+        SSL_SESSION *Session {nullptr};
+
+        // time between requests if there is a rate limit.
+        std::chrono::steady_clock::duration Interval {0};
+        std::chrono::steady_clock::time_point Next {};
+
+        ~host () {
+            if (Session != nullptr) SSL_SESSION_free (Session);
+        }
+    };
+
+    connection_pool::statistics::operator JSON () const {
+        return JSON {
+            {"requests", Requests},
+            {"reused", Reused},
+            {"connections", Connections},
+            {"resumed", Resumed},
+            {"compressed", Compressed},
+            {"decompressed", Decompressed},
+            {"bytes_saved", Decompressed > Compressed ? Decompressed - Compressed : 0}
+        };
+    }
+
+    connection_pool::connection_pool (ptr<net::HTTP::SSL> ssl, uint32 max_connections_per_host) :
+        SSL {ssl}, MaxConnections {std::max (max_connections_per_host, 1u)}, Mutex {}, Hosts {},
+        Requests {0}, Reused {0}, Connections {0}, Resumed {0}, Compressed {0}, Decompressed {0},
+        Recorder {}, Player {} {}
+
+    // host is only complete here.
+    connection_pool::~connection_pool () {}
+
+    connection_pool::statistics connection_pool::stats () const {
+        statistics s {};
+        s.Requests = Requests.load ();
+        s.Reused = Reused.load ();
+        s.Connections = Connections.load ();
+        s.Resumed = Resumed.load ();
+        s.Compressed = Compressed.load ();
+        s.Decompressed = Decompressed.load ();
+        return s;
+    }
+
+    connection_pool::host &connection_pool::get (const string &name) {
+        std::lock_guard<std::mutex> lock (Mutex);
+        auto &h = Hosts[name];
+        if (h == nullptr) h = std::make_unique<host> ();
+        return *h;
+    }
+
+    void connection_pool::limit (const string &name, uint32 requests, uint32 seconds) {
+        host &h = get (name);
+        std::lock_guard<std::mutex> lock (h.Mutex);
+        h.Interval = requests == 0 ? std::chrono::steady_clock::duration {0} :
+            std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::seconds {seconds}) / requests;
+    }
+
+    maybe<connection_pool::endpoint> connection_pool::read_url (const string &url) {
+        auto scheme = url.find ("://");
+        if (scheme == string::npos) return {};
+
+        endpoint e {};
+        string protocol = url.substr (0, scheme);
+        if (protocol == "https") e.TLS = true;
+        else if (protocol == "http") e.TLS = false;
+        else return {};
+
+        auto begin = scheme + 3;
+        auto end = url.find_first_of ("/?", begin);
+        string authority = url.substr (begin, end == string::npos ? string::npos : end - begin);
+        e.Target = end == string::npos ? "/" : url.substr (end);
+        if (e.Target[0] == '?') e.Target = "/" + e.Target;
+
+        auto colon = authority.find (':');
+        e.Host = authority.substr (0, colon);
+        if (e.Host.size () == 0) return {};
+
+        if (colon == string::npos) e.Port = e.TLS ? 443 : 80;
+        else {
+            string port = authority.substr (colon + 1);
+            if (port.size () == 0 || port.size () > 5 || port.find_first_not_of ("0123456789") != string::npos) return {};
+            uint32 p = std::stoul (port);
+            if (p == 0 || p > 65535) return {};
+            e.Port = uint16 (p);
+        }
+
+        return e;
+    }
+
+    maybe<string> connection_pool::gunzip (const string &in) {
+        z_stream z {};
+        // 16 means a gzip header is expected.
+        if (inflateInit2 (&z, 16 + MAX_WBITS) != Z_OK) return {};
+
+        z.next_in = reinterpret_cast<Bytef *> (const_cast<char *> (in.data ()));
+        z.avail_in = in.size ();
+
+        string out {};
+        char buffer[16384];
+        int result;
+        do {
+            z.next_out = reinterpret_cast<Bytef *> (buffer);
+            z.avail_out = sizeof (buffer);
+            result = inflate (&z, Z_NO_FLUSH);
+            if ((result != Z_OK && result != Z_STREAM_END) || out.size () > max_body) {
+                inflateEnd (&z);
+                return {};
+            }
+
+            out.append (buffer, sizeof (buffer) - z.avail_out);
+        } while (result != Z_STREAM_END);
+
+        inflateEnd (&z);
+        return out;
+    }
+
+    std::unique_ptr<connection_pool::connection> connection_pool::connect (host &h, const endpoint &e) {
+        auto c = std::make_unique<connection> ();
+        c->Endpoint = e;
+
+        tcp::resolver resolver {c->IO};
+        auto addresses = resolver.resolve (e.Host, std::to_string (e.Port));
+        Connections++;
+
+        boost::system::error_code err {};
+        auto connect = [&addresses, &err, &c] (beast::tcp_stream &stream) {
+            stream.expires_after (max_wait);
+            stream.async_connect (addresses, [&err] (boost::system::error_code x, const tcp::endpoint &) {
+                err = x;
+            });
+
+            c->complete (err);
+        };
+
+        if (!e.TLS) {
+            c->TCP = std::make_unique<beast::tcp_stream> (c->IO);
+            connect (*c->TCP);
+            return c;
+        }
+
+        c->TLS = std::make_unique<beast::ssl_stream<beast::tcp_stream>> (c->IO, *SSL);
+        auto native = c->TLS->native_handle ();
+
+        // SNI.
+        if (!SSL_set_tlsext_host_name (native, e.Host.c_str ()))
+            throw data::exception {} << "could not set TLS host name " << e.Host;
+
+        c->TLS->set_verify_mode (net::asio::ssl::verify_peer);
+        c->TLS->set_verify_callback (net::asio::ssl::host_name_verification (e.Host));
+
+        {
+            std::lock_guard<std::mutex> lock (h.Mutex);
+            if (h.Session != nullptr) SSL_set_session (native, h.Session);
+        }
+
+        connect (beast::get_lowest_layer (*c->TLS));
+
+        beast::get_lowest_layer (*c->TLS).expires_after (max_wait);
+        c->TLS->async_handshake (net::asio::ssl::stream_base::client, [&err] (boost::system::error_code x) {
+            err = x;
+        });
+
+        c->complete (err);
+
+        if (SSL_session_reused (native)) Resumed++;
+
+        if (SSL_SESSION *session = SSL_get1_session (native); session != nullptr) {
+            std::lock_guard<std::mutex> lock (h.Mutex);
+            if (h.Session != nullptr) SSL_SESSION_free (h.Session);
+            h.Session = session;
+        }
+
+        return c;
+    }
+
+    net::HTTP::response connection_pool::operator () (const net::HTTP::request &request) {
+        if (Player != nullptr) return (*Player) (request);
+        if (Recorder == nullptr) return send (request);
+
+        auto begin = std::chrono::steady_clock::now ();
+        try {
+            auto response = send (request);
+            Recorder->http (request, response, begin, std::chrono::steady_clock::now ());
+            return response;
+        } catch (const std::exception &e) {
+            Recorder->http_failed (request, e.what (), begin, std::chrono::steady_clock::now ());
+            throw;
+        }
+    }
+
+    net::HTTP::response connection_pool::send (const net::HTTP::request &request) {
+        std::stringstream url_stream;
+        url_stream << request.URL;
+        auto e = read_url (url_stream.str ());
+        if (!bool (e)) throw data::exception {} << "cannot make request to " << url_stream.str ();
+
+        std::stringstream method_stream;
+        method_stream << request.Method;
+        http::verb method = http::string_to_verb (method_stream.str ());
+        if (method == http::verb::unknown) throw data::exception {} << "unknown HTTP method " << method_stream.str ();
+
+        http::request<http::string_body> req {method, e->Target, 11};
+        req.set (http::field::host, e->Host);
+        req.set (http::field::user_agent, "BoostMiner");
+        req.set (http::field::accept_encoding, "gzip");
+        for (const auto &[key, value] : request.Headers) req.set (key, value);
+        req.keep_alive (true);
+        if (request.Body.size () > 0 || method == http::verb::post) {
+            req.body () = request.Body;
+            req.prepare_payload ();
+        }
+
+        host &h = get (e->Host);
+        Requests++;
+
+        // wait for a slot and for the rate limit, then take an idle connection if there is one.
+        std::unique_ptr<connection> c {};
+        {
+            std::unique_lock<std::mutex> lock (h.Mutex);
+            h.Free.wait (lock, [this, &h] () {
+                return h.Active < MaxConnections;
+            });
+
+            h.Active++;
+
+            auto now = std::chrono::steady_clock::now ();
+            auto start = std::max (now, h.Next);
+            h.Next = start + h.Interval;
+
+            while (h.Idle.size () > 0 && c == nullptr) {
+                auto x = std::move (h.Idle.back ());
+                h.Idle.pop_back ();
+                if (now - x->LastUsed < max_idle && x->Endpoint.TLS == e->TLS && x->Endpoint.Port == e->Port) c = std::move (x);
+            }
+
+            lock.unlock ();
+            if (start > now) std::this_thread::sleep_until (start);
+        }
+
+        auto release = [&h] (std::unique_ptr<connection> x) {
+            std::lock_guard<std::mutex> lock (h.Mutex);
+            h.Active--;
+            if (x != nullptr) h.Idle.push_back (std::move (x));
+            h.Free.notify_one ();
+        };
+
+        std::optional<http::response_parser<http::string_body>> parser {};
+        try {
+            bool reused = c != nullptr;
+            while (true) {
+                if (c == nullptr) c = connect (h, *e);
+
+                parser.emplace ();
+                parser->body_limit (max_body);
+
+                try {
+                    c->with_stream ([&req, &parser, &c] (auto &stream) {
+                        boost::system::error_code err {};
+
+                        beast::get_lowest_layer (stream).expires_after (max_wait);
+                        http::async_write (stream, req, [&err] (boost::system::error_code x, size_t) {
+                            err = x;
+                        });
+
+                        c->complete (err);
+
+                        beast::get_lowest_layer (stream).expires_after (max_wait);
+                        http::async_read (stream, c->Buffer, *parser, [&err] (boost::system::error_code x, size_t) {
+                            err = x;
+                        });
+
+                        c->complete (err);
+
+                        // idle connections are not timed.
+                        beast::get_lowest_layer (stream).expires_never ();
+                        return 0;
+                    });
+
+                    if (reused) Reused++;
+                    break;
+                } catch (const boost::system::system_error &x) {
+                    // the server may have closed a connection that we thought was still open.
+                    // A host that has stopped answering is not tried again.
+                    if (!reused || x.code () == beast::error::timeout) throw;
+                    reused = false;
+                    c = nullptr;
+                }
+            }
+        } catch (...) {
+            release (nullptr);
+            throw;
+        }
+
+        http::response<http::string_body> res = parser->release ();
+        string body = std::move (res.body ());
+
+        if (beast::iequals (res[http::field::content_encoding], "gzip")) {
+            auto decoded = gunzip (body);
+            if (!bool (decoded)) {
+                release (nullptr);
+                throw data::exception {} << "could not decode gzipped response from " << e->Host;
+            }
+
+            Compressed += body.size ();
+            Decompressed += decoded->size ();
+            body = std::move (*decoded);
+        }
+
+        c->LastUsed = std::chrono::steady_clock::now ();
+        release (res.keep_alive () ? std::move (c) : nullptr);
+
+        net::HTTP::response response {};
+        response.Status = static_cast<net::HTTP::status> (res.result_int ());
+        for (const auto &field : res)
+            if (field.name () != http::field::content_encoding && field.name () != http::field::content_length)
+                response.Headers[field.name ()] = string (field.value ());
+        response.Body = body;
+
+        return response;
+    }
+
+}
@@ -0,0 +1,118 @@
+#include <control.hpp>
+#include <logger.hpp>
+#include <cstdio>
+
+namespace BoostPOW {
+
+    namespace {
+        JSON failure (const string &error) {
+            return JSON {{"ok", false}, {"error", error}};
+        }
+
+        maybe<double> read_number (const JSON &command, const char *name) {
+            if (!command.contains (name) || !command[name].is_number ()) return {};
+            return double (command[name]);
+        }
+    }
+
+    JSON control (controllable &c, const JSON &command) {
+        if (!command.is_object () || !command.contains ("command") || !command["command"].is_string ())
+            return failure ("expected an object with a command");
+
+        string name = command["command"];
+
+        if (name == "threads") {
+            if (!command.contains ("threads") || !command["threads"].is_number_unsigned ())
+                return failure ("threads must be a non-negative integer");
+            uint64 threads = command["threads"];
+            // the thread index goes into the extra nonce. See search_space.hpp.
+            if (threads > 65535) return failure ("too many threads");
+            c.set_threads (uint32 (threads));
+        } else if (name == "pause") c.pause (true);
+        else if (name == "resume") c.pause (false);
+        else if (name == "filters") {
+            auto min_profitability = read_number (command, "min_profitability");
+            auto max_difficulty = read_number (command, "max_difficulty");
+            if (!bool (min_profitability) && !bool (max_difficulty))
+                return failure ("expected min_profitability or max_difficulty");
+            if (bool (min_profitability) && *min_profitability < 0)
+                return failure ("min_profitability cannot be negative");
+            c.set_filters (min_profitability, max_difficulty);
+        } else if (name != "status") return failure ("unknown command " + name);
+
+        logger::log ("control.command", command);
+
+        return JSON {{"ok", true}, {"status", c.status ()}};
+    }
+
+    struct control_server::connection final : std::enable_shared_from_this<connection> {
+        ptr<control_server> Server;
+        protocol::socket Socket;
+        net::asio::streambuf Buffer;
+        std::deque<string> Outgoing;
+
+        connection (ptr<control_server> server, protocol::socket socket) :
+            Server {server}, Socket {std::move (socket)}, Buffer {}, Outgoing {} {}
+
+        void send (const JSON &message) {
+            Outgoing.push_back (message.dump () + "\n");
+            if (Outgoing.size () == 1) write ();
+        }
+
+        void write () {
+            net::asio::async_write (Socket, net::asio::buffer (Outgoing.front ()),
+                [self = shared_from_this ()] (boost::system::error_code err, size_t) {
+                    if (err) return;
+                    self->Outgoing.pop_front ();
+                    if (self->Outgoing.size () > 0) self->write ();
+                });
+        }
+
+        void read () {
+            net::asio::async_read_until (Socket, Buffer, '\n',
+                [self = shared_from_this ()] (boost::system::error_code err, size_t size) {
+                    if (err) return;
+
+                    string line {net::asio::buffers_begin (self->Buffer.data ()),
+                        net::asio::buffers_begin (self->Buffer.data ()) + size};
+                    self->Buffer.consume (size);
+
+                    try {
+                        self->send (control (self->Server->Controlled, JSON::parse (line)));
+                    } catch (const JSON::exception &x) {
+                        self->send (failure (x.what ()));
+                    } catch (const std::exception &x) {
+                        logger::log (logger::error, "control.failed", JSON {{"error", x.what ()}});
+                        self->send (failure (x.what ()));
+                    }
+
+                    self->read ();
+                });
+        }
+    };
+
+    control_server::control_server (controllable &c, net::asio::io_context &io, const string &path) :
+        Controlled {c}, Path {(std::remove (path.c_str ()), path)}, Acceptor {io, protocol::endpoint {path}} {}
+
+    control_server::~control_server () {
+        std::remove (Path.c_str ());
+    }
+
+    void control_server::start () {
+        logger::log ("control.listening", JSON {{"path", Path}});
+        accept ();
+    }
+
+    void control_server::accept () {
+        Acceptor.async_accept ([self = shared_from_this ()] (boost::system::error_code err, protocol::socket socket) {
+            if (err) {
+                logger::log (logger::error, "control.accept_failed", JSON {{"error", err.message ()}});
+                return;
+            }
+
+            std::make_shared<connection> (self, std::move (socket))->read ();
+            self->accept ();
+        });
+    }
+
+}
@@ -0,0 +1,269 @@
+#include <engine.hpp>
+#include <miner.hpp>
+#include <affinity.hpp>
+#include <optional>
+
+namespace BoostPOW {
+
+    struct engine::task {
+        uint64 Sequence;
+        work::puzzle Work;
+        int32 Priority;
+        std::chrono::steady_clock::time_point Deadline;
+        function<void (const result &)> Done;
+
+        std::atomic<bool> Finished {false};
+
+        // must not be destroyed with the engine's mutex locked, since the
+        // callback locks it and destroying it waits for the callback.
+        std::optional<std::stop_callback<function<void ()>>> OnStop {};
+
+        task (const work::puzzle &p, int32 priority, std::chrono::steady_clock::time_point deadline, function<void (const result &)> done) :
+            Sequence {0}, Work {p}, Priority {priority}, Deadline {deadline}, Done {done} {}
+
+        // true if this call is the one that finished the task.
+        bool finish (const result &r) {
+            if (Finished.exchange (true)) return false;
+            Done (r);
+            return true;
+        }
+
+        bool before (const task &t) const {
+            return Priority > t.Priority || (Priority == t.Priority && Sequence < t.Sequence);
+        }
+    };
+
+    struct engine::state {
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        std::vector<ptr<task>> Queue {};
+        uint64 Sequence {0};
+        bool Stop {false};
+
+        // changed whenever the threads should stop what they are doing and look at the queue again.
+        alignas (cache_line) std::atomic<uint64> Epoch {0};
+
+        struct alignas (cache_line) counter {
+            std::atomic<uint64> Hashes {0};
+        };
+
+        std::unique_ptr<counter[]> Hashes;
+        uint32 Threads;
+
+        std::atomic<uint64> Solved {0};
+        std::atomic<uint64> Cancelled {0};
+        std::atomic<uint64> Expired {0};
+
+        std::chrono::steady_clock::time_point LastStats;
+        uint64 LastHashes {0};
+
+        state (uint32 threads) : Hashes {new counter[threads]}, Threads {threads},
+            LastStats {std::chrono::steady_clock::now ()} {}
+
+        // must be called with Mutex locked. Finished tasks are moved to done,
+        // to be dropped once the lock is released.
+        ptr<task> top (std::chrono::steady_clock::time_point now, std::vector<ptr<task>> &done) {
+            ptr<task> best {};
+            for (auto it = Queue.begin (); it != Queue.end ();) {
+                if ((*it)->Finished) {
+                    done.push_back (std::move (*it));
+                    it = Queue.erase (it);
+                    continue;
+                }
+
+                if ((*it)->Deadline > now && (best == nullptr || (*it)->before (*best))) best = *it;
+                it++;
+            }
+
+            return best;
+        }
+
+        void wake () {
+            {
+                std::lock_guard<std::mutex> lock (Mutex);
+                Epoch++;
+            }
+
+            Wake.notify_all ();
+        }
+
+        uint64 hashes () const {
+            uint64 total = 0;
+            for (uint32 i = 0; i < Threads; i++) total += Hashes[i].Hashes.load (std::memory_order_relaxed);
+            return total;
+        }
+    };
+
+    engine::statistics::operator JSON () const {
+        return JSON {
+            {"threads", Threads},
+            {"hashes", Hashes},
+            {"hashrate", Hashrate},
+            {"queued", Queued},
+            {"solved", Solved},
+            {"cancelled", Cancelled},
+            {"expired", Expired}
+        };
+    }
+
+    engine::engine (uint32 threads, uint32 worker_id, std::vector<int32> cpus) :
+        State {std::make_shared<state> (threads)}, Threads {} {
+        if (threads == 0) throw data::exception {"engine needs at least one thread"};
+
+        for (uint32 i = 0; i < threads; i++)
+            Threads.emplace_back ([this, i, worker_id, cpu = i < cpus.size () ? cpus[i] : -1] () {
+                run (i, worker_id, cpu);
+            });
+
+        // expires puzzles when their time is up, so that a future is never late
+        // just because every thread was busy.
+        Threads.emplace_back ([s = State] () {
+            std::unique_lock<std::mutex> lock (s->Mutex);
+            while (!s->Stop) {
+                auto now = std::chrono::steady_clock::now ();
+                auto next = std::chrono::steady_clock::time_point::max ();
+                std::vector<ptr<task>> expired {};
+
+                for (const ptr<task> &t : s->Queue) if (!t->Finished) {
+                    if (t->Deadline <= now) expired.push_back (t);
+                    else next = std::min (next, t->Deadline);
+                }
+
+                if (expired.size () > 0) {
+                    s->Epoch++;
+                    lock.unlock ();
+                    s->Wake.notify_all ();
+                    for (const ptr<task> &t : expired) if (t->finish ({result::expired, {}})) s->Expired++;
+                    expired.clear ();
+                    lock.lock ();
+                    continue;
+                }
+
+                if (next == std::chrono::steady_clock::time_point::max ()) s->Wake.wait (lock);
+                else s->Wake.wait_until (lock, next);
+            }
+        });
+    }
+
+    engine::~engine () {
+        {
+            std::lock_guard<std::mutex> lock (State->Mutex);
+            State->Stop = true;
+            State->Epoch++;
+        }
+
+        State->Wake.notify_all ();
+        for (std::thread &t : Threads) t.join ();
+
+        std::vector<ptr<task>> remaining {};
+        {
+            std::lock_guard<std::mutex> lock (State->Mutex);
+            remaining = std::move (State->Queue);
+        }
+
+        for (const ptr<task> &t : remaining) t->finish ({result::stopped, {}});
+    }
+
+    void engine::submit (function<void (const result &)> done, const work::puzzle &p,
+        int32 priority, double max_seconds, std::stop_token token) {
+        if (!p.valid ()) throw data::exception {"cannot mine an invalid puzzle"};
+        if (max_seconds < 0) throw data::exception {"time limit cannot be negative"};
+
+        auto deadline = max_seconds == 0 ? std::chrono::steady_clock::time_point::max () :
+            std::chrono::steady_clock::now () + std::chrono::duration_cast<std::chrono::steady_clock::duration> (
+                std::chrono::duration<double> (max_seconds));
+
+        auto t = std::make_shared<task> (p, priority, deadline, done);
+
+        if (token.stop_possible ())
+            t->OnStop.emplace (token, [t = t.get (), s = std::weak_ptr<state> {State}] () {
+                if (!t->finish ({result::cancelled, {}})) return;
+                if (auto st = s.lock (); st != nullptr) {
+                    st->Cancelled++;
+                    st->wake ();
+                }
+            });
+
+        std::vector<ptr<task>> finished {};
+        {
+            std::lock_guard<std::mutex> lock (State->Mutex);
+            t->Sequence = State->Sequence++;
+            ptr<task> current = State->top (std::chrono::steady_clock::now (), finished);
+            State->Queue.push_back (t);
+
+            // the threads only need to drop what they are doing if this goes first.
+            if (current == nullptr || t->before (*current)) State->Epoch++;
+        }
+
+        State->Wake.notify_all ();
+    }
+
+    std::future<engine::result> engine::submit (const work::puzzle &p, int32 priority, double max_seconds, std::stop_token token) {
+        auto promise = std::make_shared<std::promise<result>> ();
+        auto future = promise->get_future ();
+        submit ([promise] (const result &r) {
+            promise->set_value (r);
+        }, p, priority, max_seconds, token);
+        return future;
+    }
+
+    engine::statistics engine::stats () {
+        std::vector<ptr<task>> finished {};
+        std::lock_guard<std::mutex> lock (State->Mutex);
+
+        auto now = std::chrono::steady_clock::now ();
+        uint64 hashes = State->hashes ();
+        double seconds = std::chrono::duration<double> (now - State->LastStats).count ();
+
+        statistics s {};
+        s.Threads = State->Threads;
+        s.Hashes = hashes;
+        s.Hashrate = seconds > 0 ? (hashes - State->LastHashes) / seconds : 0;
+        for (const ptr<task> &t : State->Queue) if (!t->Finished) s.Queued++;
+        s.Solved = State->Solved;
+        s.Cancelled = State->Cancelled;
+        s.Expired = State->Expired;
+
+        State->LastStats = now;
+        State->LastHashes = hashes;
+        return s;
+    }
+
+    void engine::run (uint32 index, uint32 worker_id, int32 cpu) {
+        affinity::pin (cpu);
+        state &s = *State;
+
+        // created after pinning so that it is on this thread's NUMA node.
+        search_partition partition {worker_id, uint16 (index + 1)};
+
+        while (true) {
+            ptr<task> t {};
+            uint64 epoch;
+            std::vector<ptr<task>> finished {};
+            {
+                std::unique_lock<std::mutex> lock (s.Mutex);
+                while (!s.Stop) {
+                    t = s.top (std::chrono::steady_clock::now (), finished);
+                    if (t != nullptr) break;
+                    s.Wake.wait (lock);
+                }
+
+                if (s.Stop) return;
+                epoch = s.Epoch;
+            }
+
+            // tasks are dropped here, without the lock.
+            finished.clear ();
+
+            // solve stops when the epoch changes, but it only notices changes after it begins.
+            if (s.Epoch.load () != epoch) continue;
+
+            work::proof proof = solve (partition, t->Work, 10, &s.Hashes[index].Hashes, &s.Epoch);
+            if (proof.valid () && t->finish ({result::solved, proof})) {
+                s.Solved++;
+                s.wake ();
+            }
+        }
+    }
+
+}
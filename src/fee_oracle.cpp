@@ -0,0 +1,116 @@
+#include <fee_oracle.hpp>
+#include <logger.hpp>
+#include <algorithm>
+
+namespace BoostPOW {
+
+    namespace {
+
+        std::vector<fee_oracle::source> mapi_sources (list<string> mapi_hosts) {
+            if (data::empty (mapi_hosts)) throw data::exception {"fee oracle needs at least one MAPI host"};
+
+            std::vector<fee_oracle::source> sources {};
+            for (const string &host : mapi_hosts)
+                sources.push_back ([mapi = std::make_shared<BitcoinAssociation::MAPI> (net::HTTP::REST {"https", host})] () -> double {
+                    auto quote = mapi->get_fee_quote ();
+                    if (!quote.valid ()) {
+                        logger::log (logger::warning, "fee.quote.invalid", JSON (quote));
+                        return 0;
+                    }
+
+                    return double (quote.Fees["standard"].MiningFee);
+                });
+
+            return sources;
+        }
+
+    }
+
+    fee_oracle::fee_oracle (list<string> mapi_hosts, uint32 ttl_seconds, double default_fee) :
+        fee_oracle {mapi_sources (mapi_hosts), ttl_seconds, default_fee} {}
+
+    fee_oracle::fee_oracle (std::vector<source> sources, uint32 ttl_seconds, double default_fee) :
+        Sources {std::move (sources)}, TTL {ttl_seconds}, FeeRate {default_fee}, Quoted {false},
+        Mutex {}, Wake {}, Received {}, Stop {false} {
+        if (Sources.size () == 0) throw data::exception {"fee oracle needs at least one source"};
+        Refresher = std::thread {&fee_oracle::run, this};
+    }
+
+    double fee_oracle::median (std::vector<double> x) {
+        std::sort (x.begin (), x.end ());
+        return x.size () % 2 == 1 ? x[x.size () / 2] : (x[x.size () / 2 - 1] + x[x.size () / 2]) / 2;
+    }
+
+    fee_oracle::~fee_oracle () {
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            Stop = true;
+        }
+
+        Wake.notify_all ();
+        Refresher.join ();
+    }
+
+    double fee_oracle::get () {
+        return FeeRate.load ();
+    }
+
+    bool fee_oracle::refresh () {
+        std::vector<double> quotes;
+
+        for (auto &quote : Sources) try {
+            double rate = quote ();
+            if (rate > 0) quotes.push_back (rate);
+        } catch (const std::exception &e) {
+            logger::log (logger::warning, "fee.quote.error", JSON {{"error", e.what ()}});
+        }
+
+        if (quotes.size () == 0) return false;
+
+        double rate = median (quotes);
+
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            FeeRate.store (rate);
+            Quoted = true;
+        }
+
+        Received.notify_all ();
+
+        logger::log ("fee.quote", JSON {
+            {"fee_rate", rate},
+            {"quotes", quotes.size ()},
+            {"endpoints", Sources.size ()}
+        });
+
+        return true;
+    }
+
+    bool fee_oracle::wait_for_quote (std::chrono::steady_clock::duration timeout) {
+        std::unique_lock<std::mutex> lock (Mutex);
+        return Received.wait_for (lock, timeout, [this] () {
+            return Quoted;
+        });
+    }
+
+    void fee_oracle::seed (double fee_rate) {
+        std::lock_guard<std::mutex> lock (Mutex);
+        if (Quoted || fee_rate <= 0) return;
+        FeeRate.store (fee_rate);
+    }
+
+    void fee_oracle::run () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        while (!Stop) {
+            lock.unlock ();
+            bool success = refresh ();
+            lock.lock ();
+
+            // if we could not get a quote, try again sooner.
+            Wake.wait_for (lock, std::chrono::seconds {success ? TTL : std::min (TTL, uint32 {30})}, [this] () {
+                return Stop;
+            });
+        }
+    }
+
+}
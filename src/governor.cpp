@@ -0,0 +1,142 @@
+#include <governor.hpp>
+#include <data/io/exception.hpp>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace BoostPOW::governor {
+
+    maybe<double> read_cpu_max (const string &x) {
+        std::istringstream in {x};
+        string quota;
+        double period;
+        if (!(in >> quota >> period) || quota == "max" || period <= 0) return {};
+        if (quota.find_first_not_of ("0123456789") != string::npos) return {};
+        return std::stod (quota) / period;
+    }
+
+    uint32 count_cpus (const string &x) {
+        uint32 count = 0;
+        std::istringstream in {x};
+        string range;
+        while (std::getline (in, range, ',')) {
+            while (range.size () > 0 && std::isspace (static_cast<unsigned char> (range.back ()))) range.pop_back ();
+            if (range.size () == 0) continue;
+
+            auto dash = range.find ('-');
+            string first = range.substr (0, dash);
+            string last = dash == string::npos ? first : range.substr (dash + 1);
+            if (first.size () == 0 || last.size () == 0 ||
+                first.find_first_not_of ("0123456789") != string::npos ||
+                last.find_first_not_of ("0123456789") != string::npos) return 0;
+
+            uint32 a = std::stoul (first);
+            uint32 b = std::stoul (last);
+            if (b < a) return 0;
+            count += b - a + 1;
+        }
+
+        return count;
+    }
+
+    maybe<string> read_cgroup_path (const string &x) {
+        std::istringstream in {x};
+        string line;
+        // cgroup v2 is the entry with hierarchy 0 and no controllers.
+        while (std::getline (in, line)) if (line.rfind ("0::", 0) == 0) return line.substr (3);
+        return {};
+    }
+
+    uint32 limits::threads () const {
+        uint32 n = CPUs;
+        // a thread that can only run part of the time still takes a whole cpu while it runs.
+        if (bool (Quota)) n = std::min (n, uint32 (std::floor (*Quota + .01)));
+        return std::max (n, 1u);
+    }
+
+    namespace {
+
+        maybe<string> read_file (const std::filesystem::path &p) {
+            std::ifstream file {p};
+            if (!file) return {};
+            std::stringstream ss;
+            ss << file.rdbuf ();
+            return ss.str ();
+        }
+
+        // the cpus this process may run on, whatever has set them.
+        uint32 allowed_cpus () {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO (&set);
+            if (sched_getaffinity (0, sizeof (set), &set) == 0) return CPU_COUNT (&set);
+#endif
+            return std::thread::hardware_concurrency ();
+        }
+
+    }
+
+    limits detect (const std::filesystem::path &root) {
+        limits l {std::max (allowed_cpus (), 1u), {}};
+
+        auto proc = read_file ("/proc/self/cgroup");
+        if (!bool (proc)) return l;
+
+        auto path = read_cgroup_path (*proc);
+        if (!bool (path)) return l;
+
+        std::filesystem::path relative = std::filesystem::path {*path}.relative_path ();
+        std::filesystem::path dir = relative.empty () ? root : root / relative;
+
+        if (auto cpus = read_file (dir / "cpuset.cpus.effective"); bool (cpus))
+            if (uint32 n = count_cpus (*cpus); n > 0) l.CPUs = std::min (l.CPUs, n);
+
+        // the quota of every cgroup up to the root applies.
+        for (auto d = dir; ; d = d.parent_path ()) {
+            if (auto max = read_file (d / "cpu.max"); bool (max))
+                if (auto quota = read_cpu_max (*max); bool (quota))
+                    if (!bool (l.Quota) || *quota < *l.Quota) l.Quota = quota;
+
+            if (d.string ().size () <= root.string ().size ()) break;
+        }
+
+        return l;
+    }
+
+    namespace {
+        std::atomic<double> DutyCycle {1};
+
+        thread_local std::chrono::steady_clock::time_point Awake {};
+    }
+
+    void set_duty_cycle (double d) {
+        if (!(d > 0) || d > 1) throw data::exception {} << "duty cycle must be more than 0 and at most 1";
+        DutyCycle.store (d, std::memory_order_relaxed);
+    }
+
+    double duty_cycle () {
+        return DutyCycle.load (std::memory_order_relaxed);
+    }
+
+    void begin () {
+        Awake = std::chrono::steady_clock::now ();
+    }
+
+    void rest () {
+        double d = DutyCycle.load (std::memory_order_relaxed);
+        if (d >= 1) return;
+
+        auto now = std::chrono::steady_clock::now ();
+        std::this_thread::sleep_for ((now - Awake) * ((1 - d) / d));
+        Awake = std::chrono::steady_clock::now ();
+    }
+
+}
@@ -0,0 +1,55 @@
+#include <hedge.hpp>
+#include <algorithm>
+
+namespace BoostPOW {
+
+    // fewer samples than this don't say much about the tail.
+    constexpr size_t min_samples = 10;
+
+    void latency::record (double seconds) {
+        std::lock_guard<std::mutex> lock (Mutex);
+        if (Samples.size () < Window) Samples.push_back (seconds);
+        else Samples[Count % Window] = seconds;
+        Count++;
+    }
+
+    double latency::percentile (double fraction, double otherwise) const {
+        std::vector<double> samples;
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            if (Samples.size () < min_samples) return otherwise;
+            samples = Samples;
+        }
+
+        size_t n = std::min (samples.size () - 1, size_t (fraction * samples.size ()));
+        std::nth_element (samples.begin (), samples.begin () + n, samples.end ());
+        return samples[n];
+    }
+
+    void latency::begin () {
+        std::lock_guard<std::mutex> lock (Mutex);
+        Pending++;
+    }
+
+    void latency::end () {
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            Pending--;
+        }
+
+        Idle.notify_all ();
+    }
+
+    void latency::wait () const {
+        std::unique_lock<std::mutex> lock (Mutex);
+        Idle.wait (lock, [this] () {
+            return Pending == 0;
+        });
+    }
+
+    uint64 latency::count () const {
+        std::lock_guard<std::mutex> lock (Mutex);
+        return Count;
+    }
+
+}
@@ -0,0 +1,220 @@
+#include <job_board.hpp>
+#include <warm_start.hpp>
+#include <cache_line.hpp>
+#include <logger.hpp>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BoostPOW {
+
+    namespace {
+
+        constexpr char magic[8] = {'B', 'M', 'J', 'O', 'B', 'S', '1', '\0'};
+
+        // every process maps the region at a different address, so everything
+        // in it must work without a lock and without pointers.
+        static_assert (std::atomic<uint64>::is_always_lock_free);
+
+        // how many times to try for a consistent read before giving up until the next refresh.
+        constexpr int read_attempts = 8;
+
+        // shm_open wants exactly one slash, at the beginning.
+        string shared_memory_name (const string &name) {
+            if (name.empty () || name.find ('/', 1) != string::npos)
+                throw data::exception {} << "invalid job board name " << name;
+            return name[0] == '/' ? name : "/" + name;
+        }
+
+    }
+
+    struct job_board::layout {
+        char Magic[8];
+        uint64 SlotSize;
+
+        // set when the publisher is destroyed.
+        alignas (cache_line) std::atomic<uint64> Closed;
+
+        // of the latest table. Its slot is Version % 2.
+        alignas (cache_line) std::atomic<uint64> Version;
+
+        struct slot {
+            // twice the version of the table in the slot, minus one while it is being written.
+            alignas (cache_line) std::atomic<uint64> Sequence;
+            std::atomic<uint64> Size;
+        };
+
+        slot Slots[2];
+
+        // followed by the two slots of SlotSize bytes.
+    };
+
+    byte *job_board::slot (uint64 version) const {
+        return reinterpret_cast<byte *> (Region) + sizeof (layout) + (version % 2) * Region->SlotSize;
+    }
+
+#ifdef __linux__
+    ptr<job_board> job_board::create (const string &name, size_t slot_size) {
+        string shm = shared_memory_name (name);
+        size_t size = sizeof (layout) + 2 * slot_size;
+
+        // readers still attached to an old region see it closed and look again.
+        if (int old = ::shm_open (shm.c_str (), O_RDWR, 0); old >= 0) {
+            struct stat info;
+            if (::fstat (old, &info) == 0 && size_t (info.st_size) >= sizeof (layout))
+                if (void *m = ::mmap (nullptr, sizeof (layout), PROT_READ | PROT_WRITE, MAP_SHARED, old, 0); m != MAP_FAILED) {
+                    layout *region = static_cast<layout *> (m);
+                    if (std::memcmp (region->Magic, magic, sizeof (magic)) == 0) region->Closed.store (1, std::memory_order_release);
+                    ::munmap (m, sizeof (layout));
+                }
+
+            ::close (old);
+        }
+
+        ::shm_unlink (shm.c_str ());
+
+        int fd = ::shm_open (shm.c_str (), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw data::exception {} << "could not create job board " << name << ": " << std::strerror (errno);
+
+        if (::ftruncate (fd, size) != 0) {
+            ::close (fd);
+            ::shm_unlink (shm.c_str ());
+            throw data::exception {} << "could not size job board " << name << ": " << std::strerror (errno);
+        }
+
+        void *mapped = ::mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close (fd);
+        if (mapped == MAP_FAILED) {
+            ::shm_unlink (shm.c_str ());
+            throw data::exception {} << "could not map job board " << name << ": " << std::strerror (errno);
+        }
+
+        // the region starts out as zeros, which is version zero in both slots.
+        layout *region = static_cast<layout *> (mapped);
+        region->SlotSize = slot_size;
+        std::atomic_thread_fence (std::memory_order_release);
+        std::memcpy (region->Magic, magic, sizeof (magic));
+
+        logger::log ("job_board.created", JSON {{"name", shm}, {"slot_size", slot_size}});
+        return ptr<job_board> {new job_board {shm, true, region, size}};
+    }
+
+    ptr<job_board> job_board::attach (const string &name) {
+        string shm = shared_memory_name (name);
+
+        int fd = ::shm_open (shm.c_str (), O_RDONLY, 0);
+        if (fd < 0) return nullptr;
+
+        struct stat info;
+        if (::fstat (fd, &info) != 0 || size_t (info.st_size) < sizeof (layout)) {
+            ::close (fd);
+            return nullptr;
+        }
+
+        void *mapped = ::mmap (nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close (fd);
+        if (mapped == MAP_FAILED) return nullptr;
+
+        layout *region = static_cast<layout *> (mapped);
+        if (std::memcmp (region->Magic, magic, sizeof (magic)) != 0 ||
+            sizeof (layout) + 2 * region->SlotSize != size_t (info.st_size)) {
+            ::munmap (mapped, info.st_size);
+            return nullptr;
+        }
+
+        return ptr<job_board> {new job_board {shm, false, region, size_t (info.st_size)}};
+    }
+
+    job_board::~job_board () {
+        // if the board is already closed, another publisher has replaced it and the name is theirs.
+        if (Publisher && Region->Closed.exchange (1, std::memory_order_acq_rel) == 0) ::shm_unlink (Name.c_str ());
+
+        ::munmap (Region, Size);
+    }
+#else
+    ptr<job_board> job_board::create (const string &, size_t) {
+        throw data::exception {"job boards need POSIX shared memory, which is only supported on Linux"};
+    }
+
+    ptr<job_board> job_board::attach (const string &) {
+        throw data::exception {"job boards need POSIX shared memory, which is only supported on Linux"};
+    }
+
+    job_board::~job_board () {}
+#endif
+
+    void job_board::publish (const jobs &j) {
+        if (!Publisher) throw data::exception {"only the process that created a job board can publish to it"};
+
+        warm_start::state s {};
+        s.Saved = std::chrono::duration_cast<std::chrono::seconds> (
+            std::chrono::system_clock::now ().time_since_epoch ()).count ();
+        s.Jobs = j;
+        bytes b = warm_start::write (s);
+
+        if (b.size () > Region->SlotSize) throw data::exception {} <<
+            "job table of " << b.size () << " bytes does not fit on a job board with slots of " << Region->SlotSize;
+
+        uint64 version = Region->Version.load (std::memory_order_relaxed) + 1;
+        auto &x = Region->Slots[version % 2];
+
+        x.Sequence.store (2 * version - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        std::memcpy (slot (version), b.data (), b.size ());
+        x.Size.store (b.size (), std::memory_order_relaxed);
+
+        x.Sequence.store (2 * version, std::memory_order_release);
+        Region->Version.store (version, std::memory_order_release);
+
+        logger::log ("job_board.published", JSON {
+            {"version", version},
+            {"jobs", j.Jobs.size ()},
+            {"bytes", b.size ()}
+        });
+    }
+
+    uint64 job_board::version () const {
+        return Region->Version.load (std::memory_order_acquire);
+    }
+
+    bool job_board::closed () const {
+        return Region->Closed.load (std::memory_order_acquire) != 0;
+    }
+
+    maybe<job_board::table> job_board::read () const {
+        for (int i = 0; i < read_attempts; i++) {
+            uint64 version = Region->Version.load (std::memory_order_acquire);
+            if (version == 0) return {};
+
+            const auto &x = Region->Slots[version % 2];
+            if (x.Sequence.load (std::memory_order_acquire) != 2 * version) continue;
+
+            // what we read may be garbage if the slot is being written, but
+            // warm_start::read checks every size against the end of the data.
+            uint64 size = x.Size.load (std::memory_order_relaxed);
+            maybe<warm_start::state> s = size <= Region->SlotSize ? warm_start::read (slot (version), size) : maybe<warm_start::state> {};
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (x.Sequence.load (std::memory_order_relaxed) != 2 * version) continue;
+
+            if (!bool (s)) {
+                logger::log (logger::warning, "job_board.unreadable", JSON {{"name", Name}, {"version", version}});
+                return {};
+            }
+
+            return table {version, s->Saved, s->Jobs};
+        }
+
+        return {};
+    }
+
+}
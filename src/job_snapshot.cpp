@@ -0,0 +1,88 @@
+#include <job_snapshot.hpp>
+#include <logger.hpp>
+
+namespace BoostPOW {
+
+    bool job_snapshot::current (const working &job) const {
+        return Puzzle.value () == job.value () && data::size (Puzzle.Prevouts) == data::size (job.Prevouts);
+    }
+
+    snapshot_builder::snapshot_builder (maker make) :
+        Make {make}, Mutex {}, Wake {}, Stop {false}, Wanted {}, Pending {}, Ready {},
+        Builder {&snapshot_builder::run, this} {}
+
+    snapshot_builder::~snapshot_builder () {
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            Stop = true;
+        }
+
+        Wake.notify_all ();
+        Builder.join ();
+    }
+
+    void snapshot_builder::prepare (std::vector<std::pair<digest256, working>> jobs) {
+        std::lock_guard<std::mutex> lock (Mutex);
+
+        Wanted.clear ();
+        Pending.clear ();
+        for (auto &[id, job] : jobs) {
+            Wanted.insert (id);
+            if (auto r = Ready.find (id); r != Ready.end () && r->second->current (job)) continue;
+            Pending.emplace_back (id, std::move (job));
+        }
+
+        std::erase_if (Ready, [this] (const auto &r) {
+            return !Wanted.contains (r.first);
+        });
+
+        if (Pending.size () > 0) Wake.notify_one ();
+    }
+
+    snapshot snapshot_builder::take (const digest256 &id, const working &job) {
+        std::lock_guard<std::mutex> lock (Mutex);
+
+        auto r = Ready.find (id);
+        if (r == Ready.end ()) return nullptr;
+
+        snapshot s = r->second;
+        Ready.erase (r);
+        return s->current (job) ? s : nullptr;
+    }
+
+    size_t snapshot_builder::ready () {
+        std::lock_guard<std::mutex> lock (Mutex);
+        return Ready.size ();
+    }
+
+    void snapshot_builder::run () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        while (true) {
+            Wake.wait (lock, [this] () {
+                return Stop || Pending.size () > 0;
+            });
+
+            if (Stop) return;
+
+            auto next = std::move (Pending.front ());
+            Pending.pop_front ();
+            lock.unlock ();
+
+            snapshot made {};
+            try {
+                made = Make (next.first, next.second);
+            } catch (const std::exception &e) {
+                logger::log (logger::warning, "job_snapshot.error", JSON {
+                    {"script_hash", write (next.first)},
+                    {"error", e.what ()}
+                });
+            }
+
+            lock.lock ();
+
+            // the job may have stopped being wanted while we were making it.
+            if (made != nullptr && Wanted.contains (next.first)) Ready[next.first] = made;
+        }
+    }
+
+}
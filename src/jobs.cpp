@@ -3,13 +3,13 @@
 
 namespace BoostPOW {
 
-    double working::weight (double minimum_profitability, double tilt) const {
+    double working::weight (double minimum_profitability, double tilt, uint32 workers) const {
         if (this->profitability () < minimum_profitability) return 0;
 
         double factor = this->difficulty () / (this->difficulty () + tilt);
 
         double weight = 1;
-        for (int i = 0; i < this->Workers.size (); i++) weight *= factor;
+        for (int i = 0; i < workers; i++) weight *= factor;
 
         return weight * (this->profitability () - minimum_profitability);
     }
@@ -120,6 +120,7 @@ namespace BoostPOW {
         }
 
         Bitcoin::secret n = Keys->next ();
+        Drawn++;
         digest160 a = Bitcoin::Hash160 (n.to_public ());
 
         if (!Past.contains (a)) Past = Past.insert (a, n);
@@ -133,6 +134,7 @@ namespace BoostPOW {
 
         while (data::size (Next) < MaxLookAhead) {
             Bitcoin::secret n = Keys->next ();
+            Drawn++;
             digest160 a = Bitcoin::Hash160 (n.to_public ());
 
             Next = Next.append (n);
@@ -142,4 +144,14 @@ namespace BoostPOW {
 
         return Bitcoin::secret {};
     }
+
+    void map_key_database::restore (uint32 drawn) {
+        while (Drawn < drawn) {
+            Bitcoin::secret n = Keys->next ();
+            Drawn++;
+            digest160 a = Bitcoin::Hash160 (n.to_public ());
+
+            if (!Past.contains (a)) Past = Past.insert (a, n);
+        }
+    }
 }
@@ -0,0 +1,211 @@
+#include <json_stream.hpp>
+#include <gigamonkey/boost/boost.hpp>
+
+namespace BoostPOW::json_stream {
+
+    namespace {
+
+        // a job has a script of a few hundred hex characters and a UTXO has a
+        // 64 character hash, so these are generous lower bounds on the size of
+        // one entry. A vector reserved with them is never reallocated.
+        constexpr size_t smallest_job = 160;
+        constexpr size_t smallest_utxo = 64;
+
+        // what a handler needs to know about a JSON value.
+        struct value {
+            enum type {
+                none,
+                integer,
+                string
+            };
+
+            type Type {none};
+            int64 Integer {0};
+            std::string String {};
+        };
+
+        // Collects the fields of the objects in an array and gives them to
+        // Read as each object ends. Depth is how many containers are open
+        // when one of these objects begins: one for a bare array and two for
+        // an array under a key of the outer object. Anything nested in one
+        // of the objects is skipped.
+        template <typename entry, size_t fields> struct objects : nlohmann::json_sax<JSON> {
+            using number_integer_t = JSON::number_integer_t;
+            using number_unsigned_t = JSON::number_unsigned_t;
+            using number_float_t = JSON::number_float_t;
+            using string_t = JSON::string_t;
+            using binary_t = JSON::binary_t;
+
+            std::vector<entry> &Entries;
+            const std::array<const char *, fields> &Names;
+            entry (*Read) (const std::array<value, fields> &);
+            size_t Depth;
+
+            // the key of the array in the outer object, if there is one.
+            const char *Under;
+
+            // containers open now.
+            size_t Open {0};
+
+            // whether the last key of the outer object was Under.
+            bool UnderKey {false};
+
+            // whether we are inside the array, and whether we have ever been.
+            bool Active {false};
+            bool Found {false};
+
+            // the field whose value comes next, if any.
+            int Field {-1};
+            std::array<value, fields> Values {};
+            std::string Error {};
+
+            objects (std::vector<entry> &e, const std::array<const char *, fields> &names,
+                entry (*read) (const std::array<value, fields> &), const char *under) :
+                Entries {e}, Names {names}, Read {read}, Depth {under == nullptr ? 1u : 2u}, Under {under} {}
+
+            // strings are copied rather than moved so that neither the parser's
+            // buffer nor ours has to grow again for the next one.
+            bool set (value::type t, int64 n = 0, const string_t *x = nullptr) {
+                if (Field >= 0 && Active && Open == Depth + 1) {
+                    value &v = Values[Field];
+                    v.Type = t;
+                    v.Integer = n;
+                    if (x != nullptr) v.String.assign (*x);
+                }
+
+                Field = -1;
+                return true;
+            }
+
+            bool null () override {
+                return set (value::none);
+            }
+
+            bool boolean (bool) override {
+                return set (value::none);
+            }
+
+            bool number_integer (number_integer_t x) override {
+                return set (value::integer, int64 (x));
+            }
+
+            bool number_unsigned (number_unsigned_t x) override {
+                if (x > number_unsigned_t (std::numeric_limits<int64>::max ())) return set (value::none);
+                return set (value::integer, int64 (x));
+            }
+
+            bool number_float (number_float_t, const string_t &) override {
+                return set (value::none);
+            }
+
+            bool string (string_t &x) override {
+                return set (value::string, 0, &x);
+            }
+
+            bool binary (binary_t &) override {
+                return set (value::none);
+            }
+
+            bool start_object (std::size_t) override {
+                if (Active && Open == Depth) for (value &v : Values) v.Type = value::none;
+                Field = -1;
+                Open++;
+                return true;
+            }
+
+            bool key (string_t &k) override {
+                Field = -1;
+                if (Active && Open == Depth + 1) {
+                    for (size_t i = 0; i < fields; i++) if (k == Names[i]) Field = int (i);
+                } else if (Under != nullptr && Open == 1) UnderKey = k == Under;
+                return true;
+            }
+
+            bool end_object () override {
+                Open--;
+                if (Active && Open == Depth) Entries.push_back (Read (Values));
+                return true;
+            }
+
+            bool start_array (std::size_t) override {
+                if (Open == Depth - 1 && (Under == nullptr || UnderKey)) Active = Found = true;
+                Field = -1;
+                Open++;
+                return true;
+            }
+
+            bool end_array () override {
+                Open--;
+                if (Open == Depth - 1) Active = false;
+                return true;
+            }
+
+            bool parse_error (std::size_t, const std::string &, const nlohmann::detail::exception &e) override {
+                Error = e.what ();
+                return false;
+            }
+        };
+
+        template <typename entry, size_t fields> void parse (std::string_view body, objects<entry, fields> &handler) {
+            if (!JSON::sax_parse (body.begin (), body.end (), &handler) || handler.Error != "")
+                throw data::exception {} << "invalid JSON: " << handler.Error;
+            if (!handler.Found) throw data::exception {"expected array not found"};
+        }
+
+        const value &required (const value &v, value::type t, const char *name) {
+            if (v.Type != t) throw data::exception {} << "missing or invalid field " << name;
+            return v;
+        }
+
+        digest256 read_txid (const value &v, const char *name) {
+            digest256 txid {string {"0x"} + required (v, value::string, name).String};
+            if (!txid.valid ()) throw data::exception {} << "cannot read " << name;
+            return txid;
+        }
+
+        const std::array<const char *, 4> job_fields {"txid", "vout", "value", "script"};
+
+        Bitcoin::prevout read_job (const std::array<value, 4> &v) {
+            digest256 txid = read_txid (v[0], "txid");
+            uint32 index = uint32 (required (v[1], value::integer, "vout").Integer);
+            int64 satoshis = required (v[2], value::integer, "value").Integer;
+
+            maybe<bytes> script = encoding::hex::read (required (v[3], value::string, "script").String);
+            if (!bool (script)) throw data::exception {"script should be in hex format"};
+            if (!Boost::output_script {*script}.valid ()) throw data::exception {"invalid boost script"};
+
+            return Bitcoin::prevout {
+                Bitcoin::outpoint {txid, index},
+                Bitcoin::output {Bitcoin::satoshi {satoshis}, *script}};
+        }
+
+        const std::array<const char *, 4> utxo_fields {"tx_hash", "tx_pos", "value", "height"};
+
+        UTXO read_utxo (const std::array<value, 4> &v) {
+            UTXO u {};
+            u.Outpoint = Bitcoin::outpoint {read_txid (v[0], "tx_hash"), uint32 (required (v[1], value::integer, "tx_pos").Integer)};
+            u.Value = Bitcoin::satoshi {required (v[2], value::integer, "value").Integer};
+            u.Height = uint32 (required (v[3], value::integer, "height").Integer);
+            if (!u.valid ()) throw data::exception {"UTXO has no value"};
+            return u;
+        }
+
+    }
+
+    std::vector<Bitcoin::prevout> read_jobs (std::string_view body) {
+        std::vector<Bitcoin::prevout> jobs {};
+        jobs.reserve (body.size () / smallest_job + 1);
+        objects<Bitcoin::prevout, 4> handler {jobs, job_fields, &read_job, "jobs"};
+        parse (body, handler);
+        return jobs;
+    }
+
+    std::vector<UTXO> read_unspent (std::string_view body) {
+        std::vector<UTXO> utxos {};
+        utxos.reserve (body.size () / smallest_utxo + 1);
+        objects<UTXO, 4> handler {utxos, utxo_fields, &read_utxo, nullptr};
+        parse (body, handler);
+        return utxos;
+    }
+
+}
@@ -1,17 +1,317 @@
 #include <logger.hpp>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <memory>
 #include <mutex>
+#include <map>
 
 namespace logger {
-  std::mutex Mutex;
 
-  void log(std::string event, json j) {
-    std::lock_guard<std::mutex> lock(Mutex);
+  std::atomic<int> Level {info};
 
-    boost::posix_time::ptime timestamp { boost::posix_time::microsec_clock::universal_time() };
+  namespace {
 
-    std::cout << json{{"event", event}, {"timestamp", to_iso_extended_string(timestamp)}, {"message", j} }.dump() << std::endl;
+    using clock = std::chrono::system_clock;
 
+    struct entry {
+      level Level;
+      clock::time_point Timestamp;
+      std::string Event;
+      json Message;
+    };
+
+    // single producer, single consumer ring. Each logging thread owns one of these
+    // and the writer thread is the only consumer.
+    struct queue {
+      static constexpr size_t Capacity = 4096;
+
+      std::unique_ptr<std::optional<entry>[]> Entries {new std::optional<entry>[Capacity]};
+
+      alignas (64) std::atomic<size_t> Head {0};
+      alignas (64) std::atomic<size_t> Tail {0};
+      alignas (64) std::atomic<uint64_t> Dropped {0};
+
+      bool push (entry &&e) {
+        size_t tail = Tail.load (std::memory_order_relaxed);
+        if (tail - Head.load (std::memory_order_acquire) == Capacity) {
+          Dropped.fetch_add (1, std::memory_order_relaxed);
+          return false;
+        }
+
+        Entries[tail % Capacity] = std::move (e);
+        Tail.store (tail + 1, std::memory_order_release);
+        return true;
+      }
+
+      template <typename f> void drain (f &&take) {
+        size_t head = Head.load (std::memory_order_relaxed);
+        size_t tail = Tail.load (std::memory_order_acquire);
+        for (; head != tail; head++) {
+          take (std::move (*Entries[head % Capacity]));
+          Entries[head % Capacity].reset ();
+        }
+
+        Head.store (head, std::memory_order_release);
+      }
+    };
+
+    // limits on how often an event may be written. Only touched under writer::Mutex.
+    struct filter {
+      uint32_t PerSecond {0};
+      uint32_t SampleRate {1};
+
+      uint64_t Seen {0};
+      clock::time_point Window {};
+      uint32_t WrittenInWindow {0};
+
+      bool pass (clock::time_point now) {
+        if (SampleRate > 1 && Seen++ % SampleRate != 0) return false;
+
+        if (PerSecond == 0) return true;
+
+        if (now - Window >= std::chrono::seconds {1}) {
+          Window = now;
+          WrittenInWindow = 0;
+        }
+
+        if (WrittenInWindow >= PerSecond) return false;
+
+        WrittenInWindow++;
+        return true;
+      }
+    };
+
+    const char *level_name (level l) {
+      switch (l) {
+        case trace: return "trace";
+        case debug: return "debug";
+        case info: return "info";
+        case warning: return "warning";
+        case error: return "error";
+        default: return "off";
+      }
+    }
+
+    struct writer {
+      std::mutex Mutex;
+      std::condition_variable Wake;
+      std::condition_variable Flushed;
+
+      std::vector<std::shared_ptr<queue>> Queues;
+
+      // queues of threads that have exited, to be drained once more and forgotten.
+      std::vector<std::shared_ptr<queue>> Retired;
+
+      std::map<std::string, filter> Filters;
+      format Format {format::JSON};
+      std::ostream *Out {&std::cout};
+
+      uint64_t FlushRequested {0};
+      uint64_t FlushCompleted {0};
+
+      bool Stop {false};
+      std::thread Thread;
+
+      writer () : Thread {[this] () { run (); }} {}
+
+      ~writer () {
+        {
+          std::lock_guard<std::mutex> lock (Mutex);
+          Stop = true;
+        }
+
+        Wake.notify_one ();
+        Thread.join ();
+      }
+
+      std::shared_ptr<queue> add_queue () {
+        auto q = std::make_shared<queue> ();
+        std::lock_guard<std::mutex> lock (Mutex);
+        Queues.push_back (q);
+        return q;
+      }
+
+      // called by the thread that owns the queue as it exits, so nothing else
+      // will push to it. Only the writer thread drains queues.
+      void remove_queue (const std::shared_ptr<queue> &q) {
+        std::lock_guard<std::mutex> lock (Mutex);
+        std::erase (Queues, q);
+        Retired.push_back (q);
+      }
+
+      static void write (std::string &out, entry &e, format f) {
+        if (f == format::binary) {
+          auto cbor = json::to_cbor (json {
+            {"event", e.Event},
+            {"level", int (e.Level)},
+            {"timestamp", std::chrono::duration_cast<std::chrono::microseconds> (e.Timestamp.time_since_epoch ()).count ()},
+            {"message", std::move (e.Message)}});
+
+          uint32_t size = cbor.size ();
+          for (int i = 0; i < 4; i++) out.push_back (char ((size >> (8 * i)) & 0xff));
+          out.append (cbor.begin (), cbor.end ());
+          return;
+        }
+
+        auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds> (e.Timestamp.time_since_epoch ()).count ();
+        boost::posix_time::ptime timestamp = boost::posix_time::from_time_t (since_epoch / 1000000) +
+          boost::posix_time::microseconds (since_epoch % 1000000);
+
+        out += json {
+          {"event", e.Event},
+          {"level", level_name (e.Level)},
+          {"timestamp", to_iso_extended_string (timestamp)},
+          {"message", std::move (e.Message)}}.dump ();
+        out += '\n';
+      }
+
+      // move everything out of the queues and write it in one go. Called by the
+      // writer thread without Mutex, which is only taken to look at the list of
+      // queues and the filters, so that a thread that starts or exits never
+      // waits on the output.
+      void write_batch () {
+        std::vector<std::shared_ptr<queue>> queues;
+        {
+          std::lock_guard<std::mutex> lock (Mutex);
+          queues = Queues;
+          queues.insert (queues.end (), Retired.begin (), Retired.end ());
+          Retired.clear ();
+        }
+
+        std::vector<entry> batch;
+        uint64_t dropped = 0;
+        for (const auto &q : queues) {
+          q->drain ([&batch] (entry &&e) {
+            batch.push_back (std::move (e));
+          });
+
+          dropped += q->Dropped.exchange (0, std::memory_order_relaxed);
+        }
+
+        if (dropped > 0) batch.push_back (entry {warning, clock::now (), "logger.dropped", json {{"events", dropped}}});
+
+        if (batch.empty ()) return;
+
+        std::stable_sort (batch.begin (), batch.end (), [] (const entry &a, const entry &b) {
+          return a.Timestamp < b.Timestamp;
+        });
+
+        format f;
+        std::ostream *o;
+        {
+          std::lock_guard<std::mutex> lock (Mutex);
+          f = Format;
+          o = Out;
+          std::erase_if (batch, [this] (const entry &e) {
+            auto x = Filters.find (e.Event);
+            return x != Filters.end () && !x->second.pass (e.Timestamp);
+          });
+        }
+
+        std::string out;
+        for (entry &e : batch) write (out, e, f);
+
+        o->write (out.data (), out.size ());
+        o->flush ();
+      }
+
+      void run () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        while (true) {
+          Wake.wait_for (lock, std::chrono::milliseconds {20});
+
+          uint64_t requested = FlushRequested;
+          bool stop = Stop;
+
+          lock.unlock ();
+          write_batch ();
+          lock.lock ();
+
+          if (requested != FlushCompleted) {
+            FlushCompleted = requested;
+            Flushed.notify_all ();
+          }
+
+          if (stop) return;
+        }
+      }
+
+      void flush () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        uint64_t ticket = ++FlushRequested;
+        Wake.notify_one ();
+        Flushed.wait (lock, [this, ticket] () {
+          return FlushCompleted >= ticket || Stop;
+        });
+      }
+
+      static writer &get () {
+        static writer Writer {};
+        return Writer;
+      }
+    };
+
+    // unregisters the thread's queue when the thread exits. The writer is
+    // made before the first queue, so it is still there when the last goes.
+    struct local_queue {
+      std::shared_ptr<queue> Queue;
+
+      local_queue () : Queue {writer::get ().add_queue ()} {}
+
+      ~local_queue () {
+        writer::get ().remove_queue (Queue);
+      }
+    };
+
+    queue &thread_queue () {
+      thread_local local_queue Local {};
+      return *Local.Queue;
+    }
   }
 
-}
+  void set_level (level l) {
+    Level.store (l, std::memory_order_relaxed);
+  }
+
+  void set_format (format f) {
+    auto &w = writer::get ();
+    std::lock_guard<std::mutex> lock (w.Mutex);
+    w.Format = f;
+  }
+
+  void set_output (std::ostream &o) {
+    auto &w = writer::get ();
+    std::lock_guard<std::mutex> lock (w.Mutex);
+    w.Out = &o;
+  }
+
+  level read_level (const std::string &x) {
+    for (level l : {trace, debug, info, warning, error, off}) if (x == level_name (l)) return l;
+    throw std::invalid_argument {std::string {"unknown log level "} + x};
+  }
+
+  void limit (const std::string &event, uint32_t per_second) {
+    auto &w = writer::get ();
+    std::lock_guard<std::mutex> lock (w.Mutex);
+    w.Filters[event].PerSecond = per_second;
+  }
+
+  void sample (const std::string &event, uint32_t n) {
+    auto &w = writer::get ();
+    std::lock_guard<std::mutex> lock (w.Mutex);
+    w.Filters[event].SampleRate = n == 0 ? 1 : n;
+  }
+
+  void write (level l, std::string event, json j) {
+    thread_queue ().push (entry {l, clock::now (), std::move (event), std::move (j)});
+  }
+
+  void flush () {
+    writer::get ().flush ();
+  }
 
+}
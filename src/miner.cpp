@@ -3,51 +3,93 @@
 #include <sv/uint256.h>
 #include <miner.hpp>
 #include <logger.hpp>
+#include <governor.hpp>
 #include <math.h>
+#include <cmath>
+#include <algorithm>
+#include <set>
 
 
 #include <data/net/websocket.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <csignal>
+#include <optional>
 
 namespace BoostPOW {
     using uint256 = Gigamonkey::uint256;
 
+    work::proof cpu_solve (const work::puzzle &p, const work::solution &initial, double max_time_seconds,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch) {
+        return cpu_solve (p, p.Candidate.Target.expand (), initial, max_time_seconds, hashes, epoch);
+    }
+
     // A cpu miner function. 
-    work::proof cpu_solve (const work::puzzle &p, const work::solution &initial, double max_time_seconds) {
+    work::proof cpu_solve (const work::puzzle &p, const uint256 &target, const work::solution &initial,
+        double max_time_seconds, std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch) {
         
         uint32 initial_time = initial.Share.Timestamp.Value;
         uint32 local_initial_time = Bitcoin::timestamp::now ().Value;
         
-        uint64_big extra_nonce_2; 
-        std::copy (initial.Share.ExtraNonce2.begin (), initial.Share.ExtraNonce2.end (), extra_nonce_2.begin ());
-        
-        uint256 target = p.Candidate.Target.expand ();
         if (target == 0) return {};
         
-        N total_hashes {0};
-        N nonce_increment {"0x0100000000"};
+        uint64 total_hashes {0};
+        uint64 hashes_reported {0};
         uint32 display_increment = 0x00800000;
+
+        uint64 initial_epoch = epoch == nullptr ? 0 : epoch->load (std::memory_order_relaxed);
+
+        auto report = [hashes, &total_hashes, &hashes_reported] () {
+            if (hashes != nullptr) hashes->fetch_add (total_hashes - hashes_reported, std::memory_order_relaxed);
+            hashes_reported = total_hashes;
+        };
         
         work::proof pr {p, initial};
+
+        // the merkle root depends only on the extra nonces, so the work string is
+        // made once for the range and only its nonce and timestamp are changed.
+        work::string ws = pr.string ();
         
         uint32 begin {Bitcoin::timestamp::now ()};
+
+        governor::begin ();
         
         while (true) {
-            uint256 hash = pr.string ().hash ();
+            ws.Nonce = pr.Solution.Share.Nonce;
+            uint256 hash = ws.hash ();
             total_hashes++;
             
             if (pr.Solution.Share.Nonce % display_increment == 0) {
+                report ();
                 pr.Solution.Share.Timestamp.Value = initial_time + uint32 (Bitcoin::timestamp::now ().Value - local_initial_time);
+                ws.Timestamp = pr.Solution.Share.Timestamp;
                 
                 if (uint32 (pr.Solution.Share.Timestamp) - begin > max_time_seconds) return {};
             }
+
+            if ((pr.Solution.Share.Nonce & 0xffff) == 0) {
+                // keep to the duty cycle in slices of 2^16 hashes.
+                governor::rest ();
+
+                // stop early if we have been given something new to work on.
+                if (epoch != nullptr && epoch->load (std::memory_order_relaxed) != initial_epoch) {
+                    report ();
+                    return {};
+                }
+            }
             
-            if (hash < target) return pr;
+            if (hash < target) {
+                report ();
+                return pr;
+            }
             
             pr.Solution.Share.Nonce++;
             
+            // we have tried every nonce with this extra nonce 2. The caller
+            // decides what range to search next.
             if (pr.Solution.Share.Nonce == 0) {
-                extra_nonce_2++;
-                std::copy (extra_nonce_2.begin (), extra_nonce_2.end (), pr.Solution.Share.ExtraNonce2.begin ());
+                report ();
+                return {};
             }
         }
         
@@ -70,7 +112,7 @@ namespace BoostPOW {
         };
     }
     
-    work::proof solve (random &r, const work::puzzle& p, double max_time_seconds) {
+    work::proof solve (random &r, const work::puzzle& p, double max_time_seconds, std::atomic<uint64> *hashes = nullptr) {
         
         Stratum::session_id extra_nonce_1 {r.uint32 ()};
         uint64_big extra_nonce_2 {r.uint64 ()};
@@ -79,9 +121,62 @@ namespace BoostPOW {
         
         if (p.Mask != -1) initial.Share.Bits = r.uint32 ();
         
-        return cpu_solve (p, initial, max_time_seconds);
+        return cpu_solve (p, initial, max_time_seconds, hashes);
         
     }
+
+    namespace {
+        // stops if epoch is no longer initial_epoch.
+        work::proof solve_ranges (search_partition &s, const work::puzzle &p, const uint256 &target,
+            double max_time_seconds, std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch, uint64 initial_epoch) {
+            auto end = std::chrono::steady_clock::now () + std::chrono::duration<double> (max_time_seconds);
+
+            while (true) {
+                double remaining = std::chrono::duration<double> (end - std::chrono::steady_clock::now ()).count ();
+                if (remaining <= 0) return {};
+                if (epoch != nullptr && epoch->load (std::memory_order_relaxed) != initial_epoch) return {};
+
+                work::proof proof = cpu_solve (p, target, s.next (p), remaining, hashes, epoch);
+                if (proof.valid ()) return proof;
+            }
+        }
+
+        uint64 epoch_of (const std::atomic<uint64> *epoch) {
+            return epoch == nullptr ? 0 : epoch->load (std::memory_order_relaxed);
+        }
+    }
+
+    work::proof solve (search_partition &s, const work::puzzle &p, double max_time_seconds,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch) {
+        return solve_ranges (s, p, p.Candidate.Target.expand (), max_time_seconds, hashes, epoch, epoch_of (epoch));
+    }
+
+    work::proof solve (search_partition &s, const job_snapshot &job, double max_time_seconds,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch) {
+        return solve_ranges (s, job.Work, job.Target, max_time_seconds, hashes, epoch, epoch_of (epoch));
+    }
+
+    std::vector<micro_solution> solve_batch (search_partition &s, const micro_batch &batch,
+        std::atomic<uint64> *hashes, const std::atomic<uint64> *epoch) {
+        std::vector<micro_solution> solutions {};
+        if (batch.size () == 0 || batch.ThreadHashrate <= 0) return solutions;
+
+        // the epoch when the batch was begun, rather than when each job is.
+        uint64 initial_epoch = epoch_of (epoch);
+
+        for (const micro_job &job : batch.Jobs) {
+            if (epoch_of (epoch) != initial_epoch) break;
+
+            double expected_seconds = job->Puzzle.difficulty () * 4294967296. / batch.ThreadHashrate;
+
+            // micro jobs almost never need more than one range.
+            work::proof proof = solve_ranges (s, job->Work, job->Target,
+                micro_job_patience * expected_seconds, hashes, epoch, initial_epoch);
+            if (proof.valid ()) solutions.push_back (micro_solution {job, proof.Solution});
+        }
+
+        return solutions;
+    }
     
     Bitcoin::transaction redeem_puzzle (const Boost::puzzle &puzzle, const work::solution &solution, list<Bitcoin::output> pay) {
         bytes redeem_tx = puzzle.redeem (solution, pay);
@@ -154,7 +249,7 @@ namespace BoostPOW {
         
     }
     
-    void mining_thread (work::selector *m, random *r, uint32 thread_number) {
+    void mining_thread (work::selector *m, search_partition *s, uint32 thread_number, std::atomic<uint64> *hashes) {
         logger::log ("begin thread", JSON (thread_number));
         try {
             work::puzzle puzzle {};
@@ -163,7 +258,7 @@ namespace BoostPOW {
                 puzzle = m->select ();
                 if (!puzzle.valid ()) break;
                 
-                work::proof proof = solve (*r, puzzle, 10);
+                work::proof proof = solve (*s, puzzle, 10, hashes);
                 if (proof.valid ()) {
                     logger::log ("solution found in thread", JSON (thread_number));
                     m->solved (proof.Solution);
@@ -174,17 +269,54 @@ namespace BoostPOW {
             std::cout << "Error " << x.what () << std::endl;
         }
         
-        logger::log ("end thread", JSON (thread_number));
-        delete r;
+        logger::log ("end thread", JSON {{"thread", thread_number}, {"ranges", s->claimed ()}});
+        delete s;
+    }
+    
+    void redeeming_thread (redeemer *m, search_partition *s, uint32 thread_number, std::atomic<uint64> *hashes) {
+        logger::log ("begin thread", JSON (thread_number));
+        try {
+            while (m->wait_for_job ()) {
+                if (auto batch = m->take_batch (); batch.size () > 0) {
+                    auto solutions = solve_batch (*s, batch, hashes, &m->Epoch);
+                    logger::log ("micro_batch.solved", JSON {
+                        {"thread", thread_number},
+                        {"jobs", batch.size ()},
+                        {"solved", solutions.size ()}
+                    });
+
+                    m->submit_batch (solutions);
+                    continue;
+                }
+
+                // keep going on whatever job is published until there isn't one.
+                while (snapshot job = m->job ()) {
+                    work::proof proof = solve (*s, *job, 10, hashes, &m->Epoch);
+                    if (proof.valid ()) {
+                        logger::log ("solution found in thread", JSON (thread_number));
+                        m->solved (job, proof.Solution);
+                        logger::log ("solution submitted", JSON (thread_number));
+                    }
+                }
+            }
+        } catch (const std::exception &x) {
+            std::cout << "Error " << x.what () << std::endl;
+        }
+
+        logger::log ("end thread", JSON {{"thread", thread_number}, {"ranges", s->claimed ()}});
+        delete s;
     }
     
     void multithreaded::start_threads () {
         if (Workers.size() != 0) return;
         std::cout << "starting " << Threads << " threads." << std::endl;
         for (int i = 1; i <= Threads; i++) 
-            Workers.emplace_back (&mining_thread,
-                &static_cast<work::selector &> (*this),
-                new casual_random {Seed + i}, i);
+            Workers.emplace_back ([this, i] () {
+                if (i <= CPUs.size ()) affinity::pin (CPUs[i - 1]);
+                // created after pinning so that it is on this thread's NUMA node.
+                mining_thread (&static_cast<work::selector &> (*this),
+                    new search_partition {WorkerID, uint16 (i)}, i, nullptr);
+            });
     }
     
     multithreaded::~multithreaded () {
@@ -196,18 +328,72 @@ namespace BoostPOW {
     void redeemer::solved (const work::solution &solution) {
         // shouldn't happen
         if (!solution.valid ()) return;
-        
-        if (work::proof {work::puzzle (Current.second), solution}.valid ()) submit (Current, solution);
-        
-        else if (work::proof {work::puzzle (Last.second), solution}.valid ()) submit (Last, solution);
+
+        snapshot current = job ();
+        snapshot last;
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            last = Last;
+        }
+
+        if (current != nullptr && work::proof {current->Work, solution}.valid ()) solved (current, solution);
+
+        else if (last != nullptr && work::proof {last->Work, solution}.valid ()) solved (last, solution);
+    }
+
+    void redeemer::solved (const snapshot &job, const work::solution &solution) {
+        submit (std::pair<digest256, Boost::puzzle> {job->ID, job->Puzzle}, solution);
     }
     
-    void redeemer::mine (const std::pair<digest256, Boost::puzzle> &p) {
+    void redeemer::mine (snapshot p) {
         std::unique_lock<std::mutex> lock (Mutex);
-        if (Last == std::pair<digest256, Boost::puzzle> {}) Last = Current;
+        if (Last == nullptr) Last = Current;
         Current = p;
-        if (Current.second.valid ()) this->pose (work::puzzle (Current.second));
-        else this->pose (work::puzzle {});
+        Batch = {};
+        Published.store (p, std::memory_order_release);
+        Epoch.fetch_add (1, std::memory_order_relaxed);
+        In.notify_all ();
+        this->pose (p != nullptr ? p->Work : work::puzzle {});
+    }
+
+    void redeemer::mine (micro_batch batch) {
+        std::unique_lock<std::mutex> lock (Mutex);
+        if (Last == nullptr) Last = Current;
+        Current = nullptr;
+        Batch = std::move (batch);
+        Published.store (nullptr, std::memory_order_release);
+        Epoch.fetch_add (1, std::memory_order_relaxed);
+        In.notify_all ();
+        this->pose (work::puzzle {});
+    }
+
+    micro_batch redeemer::take_batch () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        micro_batch batch = std::move (Batch);
+        Batch = {};
+        return batch;
+    }
+
+    bool redeemer::wait_for_job () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        In.wait (lock, [this] () {
+            return Stopped || Current != nullptr || Batch.size () > 0;
+        });
+
+        return !Stopped;
+    }
+
+    void redeemer::stop () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        Stopped = true;
+        Current = nullptr;
+        Published.store (nullptr, std::memory_order_release);
+        Epoch.fetch_add (1, std::memory_order_relaxed);
+        In.notify_all ();
+    }
+
+    void redeemer::submit_batch (const std::vector<micro_solution> &solutions) {
+        for (const micro_solution &x : solutions) solved (x.Job, x.Solution);
     }
     
     manager::manager (
@@ -217,52 +403,422 @@ namespace BoostPOW {
         uint64 random_seed, 
         double maximum_difficulty, 
         double minimum_profitability, 
-        uint64 min_value) : Mutex {},
+        uint64 min_value,
+        ptr<scheduling_policy> policy,
+        double competitor_hashrate,
+        double micro_job_seconds,
+        double aggregate_seconds) : Mutex {},
         Net {net}, Fees {f}, Keys {keys}, Addresses {addresses},
         MaxDifficulty {maximum_difficulty}, MinProfitability {minimum_profitability}, 
-        MinValue {min_value}, Random {random_seed}, Jobs {}, Redeemers {}, Mining {false} {}
+        MinValue {min_value}, Random {random_seed}, Jobs {}, Redeemers {}, Mining {false}, Paused {false},
+        Policy {policy}, ThreadHashrate {market {}.ThreadHashrate}, CompetitorHashrate {competitor_hashrate},
+        AllocatedHashrate {0}, FirstSeen {}, LastHashes {0}, LastMeasured {std::chrono::steady_clock::now ()},
+        MicroJobSeconds {micro_job_seconds}, Batches {}, PayScripts {}, SparePayScripts {}, BountyKeys {}, SpareKeys {},
+        Templates {[this] (const Boost::puzzle &puzzle) -> list<Bitcoin::output> {
+            return this->pay (puzzle);
+        }, random_seed + 1}, AggregateSeconds {aggregate_seconds}, Aggregator {nullptr},
+        BoardName {}, PublishJobs {false}, Board {nullptr}, BoardVersion {0}, BoardPublished {0},
+        Precompiled {[this] (const digest256 &id, const working &job) -> snapshot {
+            Bitcoin::secret key;
+            {
+                std::unique_lock<std::mutex> lock (Mutex);
+                key = key_for (id, job);
+            }
+
+            return std::make_shared<const job_snapshot> (id, Boost::puzzle {job, key});
+        }} {
+
+        if (aggregate_seconds > 0) Aggregator = std::make_unique<aggregator> (aggregate_seconds, 100, f,
+            [this] () -> bytes {
+                std::unique_lock<std::mutex> lock (Mutex);
+                return pay_to_address::script (Addresses.next ().Digest);
+            }, [this] (const bytes &tx) {
+                // the puzzles are tried separately if this throws.
+                if (!Net.broadcast_solution (tx)) throw data::exception {"broadcast failed"};
+            });
+    }
+
+    bool manager::hold (const working &job) {
+        if (Aggregator == nullptr) return false;
+
+        // nobody else can redeem a contract job, so there is no hurry.
+        if (Boost::output_script::type (job.Script) == Boost::contract) return true;
+
+        // someone else could solve a bounty job while it waits, so we only wait if
+        // the value we expect to lose that way is less than the fee we save.
+        double risk = 1 - std::exp (-CompetitorHashrate * AggregateSeconds / expected_hashes (job));
+        return double (job.value ()) * risk < Fees.get () * aggregator::overhead ();
+    }
+
+    list<Bitcoin::output> manager::pay (const Boost::puzzle &puzzle) {
+        double fee_rate {Fees.get ()};
+        if (fee_rate <= .0001) throw data::exception {"error: fee rate too small"};
+
+        bytes pay_script;
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            pay_script = pay_script_for (puzzle.id ());
+        }
+
+        auto value = puzzle.value ();
+        auto estimated_size = BoostPOW::estimate_size (puzzle.expected_size (), pay_script.size ());
+        Bitcoin::satoshi fee {int64 (ceil (fee_rate * estimated_size))};
+
+        if (fee > value) throw data::exception {"Cannot pay tx fee with boost output"};
+
+        return {Bitcoin::output {value - fee, pay_script}};
+    }
+
+    bytes manager::pay_script_for (const digest256 &id) {
+        if (auto p = PayScripts.find (id); p != PayScripts.end ()) return p->second;
+
+        bytes script;
+        if (SparePayScripts.size () > 0) {
+            script = std::move (SparePayScripts.back ());
+            SparePayScripts.pop_back ();
+        } else script = pay_to_address::script (Addresses.next ().Digest);
+
+        PayScripts[id] = script;
+        return script;
+    }
+
+    void manager::release_pay_script (const digest256 &id, bool redeemed) {
+        auto p = PayScripts.find (id);
+        if (p == PayScripts.end ()) return;
+        if (!redeemed) SparePayScripts.push_back (std::move (p->second));
+        PayScripts.erase (p);
+    }
         
     int manager::add_new_miner (ptr<redeemer> r) {
+        std::unique_lock<std::mutex> lock (Mutex);
         Redeemers.push_back (r);
+        if (Jobs.Jobs.size () > 0) rebalance ();
         return Redeemers.size ();
     }
 
-    void manager::select_job (int i) {
+    void manager::remove_miner (ptr<redeemer> r) {
+        std::unique_lock<std::mutex> lock (Mutex);
+
+        int removed = 0;
+        for (int i = 1; i <= Redeemers.size (); i++) if (Redeemers[i - 1] == r) removed = i;
+        if (removed == 0) return;
 
-        if (Jobs.Jobs.size () == 0) {
-            Mining = false;
-            return;
+        unassign (removed);
+        Redeemers.erase (Redeemers.begin () + (removed - 1));
+
+        // threads after the one removed move down by one.
+        auto renumber = [removed] (int i) -> int {
+            return i > removed ? i - 1 : i;
         };
 
-        auto selected = Jobs.random_select (Random, MinProfitability);
-        if (selected == Jobs.Jobs.end ()) {
+        for (auto &job : Jobs.Jobs) {
+            list<int> workers {};
+            for (int w : job.second.Workers) workers = workers << renumber (w);
+            job.second.Workers = workers;
+        }
+
+        std::map<int, std::vector<digest256>> batches {};
+        for (auto &[i, ids] : Batches) if (i != removed) batches[renumber (i)] = std::move (ids);
+        Batches = std::move (batches);
+
+        rebalance ();
+    }
+
+    market manager::current_market () {
+        market m {};
+        m.ThreadHashrate = ThreadHashrate;
+        m.CompetitorHashrate = CompetitorHashrate;
+        m.FeeRate = Fees.get ();
+        m.MinProfitability = MinProfitability;
+        return m;
+    }
 
-            logger::log ("worker.resting", JSON {
-                {"thread", JSON (i)}
+    void manager::unassign (int i) {
+        digest256 current = Redeemers[i - 1]->current ();
+        if (auto it = Jobs.Jobs.find (current); it != Jobs.Jobs.end ())
+            it->second.Workers = data::select (it->second.Workers, [i] (int x) -> bool {
+                return x != i;
             });
+    }
+
+    void manager::assign (int i, std::map<digest256, working>::iterator selected) {
+        unassign (i);
+        selected->second.Workers = selected->second.Workers << i;
+
+        logger::log ("job.selected", JSON {
+            {"thread", JSON (i)},
+            {"script_hash", BoostPOW::write (selected->first)},
+            {"value", int64 (selected->second.value ())},
+            {"profitability", selected->second.profitability ()},
+            {"difficulty", selected->second.difficulty ()}
+        });
+
+        Redeemers[i - 1]->mine (snapshot_of (selected));
+    }
+
+    snapshot manager::snapshot_of (std::map<digest256, working>::iterator job) {
+        snapshot &s = Snapshots[job->first];
+        if (s == nullptr) {
+            s = Precompiled.take (job->first, job->second);
+            if (s == nullptr) {
+                logger::log (logger::debug, "job_snapshot.not_ready", JSON {{"script_hash", BoostPOW::write (job->first)}});
+                s = std::make_shared<const job_snapshot> (job->first, make_puzzle (job->first, job->second));
+            }
+
+            Templates.prepare (job->first, s->Puzzle);
+        }
+
+        return s;
+    }
 
-            Redeemers[i - 1]->mine (std::pair<digest256, Boost::puzzle> {});
+    void manager::prepare_snapshots () {
+        // a few more than we could switch to at once.
+        constexpr size_t precompiled_jobs = 16;
 
-        } else {
-            selected->second.Workers = selected->second.Workers << i;
+        std::vector<std::map<digest256, working>::const_iterator> ranked {};
+        for (auto it = Jobs.Jobs.cbegin (); it != Jobs.Jobs.cend (); it++)
+            if (!Snapshots.contains (it->first)) ranked.push_back (it);
 
-            logger::log ("job.selected", JSON {
+        size_t n = std::min (ranked.size (), precompiled_jobs);
+        std::partial_sort (ranked.begin (), ranked.begin () + n, ranked.end (), [] (const auto &a, const auto &b) {
+            return a->second.profitability () > b->second.profitability ();
+        });
+
+        std::vector<std::pair<digest256, working>> wanted {};
+        for (size_t i = 0; i < n; i++) wanted.emplace_back (ranked[i]->first, ranked[i]->second);
+        Precompiled.prepare (std::move (wanted));
+    }
+
+    Bitcoin::secret manager::key_for (const digest256 &id, const working &job) {
+        if (Boost::output_script::type (job.Script) != Boost::bounty)
+            return Keys[Boost::output_script::miner_pubkey_hash (job.Script)];
+
+        if (auto k = BountyKeys.find (id); k != BountyKeys.end ()) return k->second;
+
+        Bitcoin::secret key;
+        if (SpareKeys.size () > 0) {
+            key = SpareKeys.back ();
+            SpareKeys.pop_back ();
+        } else key = Keys.next ();
+
+        BountyKeys[id] = key;
+        return key;
+    }
+
+    void manager::release_key (const digest256 &id, bool redeemed) {
+        auto k = BountyKeys.find (id);
+        if (k == BountyKeys.end ()) return;
+        if (!redeemed) SpareKeys.push_back (k->second);
+        BountyKeys.erase (k);
+    }
+
+    Boost::puzzle manager::make_puzzle (const digest256 &id, const working &job) {
+        return Boost::puzzle {job, key_for (id, job)};
+    }
+
+    bool manager::micro (const working &job) const {
+        return MicroJobSeconds > 0 && expected_hashes (job) < MicroJobSeconds * ThreadHashrate;
+    }
+
+    void manager::batch_micro_jobs (std::vector<int> &available) {
+        // a thread is given about this many seconds of work at a time.
+        constexpr double batch_seconds = 2;
+
+        std::set<digest256> batched {};
+        for (const auto &[i, ids] : Batches) batched.insert (ids.begin (), ids.end ());
+
+        std::vector<std::map<digest256, working>::iterator> micro_jobs {};
+        for (auto it = Jobs.Jobs.begin (); it != Jobs.Jobs.end (); it++)
+            if (micro (it->second) && !batched.contains (it->first)) micro_jobs.push_back (it);
+
+        std::sort (micro_jobs.begin (), micro_jobs.end (), [] (const auto &a, const auto &b) {
+            return a->second.profitability () > b->second.profitability ();
+        });
+
+        auto next = micro_jobs.begin ();
+        while (next != micro_jobs.end () && available.size () > 0) {
+            // prefer threads that are resting.
+            auto thread = std::find_if (available.begin (), available.end (), [this] (int i) -> bool {
+                return Redeemers[i - 1]->current () == digest256 {};
+            });
+
+            if (thread == available.end ()) thread--;
+            int i = *thread;
+            available.erase (thread);
+
+            micro_batch batch {{}, ThreadHashrate};
+            std::vector<digest256> ids {};
+            double seconds = 0;
+            for (; next != micro_jobs.end () && seconds < batch_seconds; next++) {
+                seconds += expected_hashes ((*next)->second) / ThreadHashrate;
+                batch.Jobs.push_back (snapshot_of (*next));
+                ids.push_back ((*next)->first);
+            }
+
+            unassign (i);
+            Batches[i] = ids;
+
+            logger::log ("micro_batch.assigned", JSON {
                 {"thread", JSON (i)},
-                {"script_hash", BoostPOW::write (selected->first)},
-                {"value", int64 (selected->second.value ())},
-                {"profitability", selected->second.profitability ()},
-                {"difficulty", selected->second.difficulty ()}
+                {"jobs", batch.size ()},
+                {"expected_seconds", seconds}
             });
 
-            Redeemers[i - 1]->mine (std::pair<digest256, Boost::puzzle>
-                {selected->first, Boost::puzzle {selected->second,
-                    Boost::output_script::type (selected->second.Script) == Boost::bounty ?
-                        Keys.next () : Keys[Boost::output_script::miner_pubkey_hash (selected->second.Script)] }});
+            Redeemers[i - 1]->mine (std::move (batch));
         }
+    }
+
+    void manager::rest (int i) {
+        if (Redeemers[i - 1]->current () == digest256 {}) return;
 
+        unassign (i);
+
+        logger::log ("worker.resting", JSON {
+            {"thread", JSON (i)}
+        });
+
+        Redeemers[i - 1]->mine (snapshot {});
     }
-    
-    void manager::run (bool websockets, uint32 refresh_interval) {
+
+    void manager::rebalance (bool reissue) {
+
+        if (Paused) {
+            for (int i = 1; i <= Redeemers.size (); i++) if (!Batches.contains (i)) rest (i);
+            Mining = Batches.size () > 0;
+            return;
+        }
+
+        if (Jobs.Jobs.size () == 0) {
+            Mining = Batches.size () > 0;
+            return;
+        };
+
+        market m = current_market ();
+        AllocatedHashrate = m.ThreadHashrate;
+
+        // threads that are working on a batch are left alone until they are done.
+        std::vector<int> available {};
+        for (int i = 1; i <= Redeemers.size (); i++) if (!Batches.contains (i)) available.push_back (i);
+
+        // micro jobs are handed out in batches and are not seen by the scheduling policy.
+        std::map<digest256, working> regular_jobs {};
+        if (MicroJobSeconds > 0) {
+            batch_micro_jobs (available);
+            for (const auto &job : Jobs.Jobs) if (!micro (job.second)) regular_jobs.insert (job);
+        }
+
+        auto target = Policy->allocate (MicroJobSeconds > 0 ? regular_jobs : Jobs.Jobs, available.size (), m, Random);
+
+        // threads that are already on a job that still needs them stay where they are.
+        std::map<digest256, uint32> kept;
+        std::vector<int> moving;
+        for (int i : available) {
+            digest256 current = Redeemers[i - 1]->current ();
+            auto t = target.find (current);
+            if (t == target.end () || kept[current] >= t->second) {
+                moving.push_back (i);
+                continue;
+            }
+
+            kept[current]++;
+            auto job = Jobs.Jobs.find (current);
+
+            // the job table has been replaced, so the puzzle may have a different set of outputs now.
+            if (reissue) {
+                assign (i, job);
+                continue;
+            }
+
+            bool registered = false;
+            for (int w : job->second.Workers) if (w == i) registered = true;
+            if (!registered) job->second.Workers = job->second.Workers << i;
+        }
+
+        for (const auto &[id, n] : target) {
+            auto job = Jobs.Jobs.find (id);
+            for (uint32 k = kept[id]; k < n && moving.size () > 0; k++) {
+                assign (moving.back (), job);
+                moving.pop_back ();
+            }
+        }
+
+        for (int i : moving) rest (i);
+
+        Mining = target.size () > 0 || Batches.size () > 0;
+
+        prepare_snapshots ();
+    }
+
+    void manager::measure_hashrate () {
+        auto now = this->now ();
+
+        uint64 hashes = 0;
+        uint32 active = 0;
+        for (int i = 1; i <= Redeemers.size (); i++) {
+            hashes += Redeemers[i - 1]->Hashes.load (std::memory_order_relaxed);
+            if (Redeemers[i - 1]->current () != digest256 {} || Batches.contains (i)) active++;
+        }
+
+        double seconds = std::chrono::duration<double> (now - LastMeasured).count ();
+        if (active > 0 && seconds > 0 && hashes > LastHashes)
+            ThreadHashrate = double (hashes - LastHashes) / seconds / active;
+
+        LastHashes = hashes;
+        LastMeasured = now;
+
+        logger::log ("hashrate", JSON {
+            {"thread_hashrate", ThreadHashrate},
+            {"active_threads", active},
+            {"competitor_hashrate", CompetitorHashrate}
+        });
+    }
+
+    void manager::tick () {
+        std::unique_lock<std::mutex> lock (Mutex);
+
+        measure_hashrate ();
+
+        // the allocation only needs to be redone if our hashrate has changed significantly.
+        if (Policy->periodic () || AllocatedHashrate == 0 ||
+            std::abs (ThreadHashrate - AllocatedHashrate) > .25 * AllocatedHashrate) rebalance ();
+    }
+
+    void manager::restore (const warm_start::state &s) {
+        int64 age = std::chrono::duration_cast<std::chrono::seconds> (
+            std::chrono::system_clock::now ().time_since_epoch ()).count () - s.Saved;
+
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            Keys.restore (s.KeysDrawn);
+        }
+
+        logger::log ("warm_start.restored", JSON {
+            {"age", age},
+            {"jobs", s.Jobs.Jobs.size ()},
+            {"keys", s.KeysDrawn}
+        });
+
+        // the first call to the API replaces these anyway.
+        if (age < 0 || age > warm_start::max_age_seconds) return;
+
+        update_jobs (s.Jobs);
+    }
+
+    warm_start::state manager::saved_state () {
+        // fees may come from the network, so they are read without the lock.
+        double fee_rate = Fees.get ();
+
+        std::unique_lock<std::mutex> lock (Mutex);
+        warm_start::state s {};
+        s.Saved = std::chrono::duration_cast<std::chrono::seconds> (
+            std::chrono::system_clock::now ().time_since_epoch ()).count ();
+        s.FeeRate = fee_rate;
+        s.KeysDrawn = Keys.Drawn;
+        s.Jobs = Jobs;
+        return s;
+    }
+
+    void manager::run (bool websockets, uint32 refresh_interval, const std::filesystem::path &state_file) {
         boost::asio::steady_timer timer (Net.IO);
         int count = 0;
 
@@ -270,79 +826,110 @@ namespace BoostPOW {
         
         bool websockets_running = false;
 
+        // a signal may come while a refresh is saving.
+        std::mutex saving;
+        auto save = [this, &state_file, &saving] () {
+            if (state_file.empty ()) return;
+            std::lock_guard<std::mutex> lock (saving);
+            try {
+                warm_start::save (state_file, saved_state ());
+            } catch (const std::exception &e) {
+                logger::log (logger::warning, "warm_start.save_failed", JSON {{"error", e.what ()}});
+            }
+        };
+
+        // handles websocket messages on the IO thread, whether they come from pow.co or a recording.
+        function<void (string_view)> on_message = [self = this->shared_from_this ()] (string_view x) {
+            if (self->Net.Recorder != nullptr) self->Net.Recorder->websocket (string (x));
+            std::cout << "read websockets message " << x << std::endl;
+            auto j = JSON::parse (x);
+            if (!pow_co::websockets_protocol_message::valid (j))
+                std::cout << "invalid websockets message received: " << j << std::endl;
+            else if (j["type"] == "boostpow.job.created") {
+                if (auto prevout = pow_co::websockets_protocol_message::job_created (j["content"]);
+                    bool (prevout)) self->new_job (*prevout);
+                else std::cout << "could not read websockets message " << j["content"] << std::endl;
+            } else if (j["type"] == "boostpow.proof.created") {
+                if (auto outpoint = pow_co::websockets_protocol_message::proof_created (j["content"]);
+                    bool (outpoint)) self->solved_job (*outpoint);
+                else std::cout << "could not read websockets message " << j["content"] << std::endl;
+            } else std::cout << "unknown message received: " << j << std::endl;
+        };
+
+        // only touched on the IO thread.
+        function<void ()> open_websockets = [self = this->shared_from_this (), &websockets_running, &on_message] () {
+            if (websockets_running) return;
+            try {
+                net::websocket::open (self->Net.IO,
+                    net::URL (net::URL::make {}.protocol ("ws").port (5201).domain_name ("pow.co").path ("/")), 
+                    nullptr,
+                    [] (boost::system::error_code err) {
+                        throw exception {} << "websockets error " << err;
+                    }, [&websockets_running] () {
+                        websockets_running = false;
+                        std::cout << "websockets closed..." << std::endl;
+                    },
+                    [&websockets_running, &on_message] (ptr<net::session<const string &>> o) {
+                        websockets_running = true;
+                        return on_message;
+                    });
+                
+            } catch (boost::system::system_error const& e) {
+                std::cout << "caught system error: " << e.what () << std::endl;
+            } catch (boost::exception const& e) {
+                std::cout << "caught boost exception: " << std::endl;
+            } catch (const std::exception& e) {
+                std::cout << "caught exception: " << e.what () << std::endl;
+            }
+        };
+
+        // A refresh makes many blocking HTTP calls and can take minutes, so it
+        // runs on a thread of its own. Net.IO only dispatches timers, signals
+        // and websocket messages, so pushed jobs and proofs are handled at once
+        // even while a refresh is under way. Only one refresh runs at a time.
+        std::atomic<bool> refreshing {false};
+        auto refresh = [self = this->shared_from_this (), &save, &refreshing, &open_websockets, websockets] () {
+            std::cout << "About to call jobs API " << std::endl;
+            auto begin = std::chrono::steady_clock::now ();
+            try {
+                self->refresh_jobs ();
+                save ();
+            } catch (const net::HTTP::exception &exception) {
+                std::cout << "API problem: " << exception.what () <<
+                    "\n\tcall: " << exception.Request.Method << " " << exception.Request.URL <<
+                    "\n\theaders: " << exception.Request.Headers <<
+                    "\n\tbody: \"" << exception.Request.Body << "\"" << std::endl;
+            } catch (const std::exception &exception) {
+                std::cout << "Problem: " << exception.what () << std::endl;
+            } catch (...) {
+                std::cout << "something went wrong: " << std::endl;
+            }
+
+            logger::log ("api.refresh", JSON {
+                {"seconds", std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ()}
+            });
+
+            refreshing = false;
+            if (websockets && self->Net.Player == nullptr) net::asio::post (self->Net.IO, open_websockets);
+        };
+
+        // declared after everything its jobs refer to, so that it is joined first.
+        // A refresh that is under way when we stop is finished before we return.
+        boost::asio::thread_pool blocking {1};
+
         // we will call the API every few minutes.
         function<void (boost::system::error_code)> periodically =
-            [self = this->shared_from_this (), &periodically, &timer, &count, &websockets, &websockets_running, refresh_count]
+            [self = this->shared_from_this (), &periodically, &timer, &count, &refreshing, &refresh, &blocking, refresh_count]
             (boost::system::error_code err) {
             if (err) throw exception {} << "unknown error: " << err;
 
             if (count % refresh_count == 0) {
-                std::cout << "About to call jobs API " << std::endl;
-                try {
-                    self->update_jobs (self->Net.jobs (300, self->MaxDifficulty, self->MinValue));
-                } catch (const net::HTTP::exception &exception) {
-                    std::cout << "API problem: " << exception.what () <<
-                        "\n\tcall: " << exception.Request.Method << " " << exception.Request.URL <<
-                        "\n\theaders: " << exception.Request.Headers <<
-                        "\n\tbody: \"" << exception.Request.Body << "\"" << std::endl;
-                } catch (const std::exception &exception) {
-                    std::cout << "Problem: " << exception.what () << std::endl;
-                } catch (...) {
-                    std::cout << "something went wrong: " << std::endl;
-                    return;
-                }
-                
-                if (websockets && !websockets_running) {
-                    try {
-                        net::websocket::open (self->Net.IO,
-                            net::URL (net::URL::make {}.protocol ("ws").port (5201).domain_name ("pow.co").path ("/")), 
-                            nullptr,
-                            [] (boost::system::error_code err) {
-                                throw exception {} << "websockets error " << err;
-                            }, [&websockets_running] () {
-                                websockets_running = false;
-                                std::cout << "websockets closed..." << std::endl;
-                            },
-                            [&self, &websockets_running] (ptr<net::session<const string &>> o) {
-                                websockets_running = true;
-                                return [self] (string_view x) {
-                                    std::cout << "read websockets message " << x << std::endl;
-                                    auto j = JSON::parse (x);
-                                    if (!pow_co::websockets_protocol_message::valid (j))
-                                        std::cout << "invalid websockets message received: " << j << std::endl;
-                                    else if (j["type"] == "boostpow.job.created") {
-                                        if (auto prevout = pow_co::websockets_protocol_message::job_created (j["content"]);
-                                            bool (prevout)) self->new_job (*prevout);
-                                        else std::cout << "could not read websockets message " << j["content"] << std::endl;
-                                    } else if (j["type"] == "boostpow.proof.created") {
-                                        if (auto outpoint = pow_co::websockets_protocol_message::proof_created (j["content"]);
-                                            bool (outpoint)) self->solved_job (*outpoint);
-                                        else std::cout << "could not read websockets message " << j["content"] << std::endl;
-                                    } else std::cout << "unknown message received: " << j << std::endl;
-                                };
-                            });
-                        
-                    } catch (boost::system::system_error const& e) {
-                        std::cout << "caught system error: " << e.what () << std::endl;
-                    } catch (boost::exception const& e) {
-                        std::cout << "caught boost exception: " << std::endl;
-                    } catch (const std::exception& e) {
-                        std::cout << "caught exception: " << e.what () << std::endl;
-                    }
-                }
+                if (refreshing.exchange (true))
+                    logger::log (logger::warning, "api.refresh_skipped", JSON {{"reason", "previous refresh still running"}});
+                else net::asio::post (blocking, refresh);
 
                 std::cout << "about to wait another " << (refresh_count * 30) << " seconds." << std::endl;
-            } else {
-                uint32 reassign = self->Random.uint32 (self->Redeemers.size () - 1) + 1;
-
-                digest256 current_job = self->Redeemers[reassign - 1]->current ();
-                if (auto it = self->Jobs.Jobs.find (current_job); it != self->Jobs.Jobs.end ())
-                    it->second.Workers = data::select (it->second.Workers, [reassign] (int x) -> bool {
-                        return x != reassign;
-                    });
-
-                self->select_job (reassign);
-            }
+            } else self->tick ();
 
             count++;
             timer.expires_after (boost::asio::chrono::seconds (30));
@@ -374,6 +961,28 @@ namespace BoostPOW {
             return j.dump ();
         };
 
+        // without a state file, signals are left to kill us as they always have.
+        std::optional<boost::asio::signal_set> signals {};
+        if (!state_file.empty ()) {
+            signals.emplace (Net.IO, SIGINT, SIGTERM);
+            signals->async_wait ([this, &save] (boost::system::error_code err, int) {
+                if (err) return;
+                logger::log ("shutdown", JSON::object ());
+                save ();
+                Net.IO.stop ();
+            });
+        }
+
+        // recorded websocket messages are delivered when they arrived, counting from now.
+        std::vector<std::unique_ptr<boost::asio::steady_timer>> replayed {};
+        if (websockets && Net.Player != nullptr) for (const auto &x : Net.Player->messages ()) {
+            auto &t = replayed.emplace_back (std::make_unique<boost::asio::steady_timer> (Net.IO));
+            t->expires_after (std::chrono::duration_cast<std::chrono::steady_clock::duration> (Net.Player->when (x)));
+            t->async_wait ([&on_message, message = x.Body] (boost::system::error_code err) {
+                if (!err) on_message (message);
+            });
+        }
+
         try {
             std::cout << "making initial jobs call " << std::endl;
 
@@ -407,7 +1016,7 @@ namespace BoostPOW {
 
         auto difficulty = work::difficulty (Boost::output_script::target (p.script ()));
 
-        if (difficulty > MaxDifficulty) return;
+        if (MaxDifficulty > 0 && difficulty > MaxDifficulty) return;
 
         auto profitability = double (p.value ()) / difficulty;
 
@@ -415,14 +1024,11 @@ namespace BoostPOW {
             if (auto it = Jobs.Jobs.find (SHA2_256 (p.script ())); it == Jobs.Jobs.end ()) return;
 
         Jobs.add_prevout (p);
+        FirstSeen.try_emplace (SHA2_256 (p.script ()), now ());
+        Snapshots.erase (SHA2_256 (p.script ()));
         std::cout << "new job added" << std::endl;
 
-        if (Mining = false) {
-            Mining = true;
-
-            // select a new job for all mining threads.
-            for (int i = 1; i <= Redeemers.size (); i++) select_job (i);
-        }
+        rebalance ();
     }
 
     void manager::solved_job (const Bitcoin::outpoint &o) {
@@ -431,14 +1037,14 @@ namespace BoostPOW {
         if (auto x = Jobs.Scripts.find (o); x != Jobs.Scripts.end ()) {
             if (auto w = Jobs.Jobs.find (x->second); w != Jobs.Jobs.end ()) {
                 if (data::size (w->second.Prevouts) == 1) {
-                    auto workers = w->second.Workers;
-                    Jobs.Jobs.erase (w);
-                    for (int i : workers) select_job (i);
+                    estimate_competition (w->first, w->second);
+                    remove_job (w);
                 } else {
                     set<Boost::candidate::prevout> new_prevouts {};
                     for (const auto &p : w->second.Prevouts.values ())
                         if (static_cast<Bitcoin::outpoint> (p) != o) new_prevouts = new_prevouts.insert (p);
                     w->second.Prevouts = new_prevouts;
+                    Snapshots.erase (w->first);
                 }
 
             }
@@ -448,10 +1054,92 @@ namespace BoostPOW {
 
     }
     
+    void manager::estimate_competition (const digest256 &id, const working &w) {
+        if (Boost::output_script::type (w.Script) != Boost::bounty) return;
+
+        auto seen = FirstSeen.find (id);
+        if (seen == FirstSeen.end ()) return;
+
+        double seconds = std::chrono::duration<double> (now () - seen->second).count ();
+        if (seconds <= 0) return;
+
+        // whoever solved this job did about this much work while we were watching it, minus our own share.
+        double observed = expected_hashes (w) / seconds - data::size (w.Workers) * ThreadHashrate;
+        if (observed < 0) observed = 0;
+
+        CompetitorHashrate = CompetitorHashrate == 0 ? observed : .8 * CompetitorHashrate + .2 * observed;
+    }
+
+    void manager::share_jobs (const string &board, bool publish) {
+        BoardName = board;
+        PublishJobs = publish;
+        if (publish) Board = job_board::create (board);
+    }
+
+    void manager::refresh_jobs () {
+        // the control socket may change the filters while we wait on the network.
+        double max_difficulty;
+        uint64 min_value;
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            max_difficulty = MaxDifficulty;
+            min_value = MinValue;
+        }
+
+        if (BoardName == "" || PublishJobs) {
+            auto j = Net.jobs (300, max_difficulty, min_value);
+            update_jobs (j);
+            if (Board != nullptr) Board->publish (j);
+            return;
+        }
+
+        if (Board == nullptr) {
+            Board = job_board::attach (BoardName);
+            BoardVersion = 0;
+            if (Board == nullptr) {
+                logger::log (logger::warning, "job_board.missing", JSON {{"name", BoardName}});
+                return;
+            }
+        }
+
+        if (auto t = Board->version () != BoardVersion ? Board->read () : maybe<job_board::table> {}; bool (t)) {
+            BoardVersion = t->Version;
+            BoardPublished = t->Published;
+
+            // the publisher's filters were applied already, but ours may be stricter.
+            jobs j {};
+            for (const auto &[id, job] : t->Jobs.Jobs) for (const auto &p : job.Prevouts.values ())
+                if (int64 (p.Value) >= int64 (min_value))
+                    j.add_prevout (Bitcoin::prevout {static_cast<Bitcoin::outpoint> (p), Bitcoin::output {p.Value, job.Script}});
+
+            logger::log ("job_board.read", JSON {
+                {"version", BoardVersion},
+                {"jobs", j.Jobs.size ()}
+            });
+
+            update_jobs (j);
+        }
+
+        int64 age = std::chrono::duration_cast<std::chrono::seconds> (
+            std::chrono::system_clock::now ().time_since_epoch ()).count () - BoardPublished;
+
+        // we keep mining the last table, but look for a new board next time.
+        if (Board->closed () || (BoardVersion != 0 && age > job_board::stale_seconds)) {
+            logger::log (logger::warning, "job_board.stale", JSON {
+                {"name", BoardName},
+                {"closed", Board->closed ()},
+                {"age", age}
+            });
+
+            Board = nullptr;
+        }
+    }
+
     void manager::update_jobs (const BoostPOW::jobs &j) {
         std::unique_lock<std::mutex> lock (Mutex);
         
         Jobs = j;
+        Snapshots.clear ();
         uint32 total_jobs = Jobs.Jobs.size ();
         if (total_jobs == 0) return;
 
@@ -489,53 +1177,195 @@ namespace BoostPOW {
                 } else it++;
             } else it++;
 
+        Templates.retain ([this] (const digest256 &id) -> bool {
+            return Jobs.Jobs.contains (id);
+        });
+
+        std::vector<digest256> gone {};
+        for (const auto &[id, script] : PayScripts) if (!Jobs.Jobs.contains (id)) gone.push_back (id);
+        for (const digest256 &id : gone) release_pay_script (id, false);
+
+        gone.clear ();
+        for (const auto &[id, key] : BountyKeys) if (!Jobs.Jobs.contains (id)) gone.push_back (id);
+        for (const digest256 &id : gone) release_key (id, false);
+
+        auto now = this->now ();
+        std::erase_if (FirstSeen, [this] (const auto &x) {
+            return !Jobs.Jobs.contains (x.first);
+        });
+
+        for (const auto &job : Jobs.Jobs) FirstSeen.try_emplace (job.first, now);
+
         std::cout << "of these, " << contract_jobs << " are contract jobs. Of those, "
             << (contract_jobs - impossible_contract_jobs) << " are jobs that we know how to work on, leaving "
             << (profitable_jobs - impossible_contract_jobs) << " total jobs available." << std::endl;
 
         if (profitable_jobs - impossible_contract_jobs == 0) return;
-        
-        Mining = true;
 
         // select a new job for all mining threads. 
-        for (int i = 1; i <= Redeemers.size (); i++) select_job (i);
+        rebalance (true);
     }
 
     void manager::submit (const std::pair<digest256, Boost::puzzle> &puzzle, const work::solution &solution) {
-        
-        std::unique_lock<std::mutex> lock (Mutex);
-        double fee_rate {Fees.get ()};
-        
-        auto value = puzzle.second.value ();
-        bytes pay_script = pay_to_address::script (Addresses.next ().Digest);
-        auto expected_inputs_size = puzzle.second.expected_size ();
-        auto estimated_size = BoostPOW::estimate_size (expected_inputs_size, pay_script.size ());
-        std::cout << "redeeming tx; fee rate is " << fee_rate << "; value is " <<
-            value << "; estimated size is " << estimated_size <<  std::endl;
-        if (fee_rate <= .0001) throw "error: fee rate too small";
-        Bitcoin::satoshi fee {int64 (ceil (fee_rate * estimated_size))};
-        
-        if (fee > value) throw data::exception {"Cannot pay tx fee with boost output"};
-        
-        auto redeem_tx = BoostPOW::redeem_puzzle (puzzle.second, solution, {Bitcoin::output {value - fee, pay_script}});
-        
-        auto w = Jobs.Jobs.find (puzzle.first);
-        if (w != Jobs.Jobs.end ()) {
 
-            auto redeem_bytes = bytes (redeem_tx);
-            
-            logger::log ("job.complete.transaction", JSON {
-                {"txid", BoostPOW::write (redeem_tx.id ())},
-                {"txhex", encoding::hex::write (redeem_bytes)}
+        if (Aggregator != nullptr) {
+            std::unique_lock<std::mutex> lock (Mutex);
+            if (auto w = Jobs.Jobs.find (puzzle.first); w != Jobs.Jobs.end () && hold (w->second)) {
+                Aggregator->add (aggregator::entry {puzzle.second, solution});
+
+                // the aggregate pays to a script of its own, but it is signed with the job's key.
+                release_key (w->first, true);
+                remove_job (w);
+                return;
+            }
+        }
+
+        bytes redeem_bytes = redeem (puzzle.first, puzzle.second, solution);
+
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+
+            auto w = Jobs.Jobs.find (puzzle.first);
+            if (w == Jobs.Jobs.end ()) return;
+
+            // the job is gone before we broadcast, so nobody else redeems it in the meantime.
+            remove_job (w, true);
+        }
+
+        broadcast (redeem_bytes);
+    }
+
+    void manager::submit (redeemer *r, const std::vector<micro_solution> &solutions) {
+
+        std::vector<micro_solution> separate {};
+        if (Aggregator == nullptr) separate = solutions;
+        else {
+            std::unique_lock<std::mutex> lock (Mutex);
+            for (const micro_solution &x : solutions)
+                if (auto w = Jobs.Jobs.find (x.Job->ID); w != Jobs.Jobs.end () && hold (w->second)) {
+                    Aggregator->add (aggregator::entry {x.Job->Puzzle, x.Solution});
+                    release_key (w->first, true);
+                    forget_job (w);
+                } else separate.push_back (x);
+        }
+
+        // the transactions are made before the lock is taken.
+        std::vector<std::pair<digest256, bytes>> redeem_txs {};
+        for (const micro_solution &x : separate) try {
+            redeem_txs.emplace_back (x.Job->ID, redeem (x.Job->ID, x.Job->Puzzle, x.Solution));
+        } catch (const std::exception &e) {
+            logger::log (logger::warning, "micro_batch.redeem_failed", JSON {
+                {"script_hash", BoostPOW::write (x.Job->ID)},
+                {"error", e.what ()}
             });
-        
-            if (!Net.broadcast_solution (redeem_bytes)) std::cout << "broadcast failed!" << std::endl;
-            
-            auto workers = w->second.Workers;
-            Jobs.Jobs.erase (w);
-            for (int i : workers) select_job (i);
         }
-        
+
+        // and broadcast after it is released.
+        std::vector<bytes> broadcasts {};
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+
+            for (int i = 1; i <= Redeemers.size (); i++) if (Redeemers[i - 1].get () == r) Batches.erase (i);
+
+            for (auto &[id, redeem_bytes] : redeem_txs) {
+                auto w = Jobs.Jobs.find (id);
+                if (w == Jobs.Jobs.end () || redeem_bytes.size () == 0) continue;
+
+                forget_job (w, true);
+                broadcasts.push_back (std::move (redeem_bytes));
+            }
+
+            // one reallocation for the whole batch.
+            rebalance ();
+        }
+
+        for (const bytes &redeem_bytes : broadcasts) broadcast (redeem_bytes);
+    }
+
+    bytes manager::redeem (const digest256 &id, const Boost::puzzle &puzzle, const work::solution &solution) {
+        // if a template is ready, we only have to write the solution into it.
+        if (auto t = Templates.get (id, puzzle); t != nullptr)
+            if (bytes redeem_bytes = t->redeem (solution); redeem_bytes.size () != 0) return redeem_bytes;
+
+        logger::log (logger::debug, "redeem_template.missing", JSON {
+            {"script_hash", BoostPOW::write (id)}
+        });
+
+        return bytes (BoostPOW::redeem_puzzle (puzzle, solution, pay (puzzle)));
+    }
+
+    bool manager::broadcast (const bytes &redeem_bytes) {
+        bool success = Net.broadcast_solution (redeem_bytes);
+        if (!success) std::cout << "broadcast failed!" << std::endl;
+
+        logger::log ("job.complete.transaction", JSON {
+            {"txid", BoostPOW::write (Bitcoin::txid {Hash256 (redeem_bytes)})},
+            {"txhex", encoding::hex::write (redeem_bytes)}
+        });
+
+        return success;
+    }
+
+    void manager::pause (bool paused) {
+        std::unique_lock<std::mutex> lock (Mutex);
+        if (Paused == paused) return;
+        Paused = paused;
+
+        logger::log (paused ? "mining.paused" : "mining.resumed", JSON::object ());
+
+        rebalance (true);
+    }
+
+    void manager::set_filters (double minimum_profitability, double maximum_difficulty) {
+        std::unique_lock<std::mutex> lock (Mutex);
+        MinProfitability = minimum_profitability;
+        MaxDifficulty = maximum_difficulty;
+
+        uint32 removed = 0;
+        for (auto it = Jobs.Jobs.begin (); it != Jobs.Jobs.end ();)
+            if ((MaxDifficulty > 0 && it->second.difficulty () > MaxDifficulty) ||
+                it->second.profitability () < MinProfitability) {
+                // rest reassigns the job's list of workers, so we go through a copy.
+                list<int> workers = it->second.Workers;
+                for (int i : workers) rest (i);
+                it = forget_job (it);
+                removed++;
+            } else it++;
+
+        logger::log ("mining.filters", JSON {
+            {"min_profitability", MinProfitability},
+            {"max_difficulty", MaxDifficulty},
+            {"removed", removed}
+        });
+
+        rebalance ();
+    }
+
+    JSON manager::status () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        return JSON {
+            {"threads", Redeemers.size ()},
+            {"paused", Paused},
+            {"jobs", Jobs.Jobs.size ()},
+            {"thread_hashrate", ThreadHashrate},
+            {"snapshots_ready", Precompiled.ready ()},
+            {"min_profitability", MinProfitability},
+            {"max_difficulty", MaxDifficulty}
+        };
+    }
+
+    std::map<digest256, working>::iterator manager::forget_job (std::map<digest256, working>::iterator w, bool redeemed) {
+        Templates.remove (w->first);
+        FirstSeen.erase (w->first);
+        Snapshots.erase (w->first);
+        release_pay_script (w->first, redeemed);
+        release_key (w->first, redeemed);
+        return Jobs.Jobs.erase (w);
+    }
+
+    void manager::remove_job (std::map<digest256, working>::iterator w, bool redeemed) {
+        forget_job (w, redeemed);
+        rebalance ();
     }
     
 }
@@ -1,4 +1,6 @@
 #include <miner_options.hpp>
+#include <search_space.hpp>
+#include <logger.hpp>
 #include <argh.h>
 #include <gigamonkey/script/typed_data_bip_276.hpp>
 #include <gigamonkey/schema/hd.hpp>
@@ -61,6 +63,52 @@ namespace BoostPOW {
 
     }
 
+    void read_threads (const argh::parser &command_line, uint32 &threads, bool &automatic) {
+        auto option = command_line ("threads");
+        if (!option) return;
+
+        if (option.str () == "auto") {
+            automatic = true;
+            return;
+        }
+
+        option >> threads;
+        if (threads == 0) throw data::exception {"need at least one thread"};
+        if (threads > 65535) throw data::exception {"too many threads"};
+    }
+
+    double read_duty_cycle (const argh::parser &command_line) {
+        double duty_cycle = 1;
+        if (auto option = command_line ("duty_cycle"); option) option >> duty_cycle;
+        if (!(duty_cycle > 0) || duty_cycle > 1) throw data::exception {"duty cycle must be more than 0 and at most 1"};
+        return duty_cycle;
+    }
+
+    affinity::mode read_affinity (const string &x) {
+        auto m = affinity::read_mode (x);
+        if (!bool (m)) throw data::exception {} << "invalid affinity " << x << "; must be off, cores or smt";
+        return *m;
+    }
+
+    uint32 read_worker_id (const string &x) {
+        auto is_number = [] (const string &n) {
+            return n.size () > 0 && n.size () <= 10 && n.find_first_not_of ("0123456789") == string::npos;
+        };
+
+        auto dot = x.find ('.');
+        if (dot == string::npos) {
+            if (!is_number (x) || std::stoull (x) > 0xffffffff) throw data::exception {} << "invalid worker id " << x;
+            return uint32 (std::stoull (x));
+        }
+
+        string host = x.substr (0, dot);
+        string process = x.substr (dot + 1);
+        if (!is_number (host) || !is_number (process) || std::stoull (host) > 0xffff || std::stoull (process) > 0xffff)
+            throw data::exception {} << "invalid worker id " << x;
+
+        return search_partition::worker_id (uint16 (std::stoull (host)), uint16 (std::stoull (process)));
+    }
+
     void read_redeem_options (redeeming_options &options, const argh::parser &command_line, int secret_position, int address_position) {
 
         string secret_string;
@@ -103,8 +151,13 @@ namespace BoostPOW {
             else throw data::exception {"could not read receiving address"};
         }
 
-        if (auto option = command_line ("threads"); option) option >> options.Threads;
-        if (options.Threads == 0) throw data::exception {"need at least one thread"};
+        read_threads (command_line, options.Threads, options.AutoThreads);
+        if (auto option = command_line ("tune_cache"); option) options.TuneCache = option.str ();
+        if (auto option = command_line ("affinity"); option) options.Affinity = read_affinity (option.str ());
+        options.DutyCycle = read_duty_cycle (command_line);
+
+        if (auto option = command_line ("worker_id"); option) options.WorkerID = read_worker_id (option.str ());
+        else options.WorkerID = casual_random {}.uint32 ();
 
         double fee_rate;
         if (auto option = command_line ("fee_rate"); option) {
@@ -112,7 +165,29 @@ namespace BoostPOW {
             options.FeeRate = fee_rate;
         }
 
-        if (auto option = command_line ("api_endpoint"); option) options.APIHost = option.str ();
+        if (auto option = command_line ("mapi_hosts"); option) {
+            options.MAPIHosts = {};
+            std::stringstream hosts {option.str ()};
+            string host;
+            while (std::getline (hosts, host, ',')) if (host != "") options.MAPIHosts <<= host;
+            if (data::empty (options.MAPIHosts)) throw data::exception {"need at least one MAPI host"};
+        }
+
+        if (auto option = command_line ("fee_quote_interval"); option) option >> options.FeeQuoteInterval;
+        if (options.FeeQuoteInterval == 0) throw data::exception {"fee quote interval must be positive"};
+
+        // api_endpoint is the old name.
+        maybe<string> api_hosts;
+        if (auto option = command_line ("api_host"); option) api_hosts = option.str ();
+        else if (auto option = command_line ("api_endpoint"); option) api_hosts = option.str ();
+
+        if (api_hosts) {
+            options.APIHosts = {};
+            std::stringstream hosts {*api_hosts};
+            string host;
+            while (std::getline (hosts, host, ',')) if (host != "") options.APIHosts <<= host;
+            if (data::empty (options.APIHosts)) throw data::exception {"need at least one API host"};
+        }
 
     }
 
@@ -216,8 +291,7 @@ namespace BoostPOW {
 
     }
 
-    int run_mine (const argh::parser &command_line,
-        int (*mine) (const mining_options &)) {
+    mining_options read_mining_options (const argh::parser &command_line) {
 
         mining_options opts {};
 
@@ -227,9 +301,87 @@ namespace BoostPOW {
         if (auto option = command_line ("refresh_interval"); option) option >> opts.RefreshInterval;
         opts.Websockets = command_line["websockets"];
 
+        if (auto option = command_line ("policy"); option) opts.Policy = option.str ();
+        if (opts.Policy != "expected_value" && opts.Policy != "random")
+            throw data::exception {} << "unknown policy " << opts.Policy;
+
+        if (auto option = command_line ("competitor_hashrate"); option) option >> opts.CompetitorHashrate;
+        if (opts.CompetitorHashrate < 0) throw data::exception {"competitor hashrate cannot be negative"};
+
+        if (auto option = command_line ("micro_job_seconds"); option) option >> opts.MicroJobSeconds;
+        if (opts.MicroJobSeconds < 0) throw data::exception {"micro job seconds cannot be negative"};
+
+        if (auto option = command_line ("aggregate_seconds"); option) option >> opts.AggregateSeconds;
+        if (opts.AggregateSeconds < 0) throw data::exception {"aggregate seconds cannot be negative"};
+
+        if (auto option = command_line ("control"); option) opts.ControlSocket = option.str ();
+        if (auto option = command_line ("warm_start"); option) opts.WarmStart = option.str ();
+
+        if (auto option = command_line ("record"); option) opts.Record = option.str ();
+        if (auto option = command_line ("replay"); option) opts.Replay = option.str ();
+        if (opts.Record != "" && opts.Replay != "") throw data::exception {"cannot record and replay at once"};
+
+        if (auto option = command_line ("replay_speed"); option) option >> opts.ReplaySpeed;
+        if (opts.ReplaySpeed < 0) throw data::exception {"replay speed cannot be negative"};
+
+        if (auto option = command_line ("publish_jobs"); option) opts.PublishJobs = option.str ();
+        if (auto option = command_line ("job_board"); option) opts.JobBoard = option.str ();
+        if (opts.PublishJobs != "" && opts.JobBoard != "") throw data::exception {"cannot publish jobs and read them from a job board at once"};
+
         read_redeem_options (opts, command_line, 2, 3);
 
-        return mine (opts);
+        return opts;
+    }
+
+    int run_mine (const argh::parser &command_line,
+        int (*mine) (const mining_options &)) {
+        return mine (read_mining_options (command_line));
+    }
+
+    int run_worker (const argh::parser &command_line,
+        int (*worker) (const worker_options &)) {
+
+        worker_options options {};
+
+        string endpoint;
+        if (auto positional = command_line (2); positional) positional >> endpoint;
+        else if (auto option = command_line ("stratum"); option) option >> endpoint;
+        else throw data::exception {"Stratum endpoint not provided"};
+
+        // the endpoint is host:port.
+        auto colon = endpoint.rfind (':');
+        if (colon == string::npos || colon == 0) throw data::exception {} << "invalid Stratum endpoint " << endpoint;
+
+        options.Host = endpoint.substr (0, colon);
+
+        string port = endpoint.substr (colon + 1);
+        if (port.size () == 0 || port.size () > 5 || port.find_first_not_of ("0123456789") != string::npos ||
+            std::stoul (port) == 0 || std::stoul (port) > 65535)
+            throw data::exception {} << "invalid port in Stratum endpoint " << endpoint;
+
+        options.Port = uint16 (std::stoul (port));
+
+        if (auto option = command_line ("name"); option) options.Name = option.str ();
+
+        read_threads (command_line, options.Threads, options.AutoThreads);
+        if (auto option = command_line ("tune_cache"); option) options.TuneCache = option.str ();
+        if (auto option = command_line ("affinity"); option) options.Affinity = read_affinity (option.str ());
+        options.DutyCycle = read_duty_cycle (command_line);
+
+        return worker (options);
+    }
+
+    int run_tune (const argh::parser &command_line,
+        int (*tune) (const tuning_options &)) {
+
+        tuning_options options {};
+
+        if (auto option = command_line ("seconds"); option) option >> options.Seconds;
+        if (!(options.Seconds > 0)) throw data::exception {"seconds must be positive"};
+
+        if (auto option = command_line ("tune_cache"); option) options.TuneCache = option.str ();
+
+        return tune (options);
     }
 
     int run (const argh::parser &command_line,
@@ -237,14 +389,24 @@ namespace BoostPOW {
         int (*version) (),
         int (*spend) (const script_options &),
         int (*redeem) (const Bitcoin::outpoint &, const bytes &script, int64 value, const redeeming_options &),
-        int (*mine) (const mining_options &)) {
+        int (*mine) (const mining_options &),
+        int (*worker) (const worker_options &),
+        int (*tune) (const tuning_options &)) {
 
         try {
             if (command_line["version"]) return version ();
 
             if (command_line["help"]) return help ();
 
-            if (!command_line (1)) throw data::exception {"Must provide a command (help, version, spend, redeem, mine)"};
+            if (auto option = command_line ("log_level"); option) logger::set_level (logger::read_level (option.str ()));
+
+            if (auto option = command_line ("log_format"); option) {
+                string log_format = option.str ();
+                if (log_format == "binary") logger::set_format (logger::format::binary);
+                else if (log_format != "JSON") throw data::exception {} << "invalid log format " << log_format;
+            }
+
+            if (!command_line (1)) throw data::exception {"Must provide a command (help, version, spend, redeem, mine, worker, tune)"};
 
             string method = command_line (1).str ();
 
@@ -258,7 +420,11 @@ namespace BoostPOW {
 
             if (method == "mine") return run_mine (command_line, mine);
 
-            throw data::exception {} << "Invalid method " << method << " called. Must be help, version, spend, redeem, or mine";
+            if (method == "worker") return run_worker (command_line, worker);
+
+            if (method == "tune") return run_tune (command_line, tune);
+
+            throw data::exception {} << "Invalid method " << method << " called. Must be help, version, spend, redeem, mine, worker, or tune";
 
         } catch (const std::string x) {
             std::cout << "Error: " << x << std::endl;
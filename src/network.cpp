@@ -4,10 +4,19 @@
 #include <mutex>
 #include <iomanip>
 
-std::mutex Mutex;
+// guards the caches of transactions and script histories below. Requests are
+// made without it, since a refresh of the jobs can take minutes.
+std::mutex CacheMutex;
+
+// MAPI requests are made inside gigamonkey, which doesn't share the connection pool.
+std::mutex MAPIMutex;
 
 BoostPOW::network::broadcast_error BoostPOW::network::broadcast (const bytes &tx) {
-    std::lock_guard<std::mutex> lock (Mutex);
+    if (Player != nullptr) {
+        logger::log ("replay.broadcast_skipped", JSON {{"size", tx.size ()}});
+        return broadcast_error::none;
+    }
+
     std::cout << "broadcasting tx " << std::endl;
     
     bool broadcast_whatsonchain; 
@@ -29,6 +38,7 @@ BoostPOW::network::broadcast_error BoostPOW::network::broadcast (const bytes &tx
     }
     
     try {
+        std::lock_guard<std::mutex> lock (MAPIMutex);
         auto broadcast_result = Gorilla.submit_transaction({tx});
         broadcast_gorilla = broadcast_result.ReturnResult == BitcoinAssociation::MAPI::success;
         if (!broadcast_gorilla) std::cout << "Gorilla broadcast description: " << broadcast_result.ResultDescription << std::endl; 
@@ -47,12 +57,18 @@ BoostPOW::network::broadcast_error BoostPOW::network::broadcast (const bytes &tx
 bytes BoostPOW::network::get_transaction (const Bitcoin::txid &txid) {
     static map<Bitcoin::txid, bytes> cache;
     
-    auto known = cache.contains (txid);
-    if (known) return *known;
+    {
+        std::lock_guard<std::mutex> lock (CacheMutex);
+        auto known = cache.contains (txid);
+        if (known) return *known;
+    }
     
     bytes tx = WhatsOnChain.transaction ().get_raw (txid);
     
-    if (tx != bytes {}) cache = cache.insert (txid, tx);
+    if (tx != bytes {}) {
+        std::lock_guard<std::mutex> lock (CacheMutex);
+        if (!cache.contains (txid)) cache = cache.insert (txid, tx);
+    }
     
     return tx;
 }
@@ -64,13 +80,12 @@ map<Bitcoin::txid, bytes> Transaction;
 map<digest256, list<Bitcoin::txid>> History;
 
 BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int64 min_value) {
-    
-    std::lock_guard<std::mutex> lock (Mutex);
-
-    auto jobs_call = PowCo.jobs ().limit (limit);
-    if (max_difficulty > 0) jobs_call.max_difficulty (max_difficulty);
 
-    const list<Bitcoin::prevout> jobs_api_call {jobs_call ()};
+    const std::vector<Bitcoin::prevout> jobs_api_call {read_api<std::vector<Bitcoin::prevout>> ([limit, max_difficulty] (pow_co &api) {
+        auto jobs_call = api.jobs ().limit (limit);
+        if (max_difficulty > 0) jobs_call.max_difficulty (max_difficulty);
+        return jobs_call ();
+    })};
     
     BoostPOW::jobs Jobs {};
     
@@ -81,15 +96,14 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
     
     json::array_t redemptions;
     
-    std::map<digest256, list<Bitcoin::prevout>> prevouts;
+    std::map<digest256, std::vector<Bitcoin::prevout>> prevouts;
     
     std::cout << "Jobs returned from API: " << jobs_api_call.size () << std::endl;
     
     // organize all jobs in terms of script hash. 
     for (const Bitcoin::prevout &job : jobs_api_call) {
         digest256 script_hash = SHA2_256 (job.script ());
-        if (auto j = prevouts.find (script_hash); j != prevouts.end ()) j->second <<= job; 
-        else prevouts[script_hash] = list<Bitcoin::prevout> {job};
+        prevouts[script_hash].push_back (job);
     }
     
     std::cout << "found " << prevouts.size () << " separate scripts." << std::endl;
@@ -103,7 +117,9 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
 
         // this usually doesn't work.
         try {
-            in = PowCo.spends (job.outpoint ());
+            in = read_api<inpoint> ([o = job.outpoint ()] (pow_co &api) {
+                return api.spends (o);
+            });
         } catch (const net::HTTP::exception &exception) {
             // continue if this call fails, as it is not essential. 
             std::cout << "API problem: " << exception.what () <<
@@ -116,34 +132,44 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
         if (!in.valid ()) {
             auto script_hash = SHA2_256 (job.script ());
             
-            auto history = History.contains (script_hash);
-            
-            if (!history) {
-                History = History.insert (script_hash, WhatsOnChain.script ().get_history (script_hash));
-                history = History.contains (script_hash);
+            list<Bitcoin::txid> history;
+            bool cached = false;
+            {
+                std::lock_guard<std::mutex> lock (CacheMutex);
+                if (auto known = History.contains (script_hash); known) {
+                    history = *known;
+                    cached = true;
+                }
             }
             
-            for (const Bitcoin::txid &redeem_txid : *history) {
-                Bitcoin::transaction redeem_tx;
+            if (!cached) {
+                history = WhatsOnChain.script ().get_history (script_hash);
+                std::lock_guard<std::mutex> lock (CacheMutex);
+                if (!History.contains (script_hash)) History = History.insert (script_hash, history);
+            }
 
-                auto tx = Transaction.contains (redeem_txid);
-                if (!tx) {
-                    redeem_tx = Bitcoin::transaction (get_transaction (redeem_txid));
-                    Transaction = Transaction.insert (redeem_txid, bytes (redeem_tx));
-                } else redeem_tx = Bitcoin::transaction (*tx);
+            // looked up in the cache and, if it isn't there, requested without the lock.
+            auto cached_transaction = [this] (const Bitcoin::txid &txid) -> bytes {
+                {
+                    std::lock_guard<std::mutex> lock (CacheMutex);
+                    if (auto tx = Transaction.contains (txid); tx) return *tx;
+                }
+
+                bytes tx = get_transaction (txid);
+                std::lock_guard<std::mutex> lock (CacheMutex);
+                if (!Transaction.contains (txid)) Transaction = Transaction.insert (txid, tx);
+                return tx;
+            };
+            
+            for (const Bitcoin::txid &redeem_txid : history) {
+                Bitcoin::transaction redeem_tx {cached_transaction (redeem_txid)};
 
                 if (!redeem_tx.valid ()) continue;
                 
                 uint32 ii = 0;
                 for (const Bitcoin::input &in: redeem_tx.Inputs) if (in.Reference == job.outpoint ()) {
 
-                    bytes spend_tx;
-
-                    auto tx = Transaction.contains (in.Reference.Digest);
-                    if (!tx) {
-                        spend_tx = get_transaction (in.Reference.Digest);
-                        Transaction = Transaction.insert (in.Reference.Digest, spend_tx);
-                    } else spend_tx = *tx;
+                    bytes spend_tx = cached_transaction (in.Reference.Digest);
                     
                     std::cout << "spend tx found: " << redeem_txid << std::endl;
                     
@@ -171,9 +197,9 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
         std::cout << "  checking script " << i << " of " << prevouts.size () << " with hash " << pair.first << std::endl;
         i++;
         
-        list<UTXO> script_utxos = WhatsOnChain.script ().get_unspent (script_hash);
-        std::cout << "  got unspent scripts " << script_utxos << std::endl;
-        list<Bitcoin::prevout> unspent;
+        std::vector<UTXO> script_utxos = get_unspent (script_hash);
+        std::cout << "  got " << script_utxos.size () << " unspent outputs" << std::endl;
+        std::vector<Bitcoin::prevout> unspent;
         
         for (const Bitcoin::prevout &p : pair.second) {
             std::cout << "    " << p.outpoint () << std::endl;
@@ -185,11 +211,11 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
             }
             
             if (closed) count_closed_job (p);
-            else unspent <<= p;
+            else unspent.push_back (p);
         }
         
-        if (!data::empty (unspent)) {
-            Jobs.add_script (unspent.first ().script ());
+        if (!unspent.empty ()) {
+            Jobs.add_script (unspent.front ().script ());
             
             for (const Bitcoin::prevout &p : unspent) {
                 count_open_jobs++;
@@ -198,7 +224,7 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
                 else Jobs.add_prevout (p);
             } 
             
-            if (data::size (unspent) > 1) count_jobs_with_multiple_outputs++;
+            if (unspent.size () > 1) count_jobs_with_multiple_outputs++;
         }
         
     }
@@ -210,15 +236,22 @@ BoostPOW::jobs BoostPOW::network::jobs (uint32 limit, double max_difficulty, int
         {"jobs_with_multiple_outputs", count_jobs_with_multiple_outputs}, 
         {"jobs_with_low_value", count_low_value_jobs}, 
         {"redemptions", redemptions}, 
-        {"valid_jobs", JSON (Jobs)}
+        {"valid_jobs", Jobs.Jobs.size ()}
     });
+
+    // totals since we started.
+    logger::log ("http.pool", JSON (Pool->stats ()));
+
+    // the full job table is large, so only build it if someone is going to read it.
+    if (logger::enabled (logger::debug)) logger::log (logger::debug, "api.jobs.table", JSON (Jobs));
     
     return Jobs;
     
 }
 
 satoshi_per_byte BoostPOW::network::mining_fee () {
-    std::lock_guard<std::mutex> lock (Mutex);
+    if (Player != nullptr) throw exception {"no fee quotes during a replay"};
+    std::lock_guard<std::mutex> lock (MAPIMutex);
     auto z = Gorilla.get_fee_quote ();
     if (!z.valid ()) throw exception {} << "invalid fee quote response received: " << string (JSON (z));
     auto j = JSON (z);
@@ -226,13 +259,19 @@ satoshi_per_byte BoostPOW::network::mining_fee () {
     return z.Fees["standard"].MiningFee;
 }
 
-Boost::candidate get_powco_job (BoostPOW::network &n, const Bitcoin::outpoint &o) {
+std::vector<UTXO> BoostPOW::network::get_unspent (const digest256 &script_hash) {
+    // not hedged: there is only one UTXO host, and it is rate limited, so a
+    // second request would only wait behind the first and double the load.
+    return WhatsOnChain.script ().get_unspent (script_hash);
+}
+
+Boost::candidate get_powco_job (pow_co &api, const Bitcoin::outpoint &o) {
     try {
         // this is supposed to work, but it actually doesn't.
-        return Boost::candidate {{n.PowCo.job (o)}};
+        return Boost::candidate {{api.job (o)}};
     } catch (const net::HTTP::exception &) {
         // we have a failsafe while this call fails.
-        auto powco_job = n.PowCo.job (o.Digest);
+        auto powco_job = api.job (o.Digest);
 
         // check that the vout is the same.
         if (powco_job.outpoint ().Index != o.Index)
@@ -244,12 +283,14 @@ Boost::candidate get_powco_job (BoostPOW::network &n, const Bitcoin::outpoint &o
 
 Boost::candidate BoostPOW::network::job (const Bitcoin::outpoint &o) {
     // check for job at pow co. 
-    Boost::candidate x = get_powco_job (*this, o);
+    Boost::candidate x = read_api<Boost::candidate> ([o] (pow_co &api) {
+        return get_powco_job (api, o);
+    });
 
     // check for job with whatsonchain.
     auto script_hash = x.id ();
     
-    auto script_utxos = WhatsOnChain.script ().get_unspent (script_hash);
+    auto script_utxos = get_unspent (script_hash);
     
     // is the current job in the list from whatsonchain? 
     bool match_found = false;
@@ -262,7 +303,9 @@ Boost::candidate BoostPOW::network::job (const Bitcoin::outpoint &o) {
     
     // register job at pow co. 
     if (!match_found) {
-        auto inpoint = PowCo.spends (o);
+        auto inpoint = read_api<::inpoint> ([o] (pow_co &api) {
+            return api.spends (o);
+        });
         
         if (!inpoint.valid ()) {
             
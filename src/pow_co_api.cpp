@@ -1,4 +1,5 @@
 #include <pow_co_api.hpp>
+#include <json_stream.hpp>
 #include <data/net/websocket.hpp>
 #include <data/net/JSON.hpp>
 
@@ -40,7 +41,7 @@ Bitcoin::prevout read_job (const JSON &job,
         Bitcoin::output {Bitcoin::satoshi {value}, *script_bytes}};
 }
 
-list<Bitcoin::prevout> pow_co::get_jobs_query::operator () () {
+std::vector<Bitcoin::prevout> pow_co::get_jobs_query::operator () () {
 
     std::cout << "getting ";
     if (bool (Limit)) std::cout << *Limit;
@@ -79,14 +80,11 @@ list<Bitcoin::prevout> pow_co::get_jobs_query::operator () () {
         throw net::HTTP::exception {request, response, "expected content type application/JSON"};
     */
     
-    list<Bitcoin::prevout> boost_jobs;
+    std::vector<Bitcoin::prevout> boost_jobs;
     try {
-        JSON JSON_jobs = JSON::parse (response.Body).at ("jobs");
-
-        std::cout << "returned " << JSON_jobs.size () << " jobs ..." << std::endl;
-        
-        for (const JSON &job : JSON_jobs) boost_jobs = boost_jobs << read_job (job, request, response);
-    } catch (const JSON::exception &j) {
+        boost_jobs = BoostPOW::json_stream::read_jobs (response.Body);
+        std::cout << "returned " << boost_jobs.size () << " jobs ..." << std::endl;
+    } catch (const data::exception &j) {
         throw net::HTTP::exception {request, response, string {"invalid JSON format: "} + string {j.what ()}};
     }
     
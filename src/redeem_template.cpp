@@ -0,0 +1,190 @@
+#include <redeem_template.hpp>
+#include <logger.hpp>
+#include <algorithm>
+
+namespace BoostPOW {
+
+    namespace {
+
+        bytes write_uint32 (uint32 x, bool big_endian) {
+            bytes b (4);
+            for (int i = 0; i < 4; i++) b[big_endian ? 3 - i : i] = byte (x >> (8 * i));
+            return b;
+        }
+
+        std::vector<size_t> find_all (const bytes &tx, const bytes &pattern) {
+            std::vector<size_t> offsets;
+            for (auto it = std::search (tx.begin (), tx.end (), pattern.begin (), pattern.end ());
+                it != tx.end (); it = std::search (it + 1, tx.end (), pattern.begin (), pattern.end ()))
+                offsets.push_back (it - tx.begin ());
+            return offsets;
+        }
+
+        // find a four byte field that appears once in every input.
+        maybe<redeem_template::field> locate (const bytes &tx, uint32 value, size_t inputs) {
+            for (bool big_endian : {false, true})
+                if (auto offsets = find_all (tx, write_uint32 (value, big_endian)); offsets.size () == inputs)
+                    return redeem_template::field {offsets, 4, big_endian};
+            return {};
+        }
+
+        // every field gets a random value so that it can be found in the transaction.
+        work::solution placeholder (random &r, bool bits) {
+            uint64_big extra_nonce_2 {r.uint64 ()};
+            work::solution x {Bitcoin::timestamp {r.uint32 ()}, r.uint32 (), bytes_view (extra_nonce_2), Stratum::session_id {r.uint32 ()}};
+            if (bits) x.Share.Bits = r.uint32 ();
+            return x;
+        }
+
+        void write_field (bytes &tx, const redeem_template::field &f, uint32 value) {
+            bytes b = write_uint32 (value, f.BigEndian);
+            for (size_t o : f.Offsets) std::copy (b.begin (), b.end (), tx.begin () + o);
+        }
+
+    }
+
+    redeem_template redeem_template::make (random &r, const Boost::puzzle &puzzle, list<Bitcoin::output> pay) {
+        bool bits = work::puzzle (puzzle).Mask != -1;
+        size_t inputs = data::size (puzzle.Prevouts);
+
+        work::solution x = placeholder (r, bits);
+        bytes tx = puzzle.redeem (x, pay);
+        if (tx.size () == 0) return {};
+
+        auto timestamp = locate (tx, x.Share.Timestamp.Value, inputs);
+        auto nonce = locate (tx, uint32 (x.Share.Nonce), inputs);
+        auto extra_nonce_1 = locate (tx, uint32 (x.ExtraNonce1), inputs);
+        auto extra_nonce_2 = find_all (tx, x.Share.ExtraNonce2);
+
+        if (!bool (timestamp) || !bool (nonce) || !bool (extra_nonce_1) || extra_nonce_2.size () != inputs) return {};
+
+        redeem_template t {};
+        t.Puzzle = puzzle;
+        t.Pay = pay;
+        t.Transaction = tx;
+        t.Timestamp = *timestamp;
+        t.Nonce = *nonce;
+        t.ExtraNonce1 = *extra_nonce_1;
+        t.ExtraNonce2 = field {extra_nonce_2, x.Share.ExtraNonce2.size (), false};
+
+        if (bits) {
+            t.Bits = locate (tx, uint32 (*x.Share.Bits), inputs);
+            if (!bool (t.Bits)) return {};
+        }
+
+        // check that we get the same thing as we would by building the tx from scratch.
+        work::solution check = placeholder (r, bits);
+        if (t.redeem (check) != puzzle.redeem (check, pay)) return {};
+
+        return t;
+    }
+
+    bytes redeem_template::redeem (const work::solution &x) const {
+        if (!valid () || x.Share.ExtraNonce2.size () != ExtraNonce2.Size || bool (Bits) != bool (x.Share.Bits)) return {};
+
+        bytes tx = Transaction;
+
+        write_field (tx, Timestamp, x.Share.Timestamp.Value);
+        write_field (tx, Nonce, uint32 (x.Share.Nonce));
+        write_field (tx, ExtraNonce1, uint32 (x.ExtraNonce1));
+        if (bool (Bits)) write_field (tx, *Bits, uint32 (*x.Share.Bits));
+
+        for (size_t o : ExtraNonce2.Offsets)
+            std::copy (x.Share.ExtraNonce2.begin (), x.Share.ExtraNonce2.end (), tx.begin () + o);
+
+        return tx;
+    }
+
+    template_builder::template_builder (payment pay, uint64 random_seed) :
+        Pay {pay}, Random {random_seed}, Mutex {}, Wake {}, Stop {false}, Pending {}, Ready {},
+        Builder {&template_builder::run, this} {}
+
+    template_builder::~template_builder () {
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            Stop = true;
+        }
+
+        Wake.notify_all ();
+        Builder.join ();
+    }
+
+    void template_builder::prepare (const digest256 &id, const Boost::puzzle &puzzle) {
+        std::lock_guard<std::mutex> lock (Mutex);
+
+        if (auto r = Ready.find (id); r != Ready.end () && r->second->Puzzle == puzzle) return;
+
+        for (auto &p : Pending) if (p.first == id) {
+            p.second = puzzle;
+            return;
+        }
+
+        Pending.emplace_back (id, puzzle);
+        Wake.notify_one ();
+    }
+
+    ptr<const redeem_template> template_builder::get (const digest256 &id, const Boost::puzzle &puzzle) {
+        std::lock_guard<std::mutex> lock (Mutex);
+
+        if (auto r = Ready.find (id); r != Ready.end () && r->second->Puzzle == puzzle) return r->second;
+
+        return nullptr;
+    }
+
+    void template_builder::remove (const digest256 &id) {
+        std::lock_guard<std::mutex> lock (Mutex);
+        Ready.erase (id);
+        Pending.remove_if ([&id] (const std::pair<digest256, Boost::puzzle> &p) {
+            return p.first == id;
+        });
+    }
+
+    void template_builder::retain (function<bool (const digest256 &)> keep) {
+        std::lock_guard<std::mutex> lock (Mutex);
+        std::erase_if (Ready, [&keep] (const auto &r) {
+            return !keep (r.first);
+        });
+
+        Pending.remove_if ([&keep] (const std::pair<digest256, Boost::puzzle> &p) {
+            return !keep (p.first);
+        });
+    }
+
+    void template_builder::run () {
+        std::unique_lock<std::mutex> lock (Mutex);
+        while (true) {
+            Wake.wait (lock, [this] () {
+                return Stop || Pending.size () > 0;
+            });
+
+            if (Stop) return;
+
+            auto next = Pending.front ();
+            Pending.pop_front ();
+            lock.unlock ();
+
+            ptr<const redeem_template> made {};
+            try {
+                auto t = redeem_template::make (Random, next.second, Pay (next.second));
+                if (t.valid ()) made = std::make_shared<const redeem_template> (std::move (t));
+                else logger::log (logger::warning, "redeem_template.invalid", JSON {
+                    {"script_hash", write (next.first)}
+                });
+            } catch (const std::exception &e) {
+                logger::log (logger::warning, "redeem_template.error", JSON {
+                    {"script_hash", write (next.first)},
+                    {"error", e.what ()}
+                });
+            }
+
+            lock.lock ();
+            if (made == nullptr) continue;
+
+            // a new puzzle for the job may have come while we worked.
+            bool wanted = true;
+            for (const auto &p : Pending) if (p.first == next.first) wanted = false;
+            if (wanted) Ready[next.first] = made;
+        }
+    }
+
+}
@@ -0,0 +1,110 @@
+#include <scheduler.hpp>
+#include <queue>
+
+namespace BoostPOW {
+
+    // close enough to the size of a Boost input for estimating fees.
+    constexpr double approximate_input_size = 230;
+
+    // size of a redeem tx apart from the inputs, paying to one p2pkh output.
+    constexpr double approximate_tx_overhead = 44;
+
+    double net_value (const working &j, const market &m) {
+        return double (int64 (j.value ())) -
+            m.FeeRate * (approximate_input_size * data::size (j.Prevouts) + approximate_tx_overhead);
+    }
+
+    double expected_revenue (const working &j, uint32 threads, const market &m) {
+        if (threads == 0) return 0;
+
+        double value = net_value (j, m);
+        if (value <= 0) return 0;
+
+        double work = expected_hashes (j);
+        if (work <= 0) return 0;
+
+        double ours = threads * m.ThreadHashrate;
+
+        // competitors can only take bounty jobs.
+        double theirs = Boost::output_script::type (j.Script) == Boost::bounty ? m.CompetitorHashrate : 0;
+
+        // fraction of time spent hashing rather than switching jobs.
+        double efficiency = 1 - m.SwitchCost * (ours + theirs) / work;
+        if (efficiency <= 0) return 0;
+
+        return value * ours / work * efficiency;
+    }
+
+    std::map<digest256, uint32> random_policy::allocate (
+        const std::map<digest256, working> &jobs, uint32 threads, const market &m, random &r) {
+
+        std::map<digest256, uint32> allocation;
+
+        for (uint32 i = 0; i < threads; i++) {
+            double normalization = 0;
+            for (const auto &[id, j] : jobs) normalization += j.weight (m.MinProfitability, Tilt, allocation[id]);
+            if (normalization == 0) break;
+
+            double x = r.range01 () * normalization;
+
+            double accumulated = 0;
+            for (const auto &[id, j] : jobs) {
+                accumulated += j.weight (m.MinProfitability, Tilt, allocation[id]);
+                if (accumulated >= x) {
+                    allocation[id]++;
+                    break;
+                }
+            }
+        }
+
+        std::erase_if (allocation, [] (const auto &a) {
+            return a.second == 0;
+        });
+
+        return allocation;
+    }
+
+    std::map<digest256, uint32> expected_value_policy::allocate (
+        const std::map<digest256, working> &jobs, uint32 threads, const market &m, random &) {
+
+        struct candidate {
+            double Marginal;
+            const digest256 *ID;
+            const working *Job;
+
+            bool operator < (const candidate &c) const {
+                return Marginal < c.Marginal;
+            }
+        };
+
+        std::map<digest256, uint32> allocation;
+
+        // expected_revenue is concave in the number of threads, so giving
+        // each thread to the job with the greatest marginal revenue is optimal.
+        std::priority_queue<candidate> q;
+        for (const auto &[id, j] : jobs) {
+            if (j.profitability () < m.MinProfitability) continue;
+            double marginal = expected_revenue (j, 1, m);
+            if (marginal > 0) q.push (candidate {marginal, &id, &j});
+        }
+
+        for (uint32 i = 0; i < threads && !q.empty (); i++) {
+            candidate best = q.top ();
+            q.pop ();
+
+            uint32 n = ++allocation[*best.ID];
+
+            double marginal = expected_revenue (*best.Job, n + 1, m) - expected_revenue (*best.Job, n, m);
+            if (marginal > 0) q.push (candidate {marginal, best.ID, best.Job});
+        }
+
+        return allocation;
+    }
+
+    ptr<scheduling_policy> scheduling_policy::make (const string &name) {
+        if (name == "random") return std::make_shared<random_policy> ();
+        if (name == "expected_value") return std::make_shared<expected_value_policy> ();
+        throw data::exception {} << "unknown scheduling policy " << name;
+    }
+
+}
@@ -0,0 +1,29 @@
+#include <search_space.hpp>
+#include <stdexcept>
+
+namespace BoostPOW {
+
+    namespace {
+        constexpr uint64 counter_mask = (uint64 (1) << 48) - 1;
+    }
+
+    search_partition::search_partition (uint32 worker_id, uint16 thread) :
+        search_partition {worker_id, thread, uint64 (Bitcoin::timestamp::now ().Value) << 16} {}
+
+    search_partition::search_partition (uint32 worker_id, uint16 thread, uint64 first) :
+        ExtraNonce1 {worker_id}, Thread {thread}, First {first & counter_mask}, Counter {first & counter_mask} {}
+
+    work::solution search_partition::next (const work::puzzle &p) {
+        if (Counter > counter_mask) throw std::logic_error {"search partition is exhausted"};
+
+        uint64_big extra_nonce_2 {(uint64 (Thread) << 48) | Counter++};
+
+        work::solution x {Bitcoin::timestamp::now (), 0, bytes_view (extra_nonce_2), ExtraNonce1};
+
+        // the general purpose bits don't need to vary because extra nonce 2 already does.
+        if (p.Mask != -1) x.Share.Bits = 0;
+
+        return x;
+    }
+
+}
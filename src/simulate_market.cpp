@@ -0,0 +1,464 @@
+#include <miner.hpp>
+#include <logger.hpp>
+#include <argh.h>
+#include <gigamonkey/schema/hd.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <cmath>
+
+// Run the job manager against a stream of simulated Boost jobs in order to
+// compare scheduling policies without doing any real hashing. Threads are
+// not started. Instead, each thread hashes at a fixed rate on a simulated
+// clock and solves its job after an exponentially distributed time.
+
+using namespace Gigamonkey;
+
+namespace simulation {
+
+    using namespace BoostPOW;
+
+    constexpr double infinity = std::numeric_limits<double>::infinity ();
+
+    struct settings {
+        uint32 Threads {8};
+
+        // hashes/second of one simulated thread.
+        double ThreadHashrate {1 << 20};
+
+        // how long to run the simulation.
+        double Hours {24};
+
+        // synthetic jobs.
+        double JobsPerHour {60};
+        double MinDifficulty {.00001};
+        double MaxDifficulty {.01};
+        double MinProfitability {1000};
+        double MaxProfitability {100000};
+
+        // true hashrate of other miners. Only bounty jobs are exposed to competition.
+        double CompetitorHashrate {0};
+
+        // seconds a thread does not hash after being moved to a new job.
+        double SwitchLatency {.5};
+
+        double FeeRate {.05};
+
+        uint64 Seed {1};
+
+        // file of recorded jobs to use instead of synthetic jobs.
+        maybe<string> Replay {};
+
+        list<string> Policies {"random", "expected_value"};
+    };
+
+    struct arrival {
+        // seconds from the start of the simulation.
+        double Time;
+        Bitcoin::prevout Prevout;
+
+        // when somebody else redeems the job, or infinity.
+        double SolvedByCompetitor;
+    };
+
+    double exponential (random &r, double rate) {
+        if (rate <= 0) return infinity;
+        return -std::log (1 - r.range01 ()) / rate;
+    }
+
+    double log_uniform (random &r, double min, double max) {
+        return min * std::pow (max / min, r.range01 ());
+    }
+
+    double competitor_solve (random &r, const settings &s, double arrived, const bytes &script) {
+        if (Boost::output_script::type (script) != Boost::bounty) return infinity;
+        double difficulty = double (work::difficulty (Boost::output_script::target (script)));
+        return arrived + exponential (r, s.CompetitorHashrate / (difficulty * 4294967296.));
+    }
+
+    std::vector<arrival> synthesize (random &r, const settings &s) {
+        std::vector<arrival> arrivals {};
+        double end = s.Hours * 3600;
+
+        uint32 index = 0;
+        for (double t = exponential (r, s.JobsPerHour / 3600); t < end; t += exponential (r, s.JobsPerHour / 3600)) {
+            double difficulty = log_uniform (r, s.MinDifficulty, s.MaxDifficulty);
+            int64 value = int64 (std::ceil (difficulty * log_uniform (r, s.MinProfitability, s.MaxProfitability)));
+
+            digest256 content {};
+            for (byte &b : content) b = byte (r.uint32 (255));
+
+            bytes script = Boost::output_script::bounty (
+                int32_little {0}, content,
+                work::compact {work::difficulty {difficulty}},
+                bytes {}, uint32_little {r.uint32 ()}, bytes {}, true).write ();
+
+            digest256 txid {};
+            for (byte &b : txid) b = byte (r.uint32 (255));
+
+            arrivals.push_back (arrival {t,
+                Bitcoin::prevout {Bitcoin::outpoint {Bitcoin::txid {txid}, index++}, Bitcoin::output {Bitcoin::satoshi {value}, script}},
+                competitor_solve (r, s, t, script)});
+        }
+
+        return arrivals;
+    }
+
+    // The replay file is a JSON array of objects like
+    //   {"time": 12.5, "job": <content of a boostpow.job.created message>, "solved": 300}
+    // where "solved" is optional and gives the time at which the job was redeemed by
+    // someone else. If it is missing, it is drawn using the competitor hashrate.
+    std::vector<arrival> replay (random &r, const settings &s, const string &filename) {
+        std::ifstream file {filename};
+        if (!file) throw data::exception {} << "could not open " << filename;
+
+        std::stringstream ss;
+        ss << file.rdbuf ();
+        JSON j = JSON::parse (ss.str ());
+        if (!j.is_array ()) throw data::exception {} << "expected a JSON array in " << filename;
+
+        std::vector<arrival> arrivals {};
+        for (const JSON &x : j) {
+            if (!x.is_object () || !x.contains ("time") || !x["time"].is_number () || !x.contains ("job"))
+                throw data::exception {} << "invalid replay entry " << x;
+
+            auto prevout = pow_co::websockets_protocol_message::job_created (x["job"]);
+            if (!bool (prevout)) throw data::exception {} << "invalid job in replay entry " << x;
+
+            double t = x["time"];
+            arrivals.push_back (arrival {t, *prevout,
+                x.contains ("solved") && x["solved"].is_number () ? double (x["solved"]) :
+                    competitor_solve (r, s, t, prevout->script ())});
+        }
+
+        std::sort (arrivals.begin (), arrivals.end (), [] (const arrival &a, const arrival &b) {
+            return a.Time < b.Time;
+        });
+
+        return arrivals;
+    }
+
+    struct report {
+        string Policy;
+        double Revenue {0};
+        // total hashes done by all threads.
+        double Hashes {0};
+        uint32 Arrived {0};
+        uint32 Solved {0};
+        uint32 Lost {0};
+        double TimeToSolve {0};
+        uint64 Switches {0};
+        double Hours {0};
+        uint32 Threads {0};
+
+        explicit operator JSON () const {
+            return JSON {
+                {"policy", Policy},
+                {"jobs_arrived", Arrived},
+                {"jobs_solved", Solved},
+                {"jobs_lost_to_competitors", Lost},
+                {"revenue", Revenue},
+                {"sats_per_hour", Revenue / Hours},
+                // satoshis earned per hour of one hash/second, counting only time spent hashing.
+                {"sats_per_hash_hour", Hashes > 0 ? Revenue / (Hashes / 3600) : 0},
+                {"mean_time_to_solve", Solved > 0 ? TimeToSolve / Solved : 0},
+                {"switches_per_thread_hour", Switches / (Threads * Hours)}
+            };
+        }
+    };
+
+    struct simulated_manager final : manager {
+
+        struct redeemer final : manager::redeemer {
+            digest256 Job;
+            double ReadyAt;
+
+            redeemer (manager *m) : manager::redeemer {m}, Job {}, ReadyAt {0} {}
+
+            // the simulation reads the current job directly.
+            void pose (const work::puzzle &) final override {}
+            work::puzzle select () final override {
+                return work::puzzle {};
+            }
+        };
+
+        const settings &Settings;
+        casual_random Random;
+        double Time;
+
+        // jobs that have arrived and have not been redeemed by anybody.
+        struct live {
+            double Arrived;
+            double SolvedByCompetitor;
+            list<Bitcoin::outpoint> Outpoints;
+        };
+
+        std::map<digest256, live> Live;
+
+        report Report;
+
+        simulated_manager (network &net, fees &f, const map_key_database &keys, address_source &addresses,
+            const settings &s, const string &policy) :
+            manager {net, f, keys, addresses, s.Seed, -1, 0, 0, scheduling_policy::make (policy), 0},
+            Settings {s}, Random {s.Seed + 2}, Time {0}, Live {}, Report {} {
+            Report.Policy = policy;
+            Report.Hours = s.Hours;
+            Report.Threads = s.Threads;
+            for (uint32 i = 0; i < s.Threads; i++) add_new_miner (std::make_shared<redeemer> (this));
+        }
+
+        std::chrono::steady_clock::time_point now () override {
+            return std::chrono::steady_clock::time_point {} +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double> {Time});
+        }
+
+        redeemer &thread (uint32 i) {
+            return static_cast<redeemer &> (*Redeemers[i]);
+        }
+
+        // hashes/second that we are putting into each job right now.
+        std::map<digest256, double> hashrates () {
+            std::map<digest256, double> rates {};
+            for (uint32 i = 0; i < Settings.Threads; i++)
+                if (thread (i).Job != digest256 {} && thread (i).ReadyAt <= Time)
+                    rates[thread (i).Job] += Settings.ThreadHashrate;
+            return rates;
+        }
+
+        // count threads that have been moved to a different job.
+        void observe () {
+            for (uint32 i = 0; i < Settings.Threads; i++) {
+                digest256 current = thread (i).current ();
+                if (current == thread (i).Job) continue;
+                if (current != digest256 {}) {
+                    Report.Switches++;
+                    thread (i).ReadyAt = Time + Settings.SwitchLatency;
+                }
+                thread (i).Job = current;
+            }
+        }
+
+        // we have redeemed a job.
+        void redeemed (const digest256 &id) {
+            std::unique_lock<std::mutex> lock (Mutex);
+
+            auto w = Jobs.Jobs.find (id);
+            if (w == Jobs.Jobs.end ()) return;
+
+            market m {};
+            m.FeeRate = Settings.FeeRate;
+            Report.Revenue += net_value (w->second, m);
+            Report.Solved++;
+            Report.TimeToSolve += Time - Live[id].Arrived;
+
+            for (const auto &o : Live[id].Outpoints) Jobs.Scripts.erase (o);
+            Live.erase (id);
+            remove_job (w);
+        }
+
+        // somebody else has redeemed a job.
+        void lost (const digest256 &id) {
+            for (const auto &o : Live[id].Outpoints) solved_job (o);
+            Live.erase (id);
+            Report.Lost++;
+        }
+
+        void play (const std::vector<arrival> &arrivals) {
+            double end = Settings.Hours * 3600;
+            double next_tick = 30;
+            auto next = arrivals.begin ();
+
+            while (Time < end) {
+                auto rates = hashrates ();
+
+                // every job we are working on is solved at rate (our hashrate) / (expected hashes).
+                std::map<digest256, double> solve_rates {};
+                double total_solve_rate = 0;
+                for (const auto &[id, rate] : rates) {
+                    auto w = Jobs.Jobs.find (id);
+                    if (w == Jobs.Jobs.end ()) continue;
+                    double x = rate / expected_hashes (w->second);
+                    solve_rates[id] = x;
+                    total_solve_rate += x;
+                }
+
+                // the time of the next event of each kind.
+                double solve = Time + exponential (Random, total_solve_rate);
+                double arrive = next == arrivals.end () ? infinity : next->Time;
+
+                double competitor = infinity;
+                digest256 competitor_job {};
+                for (const auto &[id, x] : Live) if (x.SolvedByCompetitor < competitor) {
+                    competitor = x.SolvedByCompetitor;
+                    competitor_job = id;
+                }
+
+                double ready = infinity;
+                for (uint32 i = 0; i < Settings.Threads; i++)
+                    if (thread (i).ReadyAt > Time && thread (i).ReadyAt < ready) ready = thread (i).ReadyAt;
+
+                double t = std::min ({solve, arrive, competitor, ready, next_tick, end});
+
+                // account for the work done until then.
+                for (uint32 i = 0; i < Settings.Threads; i++) {
+                    if (thread (i).Job == digest256 {}) continue;
+                    double hashing = t - std::max (Time, thread (i).ReadyAt);
+                    if (hashing <= 0) continue;
+                    thread (i).Hashes += uint64 (hashing * Settings.ThreadHashrate);
+                    Report.Hashes += hashing * Settings.ThreadHashrate;
+                }
+
+                Time = t;
+
+                if (t == end) break;
+
+                if (t == solve) {
+                    double x = Random.range01 () * total_solve_rate;
+                    for (const auto &[id, rate] : solve_rates) {
+                        x -= rate;
+                        if (x <= 0) {
+                            redeemed (id);
+                            break;
+                        }
+                    }
+                } else if (t == competitor) lost (competitor_job);
+                else if (t == arrive) {
+                    digest256 id = SHA2_256 (next->Prevout.script ());
+                    auto &x = Live[id];
+                    if (data::empty (x.Outpoints)) x = live {t, next->SolvedByCompetitor, {}};
+                    x.Outpoints = x.Outpoints << static_cast<Bitcoin::outpoint> (next->Prevout);
+                    Report.Arrived++;
+                    new_job (next->Prevout);
+                    next++;
+                } else if (t == next_tick) {
+                    tick ();
+                    next_tick += 30;
+                }
+
+                observe ();
+            }
+        }
+    };
+
+    report simulate (const settings &s, const std::vector<arrival> &arrivals, const string &policy) {
+        // a key is needed to make redeem transactions for bounty jobs.
+        digest512 bits = SHA2_512 (string {"boost market simulation"});
+        secp256k1::secret secret;
+        HD::chain_code chain_code (32);
+        std::copy (bits.begin (), bits.begin () + 32, secret.Value.begin ());
+        std::copy (bits.begin () + 32, bits.end (), chain_code.begin ());
+        Bitcoin::secret key (HD::BIP_32::secret {secret, chain_code, HD::BIP_32::main});
+
+        network net {};
+        given_fees fees {s.FeeRate};
+        map_key_database keys {std::static_pointer_cast<key_source> (std::make_shared<single_key_source> (key))};
+        single_address_source addresses {key.address ()};
+
+        auto m = std::make_shared<simulated_manager> (net, fees, keys, addresses, s, policy);
+        m->play (arrivals);
+        return m->Report;
+    }
+
+    list<string> read_list (const string &x) {
+        list<string> l {};
+        std::stringstream ss {x};
+        string item;
+        while (std::getline (ss, item, ',')) if (item != "") l <<= item;
+        return l;
+    }
+
+    settings read_settings (const argh::parser &command_line) {
+        settings s {};
+
+        if (auto option = command_line ("threads"); option) option >> s.Threads;
+        if (auto option = command_line ("thread_hashrate"); option) option >> s.ThreadHashrate;
+        if (auto option = command_line ("hours"); option) option >> s.Hours;
+        if (auto option = command_line ("jobs_per_hour"); option) option >> s.JobsPerHour;
+        if (auto option = command_line ("min_difficulty"); option) option >> s.MinDifficulty;
+        if (auto option = command_line ("max_difficulty"); option) option >> s.MaxDifficulty;
+        if (auto option = command_line ("min_profitability"); option) option >> s.MinProfitability;
+        if (auto option = command_line ("max_profitability"); option) option >> s.MaxProfitability;
+        if (auto option = command_line ("competitor_hashrate"); option) option >> s.CompetitorHashrate;
+        if (auto option = command_line ("switch_latency"); option) option >> s.SwitchLatency;
+        if (auto option = command_line ("fee_rate"); option) option >> s.FeeRate;
+        if (auto option = command_line ("seed"); option) option >> s.Seed;
+        if (auto option = command_line ("replay"); option) s.Replay = option.str ();
+        if (auto option = command_line ("policies"); option) s.Policies = read_list (option.str ());
+
+        if (s.Threads == 0) throw data::exception {"need at least one thread"};
+        if (s.ThreadHashrate <= 0 || s.Hours <= 0 || s.JobsPerHour <= 0) throw data::exception {"rates and times must be positive"};
+        if (s.MinDifficulty <= 0 || s.MaxDifficulty < s.MinDifficulty) throw data::exception {"invalid difficulty range"};
+        if (s.MinProfitability <= 0 || s.MaxProfitability < s.MinProfitability) throw data::exception {"invalid profitability range"};
+
+        for (const string &policy : s.Policies) if (policy != "random" && policy != "expected_value")
+            throw data::exception {} << "unknown policy " << policy;
+
+        return s;
+    }
+
+}
+
+int help () {
+    std::cout << "Simulate the job market to compare scheduling policies. Options are"
+        "\n\t--threads=<uint>              (= 8) simulated mining threads."
+        "\n\t--thread_hashrate=<float>     (= 1048576) hashes/second of each thread."
+        "\n\t--hours=<float>               (= 24) length of the simulation."
+        "\n\t--jobs_per_hour=<float>       (= 60) arrival rate of synthetic jobs."
+        "\n\t--min_difficulty=<float>      (= .00001)"
+        "\n\t--max_difficulty=<float>      (= .01) difficulties of synthetic jobs are log-uniform in this range."
+        "\n\t--min_profitability=<float>   (= 1000)"
+        "\n\t--max_profitability=<float>   (= 100000) sats per difficulty of synthetic jobs."
+        "\n\t--competitor_hashrate=<float> (= 0) hashes/second of other miners working on bounty jobs."
+        "\n\t--switch_latency=<float>      (= .5) seconds lost each time a thread changes jobs."
+        "\n\t--fee_rate=<float>            (= .05) sats per byte of redeem transactions."
+        "\n\t--seed=<uint>                 (= 1)"
+        "\n\t--replay=<filename>           replay recorded jobs instead of making synthetic jobs."
+        "\n\t--policies=<list>             (= random,expected_value) comma-separated policies to compare."
+        "\n\t--log_level=<level>           (= off) the manager's log, which is written to stderr."
+        "\nOne line of JSON is written for each policy." << std::endl;
+    return 0;
+}
+
+int main (int arg_count, char** arg_values) {
+    argh::parser command_line (arg_count, arg_values);
+
+    if (command_line[{"-h", "--help"}] || command_line (1).str () == "help") return help ();
+
+    try {
+        auto s = simulation::read_settings (command_line);
+
+        // the manager writes a lot of messages that aren't interesting here.
+        logger::set_level (logger::off);
+        if (auto option = command_line ("log_level"); option) logger::set_level (logger::read_level (option.str ()));
+
+        // the manager's own messages to std::cout are thrown away below by replacing its
+        // buffer, which the logger's thread must not be using, so the log goes to std::cerr.
+        logger::set_output (std::cerr);
+
+        BoostPOW::casual_random r {s.Seed};
+        auto arrivals = bool (s.Replay) ? simulation::replay (r, s, *s.Replay) : simulation::synthesize (r, s);
+
+        for (const string &policy : s.Policies) {
+            std::stringstream discard;
+            auto out = std::cout.rdbuf (discard.rdbuf ());
+            simulation::report result;
+            try {
+                result = simulation::simulate (s, arrivals, policy);
+            } catch (...) {
+                std::cout.rdbuf (out);
+                throw;
+            }
+
+            std::cout.rdbuf (out);
+            std::cout << JSON (result) << std::endl;
+        }
+
+    } catch (const std::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return 1;
+    }
+
+    logger::flush ();
+    return 0;
+}
@@ -0,0 +1,624 @@
+#include <stratum.hpp>
+#include <logger.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace BoostPOW {
+
+    namespace stratum {
+
+        string write_uint32 (uint32 x) {
+            char out[9];
+            std::snprintf (out, 9, "%08x", x);
+            return string {out};
+        }
+
+        maybe<uint32> read_uint32 (const JSON &j) {
+            if (!j.is_string ()) return {};
+            string x = j;
+            if (x.size () != 8 || x.find_first_not_of ("0123456789abcdefABCDEF") != string::npos) return {};
+            return uint32 (std::stoul (x, nullptr, 16));
+        }
+
+        namespace {
+
+            string write_uint256 (const uint256 &x) {
+                bytes b (32);
+                std::copy (x.begin (), x.end (), b.begin ());
+                return encoding::hex::write (b);
+            }
+
+            maybe<uint256> read_uint256 (const JSON &j) {
+                if (!j.is_string ()) return {};
+                maybe<bytes> b = encoding::hex::read (string (j));
+                if (!bool (b) || b->size () != 32) return {};
+                uint256 x {};
+                std::copy (b->begin (), b->end (), x.begin ());
+                return x;
+            }
+
+            maybe<bytes> read_bytes (const JSON &j) {
+                if (!j.is_string ()) return {};
+                return encoding::hex::read (string (j));
+            }
+
+        }
+
+        JSON notify (const string &job_id, const work::puzzle &p, Bitcoin::timestamp now, bool clean) {
+            return JSON::array ({
+                job_id,
+                write_uint256 (p.Candidate.Digest),
+                encoding::hex::write (p.Header),
+                encoding::hex::write (p.Body),
+                JSON::array (),
+                write_uint32 (uint32 (int32 (p.Candidate.Category))),
+                write_uint32 (uint32 (p.Candidate.Target)),
+                write_uint32 (now.Value),
+                clean,
+                write_uint32 (uint32 (int32 (p.Mask)))});
+        }
+
+        maybe<job> read_notify (const JSON &params) {
+            if (!params.is_array () || params.size () != 10 || !params[0].is_string () ||
+                !params[4].is_array () || params[4].size () != 0 || !params[8].is_boolean ()) return {};
+
+            auto digest = read_uint256 (params[1]);
+            auto header = read_bytes (params[2]);
+            auto body = read_bytes (params[3]);
+            auto category = read_uint32 (params[5]);
+            auto target = read_uint32 (params[6]);
+            auto mask = read_uint32 (params[9]);
+
+            if (!bool (digest) || !bool (header) || !bool (body) || !bool (category) || !bool (target) || !bool (mask)) return {};
+
+            work::puzzle p {};
+            p.Candidate.Category = int32 (*category);
+            p.Candidate.Digest = *digest;
+            p.Candidate.Target = work::compact (*target);
+            p.Header = *header;
+            p.Body = *body;
+            p.Mask = int32 (*mask);
+
+            if (!p.valid ()) return {};
+
+            return job {string (params[0]), p, bool (params[8])};
+        }
+
+        JSON set_difficulty (double d) {
+            return JSON::array ({d});
+        }
+
+        maybe<double> read_set_difficulty (const JSON &params) {
+            if (!params.is_array () || params.size () != 1 || !params[0].is_number ()) return {};
+            double d = params[0];
+            if (!std::isfinite (d) || d <= 0) return {};
+            return d;
+        }
+
+        uint256 share_target (const work::puzzle &p, double share_difficulty) {
+            uint256 target = p.Candidate.Target.expand ();
+            if (share_difficulty <= 0) return target;
+
+            uint256 share = work::compact {work::difficulty {share_difficulty}}.expand ();
+            return target < share ? share : target;
+        }
+
+        JSON submit (const string &worker, const string &job_id, const work::solution &x) {
+            JSON params = JSON::array ({
+                worker,
+                job_id,
+                encoding::hex::write (x.Share.ExtraNonce2),
+                write_uint32 (x.Share.Timestamp.Value),
+                write_uint32 (uint32 (x.Share.Nonce))});
+
+            if (x.Share.Bits) params.push_back (write_uint32 (uint32 (*x.Share.Bits)));
+
+            return params;
+        }
+
+        maybe<share> read_submit (const JSON &params, Stratum::session_id extra_nonce_1) {
+            if (!params.is_array () || params.size () < 5 || params.size () > 6 ||
+                !params[0].is_string () || !params[1].is_string ()) return {};
+
+            auto extra_nonce_2 = read_bytes (params[2]);
+            auto timestamp = read_uint32 (params[3]);
+            auto nonce = read_uint32 (params[4]);
+
+            if (!bool (extra_nonce_2) || extra_nonce_2->size () != extra_nonce_2_size ||
+                !bool (timestamp) || !bool (nonce)) return {};
+
+            work::solution x {Bitcoin::timestamp {*timestamp}, *nonce, bytes_view (*extra_nonce_2), extra_nonce_1};
+
+            if (params.size () == 6) {
+                auto bits = read_uint32 (params[5]);
+                if (!bool (bits)) return {};
+                x.Share.Bits = *bits;
+            }
+
+            return share {string (params[0]), string (params[1]), x};
+        }
+
+        JSON request (uint64 id, const string &method, JSON params) {
+            return JSON {{"id", id}, {"method", method}, {"params", std::move (params)}};
+        }
+
+        JSON response (const JSON &id, JSON result) {
+            return JSON {{"id", id}, {"result", std::move (result)}, {"error", nullptr}};
+        }
+
+        JSON error (const JSON &id, int code, const string &message) {
+            return JSON {{"id", id}, {"result", nullptr}, {"error", JSON::array ({code, message, nullptr})}};
+        }
+
+    }
+
+    using tcp = net::asio::ip::tcp;
+
+    struct stratum_server::connection final : manager::redeemer, std::enable_shared_from_this<connection> {
+
+        ptr<stratum_server> Server;
+        tcp::socket Socket;
+        net::asio::streambuf Buffer;
+        std::deque<string> Outgoing;
+
+        Stratum::session_id ExtraNonce1;
+        bool Subscribed;
+        bool Authorized;
+        bool Closed;
+
+        struct sent {
+            snapshot Job;
+            uint256 ShareTarget;
+
+            // the work that a share represents on average.
+            double ShareDifficulty;
+        };
+
+        // jobs that have been sent, by Stratum job id, and the share
+        // difficulty last sent. Only touched with Mutex locked.
+        std::map<string, sent> Sent;
+        std::deque<string> SentOrder;
+        uint64 NextJob;
+        double Difficulty;
+
+        connection (ptr<stratum_server> server, tcp::socket socket, Stratum::session_id extra_nonce_1) :
+            manager::redeemer {server->Manager.get ()}, Server {server}, Socket {std::move (socket)},
+            Buffer {stratum::max_line_size}, Outgoing {}, ExtraNonce1 {extra_nonce_1}, Subscribed {false}, Authorized {false},
+            Closed {false}, Sent {}, SentOrder {}, NextJob {0}, Difficulty {0} {}
+
+        // called by the manager with Mutex locked when this connection is given a new job.
+        void pose (const work::puzzle &p) final override {
+            if (!p.valid () || Current == nullptr) return;
+
+            double share_difficulty = std::min (Server->ShareDifficulty, Current->Puzzle.difficulty ());
+
+            string job_id = stratum::write_uint32 (uint32 (NextJob++));
+            Sent[job_id] = sent {Current, stratum::share_target (p, share_difficulty), share_difficulty};
+            SentOrder.push_back (job_id);
+
+            // workers may still be finishing the last couple of jobs.
+            while (SentOrder.size () > 4) {
+                Sent.erase (SentOrder.front ());
+                SentOrder.pop_front ();
+            }
+
+            // a new difficulty applies to the jobs after it.
+            std::vector<JSON> messages {};
+            if (share_difficulty != Difficulty) {
+                Difficulty = share_difficulty;
+                messages.push_back (stratum::request (0, "mining.set_difficulty", stratum::set_difficulty (share_difficulty)));
+            }
+
+            messages.push_back (stratum::request (0, "mining.notify", stratum::notify (job_id, p, Bitcoin::timestamp::now (), true)));
+
+            net::asio::post (Server->IO, [self = shared_from_this (), messages] () mutable {
+                for (JSON &message : messages) {
+                    message["id"] = nullptr;
+                    self->send (message);
+                }
+            });
+        }
+
+        // connections don't run mining threads.
+        work::puzzle select () final override {
+            return work::puzzle {};
+        }
+
+        void send (const JSON &message) {
+            if (Closed) return;
+            Outgoing.push_back (message.dump () + "\n");
+            if (Outgoing.size () == 1) write ();
+        }
+
+        void write () {
+            net::asio::async_write (Socket, net::asio::buffer (Outgoing.front ()),
+                [self = shared_from_this ()] (boost::system::error_code err, size_t) {
+                    if (err) return self->close ();
+                    self->Outgoing.pop_front ();
+                    if (self->Outgoing.size () > 0) self->write ();
+                });
+        }
+
+        void read () {
+            net::asio::async_read_until (Socket, Buffer, '\n',
+                [self = shared_from_this ()] (boost::system::error_code err, size_t size) {
+                    if (err) return self->close ();
+
+                    string line {net::asio::buffers_begin (self->Buffer.data ()),
+                        net::asio::buffers_begin (self->Buffer.data ()) + size};
+                    self->Buffer.consume (size);
+
+                    try {
+                        self->handle (JSON::parse (line));
+                    } catch (const JSON::exception &x) {
+                        logger::log (logger::warning, "stratum.invalid_message", JSON {
+                            {"extra_nonce_1", stratum::write_uint32 (uint32 (self->ExtraNonce1))},
+                            {"error", x.what ()}
+                        });
+                        return self->close ();
+                    }
+
+                    self->read ();
+                });
+        }
+
+        void handle (const JSON &message) {
+            if (!message.is_object () || !message.contains ("method") || !message["method"].is_string ())
+                return send (stratum::error (message.value ("id", JSON (nullptr)), 20, "invalid request"));
+
+            JSON id = message.value ("id", JSON (nullptr));
+            string method = message["method"];
+            JSON params = message.value ("params", JSON::array ());
+
+            if (method == "mining.subscribe") {
+                Subscribed = true;
+                send (stratum::response (id, JSON::array ({
+                    JSON::array ({JSON::array ({"mining.notify", stratum::write_uint32 (uint32 (ExtraNonce1))})}),
+                    stratum::write_uint32 (uint32 (ExtraNonce1)),
+                    stratum::extra_nonce_2_size})));
+                return;
+            }
+
+            if (method == "mining.authorize") {
+                if (!Subscribed) return send (stratum::error (id, 25, "not subscribed"));
+
+                send (stratum::response (id, true));
+                if (Authorized) return;
+                Authorized = true;
+
+                logger::log ("stratum.connected", JSON {
+                    {"extra_nonce_1", stratum::write_uint32 (uint32 (ExtraNonce1))},
+                    {"worker", params.size () > 0 ? params[0] : JSON (nullptr)}
+                });
+
+                // the manager will pose a job right away if it has one.
+                Server->Manager->add_new_miner (std::static_pointer_cast<manager::redeemer> (shared_from_this ()));
+                return;
+            }
+
+            if (method == "mining.submit") {
+                if (!Authorized) return send (stratum::error (id, 24, "unauthorized worker"));
+
+                auto share = stratum::read_submit (params, ExtraNonce1);
+                if (!bool (share)) return send (stratum::error (id, 20, "invalid share"));
+
+                sent s;
+                {
+                    std::unique_lock<std::mutex> lock (Mutex);
+                    auto x = Sent.find (share->JobID);
+                    if (x == Sent.end ()) return send (stratum::error (id, 21, "job not found"));
+                    s = x->second;
+                }
+
+                work::proof proof {s.Job->Work, share->Solution};
+                if (!(proof.string ().hash () < s.ShareTarget))
+                    return send (stratum::error (id, 23, "low difficulty share"));
+
+                send (stratum::response (id, true));
+
+                // count the work that a share represents on average so that the manager can measure our hashrate.
+                Hashes += uint64 (s.ShareDifficulty * 4294967296.);
+                Server->Shares++;
+
+                if (!proof.valid ()) return;
+
+                logger::log ("stratum.solution", JSON {
+                    {"extra_nonce_1", stratum::write_uint32 (uint32 (ExtraNonce1))},
+                    {"script_hash", BoostPOW::write (s.Job->ID)}
+                });
+
+                net::asio::post (Server->Redeeming, [m = Server->Manager, job = s.Job, solution = share->Solution] () {
+                    // an exception would end the whole program on a pool thread.
+                    try {
+                        m->submit (std::pair<digest256, Boost::puzzle> {job->ID, job->Puzzle}, solution);
+                    } catch (const std::exception &e) {
+                        logger::log (logger::warning, "stratum.redeem_failed", JSON {
+                            {"script_hash", BoostPOW::write (job->ID)},
+                            {"error", e.what ()}
+                        });
+                    }
+                });
+
+                return;
+            }
+
+            send (stratum::error (id, 20, string {"unsupported method "} + method));
+        }
+
+        void close () {
+            if (Closed) return;
+            Closed = true;
+
+            boost::system::error_code err;
+            Socket.close (err);
+
+            logger::log ("stratum.disconnected", JSON {
+                {"extra_nonce_1", stratum::write_uint32 (uint32 (ExtraNonce1))}
+            });
+
+            if (Authorized) Server->Manager->remove_miner (std::static_pointer_cast<manager::redeemer> (shared_from_this ()));
+        }
+    };
+
+    stratum_server::stratum_server (ptr<manager> m, net::asio::io_context &io, uint16 port, uint32 first_extra_nonce_1,
+        double share_difficulty) :
+        Manager {m}, IO {io}, Acceptor {io, tcp::endpoint {tcp::v4 (), port}}, NextExtraNonce1 {first_extra_nonce_1},
+        ShareDifficulty {share_difficulty}, Shares {0}, Redeeming {2} {}
+
+    void stratum_server::start () {
+        logger::log ("stratum.listening", JSON {{"port", port ()}});
+        accept ();
+    }
+
+    void stratum_server::accept () {
+        Acceptor.async_accept ([self = shared_from_this ()] (boost::system::error_code err, tcp::socket socket) {
+            if (err) {
+                logger::log (logger::error, "stratum.accept_failed", JSON {{"error", err.message ()}});
+                return;
+            }
+
+            auto c = std::make_shared<connection> (self, std::move (socket), Stratum::session_id {self->NextExtraNonce1++});
+            c->read ();
+            self->accept ();
+        });
+    }
+
+    stratum_worker::stratum_worker (uint32 threads, std::vector<int32> cpus) :
+        Mutex {}, In {}, Current {}, Stop {false}, Epoch {0}, Started {0}, Hashes {0},
+        LatencyCount {0}, LatencyTotal {0}, LatencyMax {0}, Threads {}, IO {}, Socket {},
+        Buffer {stratum::max_line_size}, Outgoing {}, Name {}, ExtraNonce1 {}, NextRequest {3}, ShareDifficulty {0}, Session {0} {
+        for (uint32 i = 0; i < threads; i++) Threads.emplace_back ([this, i, cpu = i < cpus.size () ? cpus[i] : -1] () {
+            mine (i, cpu);
+        });
+    }
+
+    stratum_worker::~stratum_worker () {
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            Stop = true;
+            Epoch++;
+        }
+
+        In.notify_all ();
+        for (std::thread &t : Threads) t.join ();
+    }
+
+    void stratum_worker::assign (std::optional<assignment> a) {
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            Current = std::move (a);
+            Epoch++;
+        }
+
+        In.notify_all ();
+    }
+
+    void stratum_worker::mine (uint32 index, int32 cpu) {
+        affinity::pin (cpu);
+
+        // the server gives us our own extra nonce 1, so the partition only has to separate threads.
+        std::optional<search_partition> partition {};
+
+        while (true) {
+            assignment a;
+            uint64 epoch;
+            {
+                std::unique_lock<std::mutex> lock (Mutex);
+                In.wait (lock, [this] () {
+                    return Stop || bool (Current);
+                });
+
+                if (Stop) return;
+                a = *Current;
+                epoch = Epoch;
+            }
+
+            if (!partition || partition->ExtraNonce1 != a.ExtraNonce1)
+                partition.emplace (uint32 (a.ExtraNonce1), uint16 (index));
+
+            work::solution next = partition->next (a.Puzzle);
+
+            started (epoch, a.Received);
+
+            // every share is sent, and the search goes on from the nonce after it.
+            while (Epoch.load () == epoch) {
+                work::proof proof = cpu_solve (a.Puzzle, a.Target, next, 10, &Hashes, &Epoch);
+
+                // nothing found before the time ran out, the range ran out or the job changed.
+                if (proof.Solution.Share.ExtraNonce2.size () == 0) break;
+
+                found (a, proof.Solution);
+
+                if (uint32 (proof.Solution.Share.Nonce) == 0xffffffff) break;
+                next = proof.Solution;
+                next.Share.Nonce++;
+            }
+        }
+    }
+
+    void stratum_worker::started (uint64 epoch, std::chrono::steady_clock::time_point received) {
+        uint64 last = Started.load ();
+        do if (last >= epoch) return;
+        while (!Started.compare_exchange_weak (last, epoch));
+
+        double latency = std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now () - received).count ();
+
+        double mean, max;
+        {
+            std::unique_lock<std::mutex> lock (Mutex);
+            LatencyCount++;
+            LatencyTotal += latency;
+            if (latency > LatencyMax) LatencyMax = latency;
+            mean = LatencyTotal / LatencyCount;
+            max = LatencyMax;
+        }
+
+        logger::log ("stratum.notify_latency", JSON {
+            {"microseconds", latency},
+            {"mean", mean},
+            {"max", max}
+        });
+    }
+
+    void stratum_worker::found (const assignment &a, const work::solution &x) {
+        logger::log ("stratum.found", JSON {
+            {"job_id", a.JobID},
+            {"nonce", stratum::write_uint32 (uint32 (x.Share.Nonce))},
+            {"solution", work::proof {a.Puzzle, x}.valid ()}
+        });
+
+        net::asio::post (IO, [this, session = a.Session, job_id = a.JobID, x] () {
+            // the job id and extra nonce 1 mean nothing on a new connection.
+            if (session != Session) return;
+            send (stratum::request (NextRequest++, "mining.submit", stratum::submit (Name, job_id, x)));
+        });
+    }
+
+    void stratum_worker::run (const string &host, uint16 port, const string &name) {
+        IO.restart ();
+        Session++;
+        Name = name;
+        ExtraNonce1 = {};
+        Outgoing.clear ();
+        Buffer.consume (Buffer.size ());
+
+        tcp::resolver resolver {IO};
+        Socket.emplace (IO);
+        net::asio::connect (*Socket, resolver.resolve (host, std::to_string (port)));
+
+        logger::log ("stratum.connected", JSON {{"host", host}, {"port", port}});
+
+        send (stratum::request (1, "mining.subscribe", JSON::array ({"BoostMiner"})));
+        send (stratum::request (2, "mining.authorize", JSON::array ({name, ""})));
+        read ();
+
+        IO.run ();
+
+        // stop mining until we have a new connection. Anything we had left to send is dropped.
+        assign ({});
+        Outgoing.clear ();
+        Socket.reset ();
+
+        logger::log ("stratum.disconnected", JSON {{"host", host}, {"port", port}});
+    }
+
+    void stratum_worker::stop () {
+        IO.stop ();
+    }
+
+    void stratum_worker::send (const JSON &message) {
+        if (!Socket || !Socket->is_open ()) return;
+        Outgoing.push_back (message.dump () + "\n");
+        if (Outgoing.size () == 1) write ();
+    }
+
+    void stratum_worker::write () {
+        net::asio::async_write (*Socket, net::asio::buffer (Outgoing.front ()),
+            [this] (boost::system::error_code err, size_t) {
+                if (err) return IO.stop ();
+                Outgoing.pop_front ();
+                if (Outgoing.size () > 0) write ();
+            });
+    }
+
+    void stratum_worker::read () {
+        net::asio::async_read_until (*Socket, Buffer, '\n',
+            [this] (boost::system::error_code err, size_t size) {
+                if (err) return IO.stop ();
+
+                string line {net::asio::buffers_begin (Buffer.data ()),
+                    net::asio::buffers_begin (Buffer.data ()) + size};
+                Buffer.consume (size);
+
+                try {
+                    handle (JSON::parse (line));
+                } catch (const JSON::exception &x) {
+                    logger::log (logger::warning, "stratum.invalid_message", JSON {{"error", x.what ()}});
+                    return IO.stop ();
+                }
+
+                read ();
+            });
+    }
+
+    void stratum_worker::handle (const JSON &message) {
+        if (!message.is_object ()) throw data::exception {"invalid Stratum message"};
+
+        if (message.contains ("method") && message["method"] == "mining.notify") {
+            auto received = std::chrono::steady_clock::now ();
+
+            if (!bool (ExtraNonce1)) return;
+
+            auto job = stratum::read_notify (message.value ("params", JSON (nullptr)));
+            if (!bool (job)) {
+                logger::log (logger::warning, "stratum.invalid_job", message);
+                return;
+            }
+
+            assign (assignment {job->ID, job->Puzzle, stratum::share_target (job->Puzzle, ShareDifficulty),
+                *ExtraNonce1, Session, received});
+            return;
+        }
+
+        if (message.contains ("method") && message["method"] == "mining.set_difficulty") {
+            auto d = stratum::read_set_difficulty (message.value ("params", JSON (nullptr)));
+            if (!bool (d)) {
+                logger::log (logger::warning, "stratum.invalid_difficulty", message);
+                return;
+            }
+
+            ShareDifficulty = *d;
+            return;
+        }
+
+        JSON id = message.value ("id", JSON (nullptr));
+        if (!id.is_number ()) return;
+
+        JSON result = message.value ("result", JSON (nullptr));
+        JSON err = message.value ("error", JSON (nullptr));
+
+        // response to mining.subscribe
+        if (id == 1) {
+            if (!result.is_array () || result.size () != 3) throw data::exception {"invalid response to mining.subscribe"};
+
+            auto extra_nonce_1 = stratum::read_uint32 (result[1]);
+            if (!bool (extra_nonce_1) || result[2] != stratum::extra_nonce_2_size)
+                throw data::exception {"unsupported subscription"};
+
+            ExtraNonce1 = Stratum::session_id {*extra_nonce_1};
+            return;
+        }
+
+        // response to mining.authorize
+        if (id == 2) {
+            if (result != true) throw data::exception {} << "not authorized: " << err.dump ();
+            return;
+        }
+
+        // response to mining.submit
+        if (result == true) logger::log ("stratum.share.accepted", JSON {{"id", id}});
+        else logger::log (logger::warning, "stratum.share.rejected", JSON {{"id", id}, {"error", err}});
+    }
+
+}
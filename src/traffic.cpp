@@ -0,0 +1,239 @@
+#include <traffic.hpp>
+#include <logger.hpp>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <zlib.h>
+
+namespace BoostPOW::traffic {
+
+    namespace {
+
+        constexpr char magic[4] = {'B', 'M', 'T', 'R'};
+        constexpr uint32 version = 1;
+
+        template <typename N> void write_number (bytes &out, N n) {
+            uint64 x;
+            if constexpr (std::is_floating_point_v<N>) std::memcpy (&x, &n, sizeof (x));
+            else x = uint64 (n);
+            for (size_t i = 0; i < sizeof (N); i++) out.push_back (byte (x >> (8 * i)));
+        }
+
+        void write_string (bytes &out, const string &x) {
+            write_number (out, uint32 (x.size ()));
+            out.insert (out.end (), x.begin (), x.end ());
+        }
+
+        struct reader {
+            const byte *Next;
+            const byte *End;
+
+            bool read (byte *out, size_t size) {
+                if (size_t (End - Next) < size) return false;
+                std::memcpy (out, Next, size);
+                Next += size;
+                return true;
+            }
+
+            template <typename N> bool read_number (N &n) {
+                uint64 x = 0;
+                for (size_t i = 0; i < sizeof (N); i++) {
+                    if (Next == End) return false;
+                    x |= uint64 (*Next++) << (8 * i);
+                }
+
+                if constexpr (std::is_floating_point_v<N>) std::memcpy (&n, &x, sizeof (n));
+                else n = N (x);
+                return true;
+            }
+
+            bool read_string (string &x) {
+                uint32 size;
+                if (!read_number (size) || size_t (End - Next) < size) return false;
+                x.assign (reinterpret_cast<const char *> (Next), size);
+                Next += size;
+                return true;
+            }
+        };
+
+        template <typename X> string print (const X &x) {
+            std::stringstream ss;
+            ss << x;
+            return ss.str ();
+        }
+
+        string key (const string &method, const string &url, const string &body) {
+            return method + " " + url + "\n" + body;
+        }
+
+        double seconds (std::chrono::steady_clock::duration d) {
+            return std::chrono::duration<double> (d).count ();
+        }
+
+    }
+
+    bytes write_header () {
+        bytes out {};
+        for (char c : magic) out.push_back (byte (c));
+        write_number (out, version);
+        return out;
+    }
+
+    bytes write (const exchange &x) {
+        bytes out {};
+        write_number (out, byte (x.Kind));
+        write_number (out, x.Time);
+        write_number (out, x.Duration);
+        write_string (out, x.Method);
+        write_string (out, x.URL);
+        write_string (out, x.RequestBody);
+        write_number (out, x.Status);
+        write_string (out, x.Error);
+        write_string (out, x.Body);
+        return out;
+    }
+
+    std::vector<exchange> read (const byte *data, size_t size) {
+        reader r {data, data + size};
+
+        char m[4];
+        uint32 v;
+        if (!r.read (reinterpret_cast<byte *> (m), 4) || std::memcmp (m, magic, 4) != 0 ||
+            !r.read_number (v) || v != version) throw data::exception {"not a recording of API traffic"};
+
+        std::vector<exchange> xx {};
+        while (r.Next != r.End) {
+            exchange x {};
+            byte kind;
+            if (!r.read_number (kind) || (kind != exchange::http && kind != exchange::websocket) ||
+                !r.read_number (x.Time) || !r.read_number (x.Duration) ||
+                !r.read_string (x.Method) || !r.read_string (x.URL) || !r.read_string (x.RequestBody) ||
+                !r.read_number (x.Status) || !r.read_string (x.Error) || !r.read_string (x.Body)) break;
+
+            x.Kind = exchange::kind (kind);
+            xx.push_back (std::move (x));
+        }
+
+        return xx;
+    }
+
+    recorder::recorder (const std::filesystem::path &path) :
+        Mutex {}, File {gzopen (path.c_str (), "wb")}, Start {std::chrono::steady_clock::now ()}, Count {0} {
+        if (File == nullptr) throw data::exception {} << "could not open " << path.string () << " to record API traffic";
+
+        bytes header = write_header ();
+        gzwrite (static_cast<gzFile> (File), header.data (), header.size ());
+        gzflush (static_cast<gzFile> (File), Z_SYNC_FLUSH);
+    }
+
+    recorder::~recorder () {
+        gzclose (static_cast<gzFile> (File));
+    }
+
+    void recorder::put (const exchange &x) {
+        bytes b = write (x);
+        std::lock_guard<std::mutex> lock (Mutex);
+        gzwrite (static_cast<gzFile> (File), b.data (), b.size ());
+        gzflush (static_cast<gzFile> (File), Z_SYNC_FLUSH);
+        Count++;
+    }
+
+    void recorder::http (const net::HTTP::request &req, const net::HTTP::response &res,
+        std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+        exchange x {};
+        x.Kind = exchange::http;
+        x.Time = seconds (begin - Start);
+        x.Duration = seconds (end - begin);
+        x.Method = print (req.Method);
+        x.URL = print (req.URL);
+        x.RequestBody = req.Body;
+        x.Status = uint32 (res.Status);
+        x.Body = res.Body;
+        put (x);
+    }
+
+    void recorder::http_failed (const net::HTTP::request &req, const string &error,
+        std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+        exchange x {};
+        x.Kind = exchange::http;
+        x.Time = seconds (begin - Start);
+        x.Duration = seconds (end - begin);
+        x.Method = print (req.Method);
+        x.URL = print (req.URL);
+        x.RequestBody = req.Body;
+        x.Error = error;
+        put (x);
+    }
+
+    void recorder::websocket (const string &message) {
+        exchange x {};
+        x.Kind = exchange::websocket;
+        x.Time = seconds (std::chrono::steady_clock::now () - Start);
+        x.Body = message;
+        put (x);
+    }
+
+    uint64 recorder::count () const {
+        std::lock_guard<std::mutex> lock (Mutex);
+        return Count;
+    }
+
+    std::vector<exchange> load (const std::filesystem::path &path) {
+        gzFile file = gzopen (path.c_str (), "rb");
+        if (file == nullptr) throw data::exception {} << "could not open recording " << path.string ();
+
+        // a recording that was cut off ends in the middle of a gzip block,
+        // in which case gzread gives us what it could and then an error.
+        bytes contents {};
+        byte buffer[1 << 16];
+        int n;
+        while ((n = gzread (file, buffer, sizeof (buffer))) > 0) contents.insert (contents.end (), buffer, buffer + n);
+        gzclose (file);
+
+        return read (contents.data (), contents.size ());
+    }
+
+    player::player (const std::filesystem::path &path, double speed) : player {load (path), speed} {}
+
+    player::player (std::vector<exchange> xx, double speed) : Speed {speed}, Mutex {}, Responses {}, Messages {} {
+        if (speed < 0) throw data::exception {"replay speed cannot be negative"};
+        for (exchange &x : xx)
+            if (x.Kind == exchange::websocket) Messages.push_back (std::move (x));
+            else Responses[key (x.Method, x.URL, x.RequestBody)].push_back (std::move (x));
+
+        logger::log ("replay.loaded", JSON {
+            {"requests", xx.size () - Messages.size ()},
+            {"websocket_messages", Messages.size ()},
+            {"speed", speed}
+        });
+    }
+
+    std::chrono::duration<double> player::when (const exchange &x) const {
+        return std::chrono::duration<double> (Speed == 0 ? 0 : x.Time / Speed);
+    }
+
+    net::HTTP::response player::operator () (const net::HTTP::request &req) {
+        string k = key (print (req.Method), print (req.URL), req.Body);
+
+        exchange x;
+        {
+            std::lock_guard<std::mutex> lock (Mutex);
+            auto it = Responses.find (k);
+            if (it == Responses.end ())
+                throw data::exception {} << "no recorded response to " << print (req.Method) << " " << print (req.URL);
+
+            x = it->second.front ();
+            if (it->second.size () > 1) it->second.pop_front ();
+        }
+
+        if (Speed > 0) std::this_thread::sleep_for (std::chrono::duration<double> (x.Duration / Speed));
+
+        if (x.Status == 0) throw data::exception {} << x.Error;
+
+        net::HTTP::response res {};
+        res.Status = static_cast<net::HTTP::status> (x.Status);
+        res.Body = x.Body;
+        return res;
+    }
+
+}
@@ -0,0 +1,168 @@
+#include <warm_start.hpp>
+#include <logger.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BoostPOW::warm_start {
+
+    namespace {
+
+        constexpr char magic[4] = {'B', 'M', 'W', 'S'};
+        constexpr uint32 version = 1;
+
+        template <typename N> void write_number (bytes &out, N n) {
+            uint64 x;
+            if constexpr (std::is_floating_point_v<N>) std::memcpy (&x, &n, sizeof (x));
+            else x = uint64 (n);
+            for (size_t i = 0; i < sizeof (N); i++) out.push_back (byte (x >> (8 * i)));
+        }
+
+        struct reader {
+            const byte *Next;
+            const byte *End;
+
+            bool read (byte *out, size_t size) {
+                if (size_t (End - Next) < size) return false;
+                std::memcpy (out, Next, size);
+                Next += size;
+                return true;
+            }
+
+            template <typename N> bool read_number (N &n) {
+                uint64 x = 0;
+                for (size_t i = 0; i < sizeof (N); i++) {
+                    if (Next == End) return false;
+                    x |= uint64 (*Next++) << (8 * i);
+                }
+
+                if constexpr (std::is_floating_point_v<N>) std::memcpy (&n, &x, sizeof (n));
+                else n = N (x);
+                return true;
+            }
+        };
+
+    }
+
+    bytes write (const state &s) {
+        bytes out {};
+        for (char c : magic) out.push_back (byte (c));
+        write_number (out, version);
+        write_number (out, s.Saved);
+        write_number (out, s.FeeRate);
+        write_number (out, s.KeysDrawn);
+        write_number (out, uint32 (s.Jobs.Jobs.size ()));
+
+        for (const auto &[id, job] : s.Jobs.Jobs) {
+            write_number (out, uint32 (job.Script.size ()));
+            out.insert (out.end (), job.Script.begin (), job.Script.end ());
+
+            auto prevouts = job.Prevouts.values ();
+            write_number (out, uint32 (data::size (prevouts)));
+            for (const auto &p : prevouts) {
+                Bitcoin::outpoint o = static_cast<Bitcoin::outpoint> (p);
+                out.insert (out.end (), o.Digest.begin (), o.Digest.end ());
+                write_number (out, uint32 (o.Index));
+                write_number (out, int64 (p.Value));
+            }
+        }
+
+        return out;
+    }
+
+    maybe<state> read (const byte *data, size_t size) {
+        reader r {data, data + size};
+
+        char m[4];
+        uint32 v;
+        if (!r.read (reinterpret_cast<byte *> (m), 4) || std::memcmp (m, magic, 4) != 0 ||
+            !r.read_number (v) || v != version) return {};
+
+        state s {};
+        uint32 scripts;
+        if (!r.read_number (s.Saved) || !r.read_number (s.FeeRate) ||
+            !r.read_number (s.KeysDrawn) || !r.read_number (scripts)) return {};
+
+        for (uint32 i = 0; i < scripts; i++) {
+            uint32 script_size;
+            if (!r.read_number (script_size)) return {};
+            if (size_t (r.End - r.Next) < script_size) return {};
+            bytes script (script_size);
+            std::copy (r.Next, r.Next + script_size, script.begin ());
+            r.Next += script_size;
+
+            uint32 prevouts;
+            if (!r.read_number (prevouts)) return {};
+            for (uint32 j = 0; j < prevouts; j++) {
+                byte hash[32];
+                uint32 index;
+                int64 value;
+                if (!r.read (hash, 32) || !r.read_number (index) || !r.read_number (value)) return {};
+
+                digest256 txid {};
+                std::copy (hash, hash + 32, txid.begin ());
+
+                s.Jobs.add_prevout (Bitcoin::prevout {
+                    Bitcoin::outpoint {Bitcoin::txid {txid}, index},
+                    Bitcoin::output {Bitcoin::satoshi {value}, script}});
+            }
+        }
+
+        if (r.Next != r.End) return {};
+
+        return s;
+    }
+
+    maybe<state> load (const std::filesystem::path &path) {
+#ifdef __linux__
+        int fd = ::open (path.c_str (), O_RDONLY);
+        if (fd < 0) return {};
+
+        struct stat info;
+        if (::fstat (fd, &info) != 0 || info.st_size == 0) {
+            ::close (fd);
+            return {};
+        }
+
+        void *mapped = ::mmap (nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close (fd);
+        if (mapped == MAP_FAILED) return {};
+
+        auto s = read (static_cast<const byte *> (mapped), info.st_size);
+        ::munmap (mapped, info.st_size);
+#else
+        std::ifstream file {path, std::ios::binary};
+        if (!file) return {};
+        string contents {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+        auto s = read (reinterpret_cast<const byte *> (contents.data ()), contents.size ());
+#endif
+
+        if (!bool (s)) logger::log (logger::warning, "warm_start.unreadable", JSON {{"path", path.string ()}});
+        return s;
+    }
+
+    void save (const std::filesystem::path &path, const state &s) {
+        if (path.has_parent_path ()) std::filesystem::create_directories (path.parent_path ());
+
+        bytes b = write (s);
+        std::filesystem::path temporary = path;
+        temporary += ".tmp";
+
+        {
+            std::ofstream file {temporary, std::ios::binary | std::ios::trunc};
+            if (!file) throw data::exception {} << "could not write " << temporary.string ();
+            file.write (reinterpret_cast<const char *> (b.data ()), b.size ());
+            if (!file) throw data::exception {} << "could not write " << temporary.string ();
+        }
+
+        std::filesystem::rename (temporary, path);
+    }
+
+}
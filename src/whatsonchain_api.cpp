@@ -1,4 +1,5 @@
 #include <whatsonchain_api.hpp>
+#include <json_stream.hpp>
 
 bool whatsonchain::transactions::broadcast(const bytes &tx) {
     
@@ -74,7 +75,7 @@ list<UTXO> whatsonchain::addresses::get_unspent (const Bitcoin::address &addr) {
     return UTXOs;
 }
 
-list<UTXO> whatsonchain::scripts::get_unspent (const digest256 &script_hash) {
+std::vector<UTXO> whatsonchain::scripts::get_unspent (const digest256 &script_hash) {
     
     std::stringstream ss;
     ss << script_hash;
@@ -90,25 +91,11 @@ list<UTXO> whatsonchain::scripts::get_unspent (const digest256 &script_hash) {
     if (response.Headers[networking::HTTP::header::content_type] != "application/JSON") 
         throw networking::HTTP::exception{request, response, "response header content_type does not indicate application/JSON"};
     */
-    list<UTXO> UTXOs;
-    
     try {
-        
-        JSON unspent_UTXOs_JSON = JSON::parse (response.Body);
-        
-        for (const JSON &item : unspent_UTXOs_JSON) {
-            
-            UTXO u (item);
-            if (!u.valid ()) throw response;
-            
-            UTXOs <<= u;
-            
-        }
-    } catch (const JSON::exception &exception) {
+        return BoostPOW::json_stream::read_unspent (response.Body);
+    } catch (const data::exception &exception) {
         throw net::HTTP::exception {request, response, string {"problem reading JSON: "} + string {exception.what()}};
     }
-    
-    return UTXOs;
 }
 
 list<Bitcoin::txid> whatsonchain::scripts::get_history (const digest256& script_hash) {
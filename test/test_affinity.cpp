@@ -0,0 +1,51 @@
+#include <affinity.hpp>
+#include "gtest/gtest.h"
+
+namespace BoostPOW {
+
+    // two packages with two cores each and two siblings per core. Siblings
+    // are numbered the way Linux usually does it, after all the first siblings.
+    std::vector<affinity::cpu> dual_socket () {
+        return {
+            {0, 0, 0, 0}, {1, 0, 1, 0}, {2, 1, 0, 1}, {3, 1, 1, 1},
+            {4, 0, 0, 0}, {5, 0, 1, 0}, {6, 1, 0, 1}, {7, 1, 1, 1}};
+    }
+
+    TEST (AffinityTest, TestOff) {
+        auto p = affinity::place (dual_socket (), 3, affinity::mode::off);
+        EXPECT_EQ (p.Mining, (std::vector<int32> {-1, -1, -1}));
+        EXPECT_EQ (p.IO, -1);
+
+        auto q = affinity::place ({}, 2, affinity::mode::cores);
+        EXPECT_EQ (q.Mining, (std::vector<int32> {-1, -1}));
+        EXPECT_EQ (q.IO, -1);
+    }
+
+    TEST (AffinityTest, TestCores) {
+        // three threads leave the last core for IO.
+        auto p = affinity::place (dual_socket (), 3, affinity::mode::cores);
+        EXPECT_EQ (p.Mining, (std::vector<int32> {0, 1, 2}));
+        EXPECT_EQ (p.IO, 3);
+
+        // with four there is no core left for IO.
+        auto q = affinity::place (dual_socket (), 4, affinity::mode::cores);
+        EXPECT_EQ (q.Mining, (std::vector<int32> {0, 1, 2, 3}));
+        EXPECT_EQ (q.IO, -1);
+
+        // siblings are not used, so extra threads are not pinned.
+        auto r = affinity::place (dual_socket (), 5, affinity::mode::cores);
+        EXPECT_EQ (r.Mining, (std::vector<int32> {0, 1, 2, 3, -1}));
+    }
+
+    TEST (AffinityTest, TestSMT) {
+        // physical cores first, then siblings.
+        auto p = affinity::place (dual_socket (), 6, affinity::mode::smt);
+        EXPECT_EQ (p.Mining, (std::vector<int32> {0, 1, 2, 4, 5, 6}));
+        EXPECT_EQ (p.IO, 3);
+
+        auto q = affinity::place (dual_socket (), 8, affinity::mode::smt);
+        EXPECT_EQ (q.Mining, (std::vector<int32> {0, 1, 2, 3, 4, 5, 6, 7}));
+        EXPECT_EQ (q.IO, -1);
+    }
+
+}
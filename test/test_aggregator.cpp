@@ -0,0 +1,95 @@
+#include <aggregator.hpp>
+#include <miner.hpp>
+#include <gigamonkey/incomplete.hpp>
+#include <gigamonkey/script/pattern/pay_to_address.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+
+namespace BoostPOW {
+
+    // a job with the given number of outputs, easy enough to solve right away.
+    Boost::puzzle test_puzzle (uint32 user_nonce, uint32 outputs) {
+        bytes script = test_bounty_script (.00001, user_nonce);
+
+        list<Bitcoin::prevout> prevouts {};
+        for (uint32 i = 0; i < outputs; i++) prevouts <<= test_bounty_prevout (script, user_nonce * 10 + i);
+
+        return Boost::puzzle {Boost::candidate {prevouts}, test_key};
+    }
+
+    // two solved puzzles with three outputs between them.
+    std::vector<aggregator::entry> test_entries () {
+        std::vector<aggregator::entry> entries {};
+        for (uint32 n : {1, 2}) {
+            Boost::puzzle p = test_puzzle (n, n);
+            search_partition partition {0, 1};
+            work::proof proof = solve (partition, work::puzzle (p), 60, nullptr);
+            if (!proof.valid ()) throw data::exception {"could not solve test puzzle"};
+            entries.push_back (aggregator::entry {p, proof.Solution});
+        }
+
+        return entries;
+    }
+
+    TEST (AggregatorTest, TestRedeem) {
+        auto entries = test_entries ();
+        bytes pay_script = pay_to_address::script (digest160 {});
+        Bitcoin::transaction tx = aggregator::redeem (entries, pay_script, .5);
+
+        // the inputs are in the order of the entries and their outputs.
+        std::vector<Bitcoin::prevout> prevouts {};
+        list<transaction_design::input> inputs {};
+        for (const auto &e : entries) for (const auto &p : e.Puzzle.Prevouts.values ()) {
+            prevouts.push_back (static_cast<Bitcoin::prevout> (p));
+            inputs <<= transaction_design::input (prevouts.back (), 0);
+        }
+
+        ASSERT_EQ (data::size (tx.Inputs), prevouts.size ());
+        ASSERT_EQ (data::size (tx.Outputs), 1);
+        EXPECT_EQ (tx.Outputs.first ().Script, pay_script);
+        EXPECT_LT (int64 (tx.Outputs.first ().Value), 30000);
+
+        Bitcoin::incomplete::transaction incomplete (transaction_design {1, inputs, tx.Outputs, 0});
+
+        uint32 index = 0;
+        for (const Bitcoin::input &in : tx.Inputs) {
+            const Bitcoin::prevout &p = prevouts[index];
+            EXPECT_EQ (in.Reference, p.outpoint ());
+
+            // every input is signed against its own sighash document.
+            EXPECT_TRUE (bool (Bitcoin::evaluate (in.Script, p.script (),
+                Bitcoin::redemption_document {p.value (), incomplete, index})));
+
+            // and not against that of the next input, even where both spend the same script.
+            uint32 next = (index + 1) % prevouts.size ();
+            EXPECT_FALSE (bool (Bitcoin::evaluate (in.Script, prevouts[next].script (),
+                Bitcoin::redemption_document {prevouts[next].value (), incomplete, next})));
+
+            index++;
+        }
+    }
+
+    TEST (AggregatorTest, TestRetry) {
+        auto entries = test_entries ();
+        given_fees fees {.5};
+
+        std::vector<bytes> broadcast {};
+        {
+            aggregator a {60, 2, fees, [] () -> bytes {
+                return pay_to_address::script (digest160 {});
+            }, [&broadcast] (const bytes &tx) {
+                broadcast.push_back (tx);
+                if (broadcast.size () == 1) throw data::exception {"broadcast failed"};
+            }};
+
+            for (const auto &e : entries) a.add (e);
+        }
+
+        // when the transaction with every puzzle is rejected, each puzzle is redeemed on its own.
+        ASSERT_EQ (broadcast.size (), 3);
+        EXPECT_EQ (data::size (Bitcoin::transaction {broadcast[0]}.Inputs), 3);
+        EXPECT_EQ (data::size (Bitcoin::transaction {broadcast[1]}.Inputs), 1);
+        EXPECT_EQ (data::size (Bitcoin::transaction {broadcast[2]}.Inputs), 2);
+    }
+
+}
@@ -0,0 +1,71 @@
+#include <autotune.hpp>
+#include "gtest/gtest.h"
+#include <fstream>
+
+namespace BoostPOW {
+
+    std::filesystem::path test_cache (const string &name) {
+        auto path = std::filesystem::temp_directory_path () / "boostminer_test" / name;
+        std::filesystem::remove (path);
+        return path;
+    }
+
+    TEST (AutotuneTest, TestRoundTrip) {
+        auto path = test_cache ("round_trip.json");
+        EXPECT_FALSE (bool (autotune::cached (path, "model a")));
+
+        autotune::save (path, "model a", autotune::configuration {"cpu", 4, 12345678.5});
+        // every model is kept in the same file.
+        autotune::save (path, "model b", autotune::configuration {"cpu", 2, 1000});
+
+        auto a = autotune::cached (path, "model a");
+        ASSERT_TRUE (bool (a));
+        EXPECT_EQ (a->Backend, "cpu");
+        EXPECT_EQ (a->Threads, 4);
+        EXPECT_EQ (a->Hashrate, 12345678.5);
+
+        auto b = autotune::cached (path, "model b");
+        ASSERT_TRUE (bool (b));
+        EXPECT_EQ (b->Threads, 2);
+
+        // saving again replaces the entry.
+        autotune::save (path, "model a", autotune::configuration {"cpu", 8, 2});
+        EXPECT_EQ (autotune::cached (path, "model a")->Threads, 8);
+
+        std::filesystem::remove (path);
+    }
+
+    TEST (AutotuneTest, TestModelMismatch) {
+        auto path = test_cache ("model_mismatch.json");
+        autotune::save (path, "model a x8", autotune::configuration {"cpu", 4, 100});
+
+        // a different cpu, or the same one with a different number of cores.
+        EXPECT_FALSE (bool (autotune::cached (path, "model b x8")));
+        EXPECT_FALSE (bool (autotune::cached (path, "model a x16")));
+
+        std::filesystem::remove (path);
+    }
+
+    TEST (AutotuneTest, TestCorrupt) {
+        auto path = test_cache ("corrupt.json");
+
+        for (const string &contents : {
+            string {"{\"model a\": {\"backend\": \"cpu\", \"thr"},
+            string {"[1, 2, 3]"},
+            string {"{\"model a\": {\"backend\": \"gpu\", \"threads\": 4, \"hashrate\": 100}}"},
+            string {"{\"model a\": {\"backend\": \"cpu\", \"threads\": 0, \"hashrate\": 100}}"},
+            string {"{\"model a\": {\"backend\": \"cpu\", \"threads\": -4, \"hashrate\": 100}}"},
+            string {"{\"model a\": {\"backend\": \"cpu\", \"threads\": 4}}"}}) {
+            std::filesystem::create_directories (path.parent_path ());
+            std::ofstream {path} << contents;
+            EXPECT_FALSE (bool (autotune::cached (path, "model a"))) << contents;
+        }
+
+        // a damaged cache is overwritten.
+        autotune::save (path, "model a", autotune::configuration {"cpu", 4, 100});
+        EXPECT_EQ (autotune::cached (path, "model a")->Threads, 4);
+
+        std::filesystem::remove (path);
+    }
+
+}
@@ -0,0 +1,63 @@
+#include <connection_pool.hpp>
+#include "gtest/gtest.h"
+#include <zlib.h>
+
+namespace BoostPOW {
+
+    string gzip (const string &in) {
+        z_stream z {};
+        deflateInit2 (&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        z.next_in = reinterpret_cast<Bytef *> (const_cast<char *> (in.data ()));
+        z.avail_in = in.size ();
+
+        string out (deflateBound (&z, in.size ()), '\0');
+        z.next_out = reinterpret_cast<Bytef *> (out.data ());
+        z.avail_out = out.size ();
+        deflate (&z, Z_FINISH);
+        out.resize (z.total_out);
+        deflateEnd (&z);
+        return out;
+    }
+
+    TEST (ConnectionPoolTest, TestReadURL) {
+        auto a = connection_pool::read_url ("https://api.whatsonchain.com/v1/bsv/main/tx/raw");
+        ASSERT_TRUE (bool (a));
+        EXPECT_TRUE (a->TLS);
+        EXPECT_EQ (a->Host, "api.whatsonchain.com");
+        EXPECT_EQ (a->Port, 443);
+        EXPECT_EQ (a->Target, "/v1/bsv/main/tx/raw");
+
+        auto b = connection_pool::read_url ("http://localhost:8080?limit=10");
+        ASSERT_TRUE (bool (b));
+        EXPECT_FALSE (b->TLS);
+        EXPECT_EQ (b->Host, "localhost");
+        EXPECT_EQ (b->Port, 8080);
+        EXPECT_EQ (b->Target, "/?limit=10");
+
+        auto c = connection_pool::read_url ("https://pow.co");
+        ASSERT_TRUE (bool (c));
+        EXPECT_EQ (c->Target, "/");
+
+        EXPECT_FALSE (bool (connection_pool::read_url ("pow.co/api")));
+        EXPECT_FALSE (bool (connection_pool::read_url ("ws://pow.co/")));
+        EXPECT_FALSE (bool (connection_pool::read_url ("https://:443/")));
+        EXPECT_FALSE (bool (connection_pool::read_url ("https://pow.co:0/")));
+        EXPECT_FALSE (bool (connection_pool::read_url ("https://pow.co:65536/")));
+    }
+
+    TEST (ConnectionPoolTest, TestGunzip) {
+        string body {};
+        for (int i = 0; i < 1000; i++) body += "{\"txid\": \"ffeeddccbbaa99887766554433221100\", \"vout\": 0},";
+
+        string compressed = gzip (body);
+        EXPECT_LT (compressed.size (), body.size ());
+        EXPECT_EQ (connection_pool::gunzip (compressed), body);
+
+        EXPECT_EQ (connection_pool::gunzip (gzip ("")), string {});
+
+        // truncated or not gzip at all.
+        EXPECT_FALSE (bool (connection_pool::gunzip (compressed.substr (0, compressed.size () / 2))));
+        EXPECT_FALSE (bool (connection_pool::gunzip (body)));
+    }
+
+}
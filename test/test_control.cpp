@@ -0,0 +1,89 @@
+#include <control.hpp>
+#include "gtest/gtest.h"
+
+namespace BoostPOW {
+
+    struct test_miner final : controllable {
+        uint32 Threads {1};
+        bool Paused {false};
+        double MinProfitability {0};
+        double MaxDifficulty {-1};
+
+        JSON status () override {
+            return JSON {
+                {"threads", Threads},
+                {"paused", Paused},
+                {"min_profitability", MinProfitability},
+                {"max_difficulty", MaxDifficulty}
+            };
+        }
+
+        void set_threads (uint32 n) override {
+            Threads = n;
+        }
+
+        void pause (bool p) override {
+            Paused = p;
+        }
+
+        void set_filters (maybe<double> min_profitability, maybe<double> max_difficulty) override {
+            if (bool (min_profitability)) MinProfitability = *min_profitability;
+            if (bool (max_difficulty)) MaxDifficulty = *max_difficulty;
+        }
+    };
+
+    TEST (ControlTest, TestCommands) {
+        test_miner m {};
+
+        JSON status = control (m, JSON {{"command", "status"}});
+        EXPECT_TRUE (status["ok"]);
+        EXPECT_EQ (status["status"]["threads"], 1);
+
+        JSON grown = control (m, JSON {{"command", "threads"}, {"threads", 8}});
+        EXPECT_TRUE (grown["ok"]);
+        EXPECT_EQ (m.Threads, 8);
+        EXPECT_EQ (grown["status"]["threads"], 8);
+
+        EXPECT_TRUE (control (m, JSON {{"command", "threads"}, {"threads", 0}})["ok"]);
+        EXPECT_EQ (m.Threads, 0);
+
+        EXPECT_TRUE (control (m, JSON {{"command", "pause"}})["ok"]);
+        EXPECT_TRUE (m.Paused);
+        EXPECT_TRUE (control (m, JSON {{"command", "resume"}})["ok"]);
+        EXPECT_FALSE (m.Paused);
+
+        // filters that are not given are left alone.
+        EXPECT_TRUE (control (m, JSON {{"command", "filters"}, {"max_difficulty", 100}})["ok"]);
+        EXPECT_EQ (m.MaxDifficulty, 100);
+        EXPECT_EQ (m.MinProfitability, 0);
+
+        EXPECT_TRUE (control (m, JSON {{"command", "filters"}, {"min_profitability", .5}})["ok"]);
+        EXPECT_EQ (m.MaxDifficulty, 100);
+        EXPECT_EQ (m.MinProfitability, .5);
+    }
+
+    TEST (ControlTest, TestInvalidCommands) {
+        test_miner m {};
+
+        for (const JSON &command : std::vector<JSON> {
+            JSON::array (),
+            JSON {{"threads", 2}},
+            JSON {{"command", "stop"}},
+            JSON {{"command", "threads"}},
+            JSON {{"command", "threads"}, {"threads", -1}},
+            JSON {{"command", "threads"}, {"threads", "4"}},
+            JSON {{"command", "threads"}, {"threads", 65536}},
+            JSON {{"command", "filters"}},
+            JSON {{"command", "filters"}, {"min_profitability", -1}}}) {
+            JSON reply = control (m, command);
+            EXPECT_FALSE (reply["ok"]) << "on " << command;
+            EXPECT_TRUE (reply.contains ("error"));
+        }
+
+        // nothing was changed.
+        EXPECT_EQ (m.Threads, 1);
+        EXPECT_EQ (m.MinProfitability, 0);
+        EXPECT_EQ (m.MaxDifficulty, -1);
+    }
+
+}
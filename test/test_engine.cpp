@@ -0,0 +1,106 @@
+#include <engine.hpp>
+#include "gtest/gtest.h"
+
+namespace BoostPOW {
+
+    work::puzzle test_puzzle (double difficulty) {
+        work::puzzle p {};
+        p.Candidate.Category = 0;
+        p.Candidate.Digest = uint256 {};
+        p.Candidate.Target = work::compact {work::difficulty {difficulty}};
+        p.Header = bytes (32);
+        p.Body = bytes (32);
+        p.Mask = -1;
+        return p;
+    }
+
+    // solved in well under a second.
+    const work::puzzle easy = test_puzzle (.00001);
+
+    // never solved during a test.
+    const work::puzzle hard = test_puzzle (1e12);
+
+    template <typename X> bool ready (std::future<X> &f, double seconds = 5) {
+        return f.wait_for (std::chrono::duration<double> (seconds)) == std::future_status::ready;
+    }
+
+    TEST (EngineTest, TestSolve) {
+        engine e {2};
+        auto f = e.submit (easy);
+        ASSERT_TRUE (ready (f));
+
+        auto r = f.get ();
+        EXPECT_EQ (r.Status, engine::result::solved);
+        EXPECT_TRUE (r.Proof.valid ());
+
+        auto s = e.stats ();
+        EXPECT_EQ (s.Threads, 2);
+        EXPECT_EQ (s.Solved, 1);
+        EXPECT_GT (s.Hashes, 0);
+    }
+
+    TEST (EngineTest, TestCancel) {
+        engine e {1};
+
+        std::stop_source stop {};
+        auto f = e.submit (hard, 0, 0, stop.get_token ());
+        EXPECT_FALSE (ready (f, .1));
+
+        stop.request_stop ();
+        ASSERT_TRUE (ready (f, 1));
+        EXPECT_EQ (f.get ().Status, engine::result::cancelled);
+
+        // a token that is already stopped.
+        auto g = e.submit (hard, 0, 0, stop.get_token ());
+        ASSERT_TRUE (ready (g, 1));
+        EXPECT_EQ (g.get ().Status, engine::result::cancelled);
+
+        EXPECT_EQ (e.stats ().Cancelled, 2);
+    }
+
+    TEST (EngineTest, TestExpire) {
+        engine e {1};
+        auto f = e.submit (hard, 0, .2);
+        ASSERT_TRUE (ready (f, 2));
+        EXPECT_EQ (f.get ().Status, engine::result::expired);
+        EXPECT_EQ (e.stats ().Expired, 1);
+        EXPECT_EQ (e.stats ().Queued, 0);
+    }
+
+    TEST (EngineTest, TestPriority) {
+        engine e {1};
+
+        std::stop_source stop {};
+        auto low = e.submit (hard, 0, 0, stop.get_token ());
+
+        // the only thread drops the hard puzzle to work on this one.
+        auto high = e.submit (easy, 1);
+        ASSERT_TRUE (ready (high));
+        EXPECT_EQ (high.get ().Status, engine::result::solved);
+        EXPECT_FALSE (ready (low, 0));
+
+        stop.request_stop ();
+        ASSERT_TRUE (ready (low, 1));
+        EXPECT_EQ (low.get ().Status, engine::result::cancelled);
+    }
+
+    TEST (EngineTest, TestStopped) {
+        std::atomic<int> stopped {0};
+        {
+            engine e {1};
+            for (int i = 0; i < 3; i++) e.submit ([&stopped] (const engine::result &r) {
+                if (r.Status == engine::result::stopped) stopped++;
+            }, hard);
+        }
+
+        EXPECT_EQ (stopped, 3);
+    }
+
+    TEST (EngineTest, TestInvalid) {
+        EXPECT_THROW (engine {0}, data::exception);
+
+        engine e {1};
+        EXPECT_THROW (e.submit (easy, 0, -1), data::exception);
+    }
+
+}
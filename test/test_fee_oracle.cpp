@@ -0,0 +1,77 @@
+#include <fee_oracle.hpp>
+#include "gtest/gtest.h"
+#include <future>
+
+namespace BoostPOW {
+
+    fee_oracle::source test_quote (double rate) {
+        return [rate] () -> double {
+            return rate;
+        };
+    }
+
+    fee_oracle::source test_failure () {
+        return [] () -> double {
+            throw data::exception {"no quote"};
+        };
+    }
+
+    TEST (FeeOracleTest, TestMedian) {
+        EXPECT_EQ (fee_oracle::median ({5}), 5);
+        EXPECT_EQ (fee_oracle::median ({3, 1, 2}), 2);
+        EXPECT_EQ (fee_oracle::median ({4, 1, 3, 2}), 2.5);
+        EXPECT_EQ (fee_oracle::median ({10, 1}), 5.5);
+    }
+
+    TEST (FeeOracleTest, TestQuotes) {
+        // sources that fail or give no rate are left out.
+        {
+            fee_oracle odd {{test_quote (4), test_quote (1), test_failure (), test_quote (0), test_quote (3)}};
+            ASSERT_TRUE (odd.wait_for_quote (std::chrono::seconds {10}));
+            EXPECT_EQ (odd.get (), 3);
+        }
+
+        {
+            fee_oracle even {{test_quote (.1), test_quote (.2), test_quote (.3), test_failure (), test_quote (1)}};
+            ASSERT_TRUE (even.wait_for_quote (std::chrono::seconds {10}));
+            EXPECT_DOUBLE_EQ (even.get (), .25);
+        }
+
+        {
+            fee_oracle none {{test_failure (), test_quote (-1)}, fee_oracle::default_ttl_seconds, .07};
+            EXPECT_FALSE (none.wait_for_quote (std::chrono::milliseconds {100}));
+            EXPECT_FALSE (none.refresh ());
+            EXPECT_EQ (none.get (), .07);
+        }
+
+        EXPECT_THROW (fee_oracle {std::vector<fee_oracle::source> {}}, data::exception);
+    }
+
+    TEST (FeeOracleTest, TestSeed) {
+        // the first quote arrives only when we let it.
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future ().share ();
+
+        fee_oracle oracle {{[released] () -> double {
+            released.wait ();
+            return 2;
+        }}, fee_oracle::default_ttl_seconds, .07};
+
+        EXPECT_EQ (oracle.get (), .07);
+
+        // a seed is used until there is a quote.
+        oracle.seed (1.5);
+        EXPECT_EQ (oracle.get (), 1.5);
+        oracle.seed (-1);
+        EXPECT_EQ (oracle.get (), 1.5);
+
+        release.set_value ();
+        ASSERT_TRUE (oracle.wait_for_quote (std::chrono::seconds {10}));
+        EXPECT_EQ (oracle.get (), 2);
+
+        // and is ignored after.
+        oracle.seed (9);
+        EXPECT_EQ (oracle.get (), 2);
+    }
+
+}
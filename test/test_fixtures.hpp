@@ -0,0 +1,29 @@
+#ifndef BOOSTMINER_TEST_FIXTURES
+#define BOOSTMINER_TEST_FIXTURES
+
+#include <jobs.hpp>
+
+namespace BoostPOW {
+
+    // every test job is a bounty on the same content.
+    inline bytes test_bounty_script (double difficulty, uint32 user_nonce, bool version_2 = true,
+        const bytes &header = {}, const bytes &body = {}) {
+        return Boost::output_script::bounty (
+            int32_little {0},
+            digest256 {"0x00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"},
+            work::compact {work::difficulty {difficulty}},
+            header, uint32_little {user_nonce}, body, version_2).write ();
+    }
+
+    // test outputs differ only by their index.
+    inline Bitcoin::prevout test_bounty_prevout (const bytes &script, uint32 index, int64 value = 10000) {
+        return Bitcoin::prevout {
+            Bitcoin::outpoint {Bitcoin::txid {"0xffeeddccbbaa99887766554433221100ffeeddccbbaa99887766554433221100"}, index},
+            Bitcoin::output {Bitcoin::satoshi {value}, script}};
+    }
+
+    inline const Bitcoin::secret test_key {string {"KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ"}};
+
+}
+
+#endif
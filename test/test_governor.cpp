@@ -0,0 +1,56 @@
+#include <governor.hpp>
+#include "gtest/gtest.h"
+
+namespace BoostPOW {
+
+    TEST (GovernorTest, TestCPUMax) {
+        EXPECT_FALSE (bool (governor::read_cpu_max ("max 100000\n")));
+        EXPECT_FALSE (bool (governor::read_cpu_max ("")));
+        EXPECT_FALSE (bool (governor::read_cpu_max ("50000 0")));
+        EXPECT_FALSE (bool (governor::read_cpu_max ("-1 100000")));
+        EXPECT_EQ (governor::read_cpu_max ("150000 100000\n"), 1.5);
+        EXPECT_EQ (governor::read_cpu_max ("50000 100000"), .5);
+    }
+
+    TEST (GovernorTest, TestCountCPUs) {
+        EXPECT_EQ (governor::count_cpus ("0\n"), 1);
+        EXPECT_EQ (governor::count_cpus ("0-3\n"), 4);
+        EXPECT_EQ (governor::count_cpus ("0-3,6,8-9\n"), 7);
+        EXPECT_EQ (governor::count_cpus (""), 0);
+        EXPECT_EQ (governor::count_cpus ("3-1"), 0);
+        EXPECT_EQ (governor::count_cpus ("a-b"), 0);
+    }
+
+    TEST (GovernorTest, TestCgroupPath) {
+        EXPECT_EQ (governor::read_cgroup_path ("0::/kubepods/pod1/abc\n"), string {"/kubepods/pod1/abc"});
+        // cgroup v1 entries are ignored.
+        EXPECT_EQ (governor::read_cgroup_path ("4:cpu,cpuacct:/docker/abc\n0::/\n"), string {"/"});
+        EXPECT_FALSE (bool (governor::read_cgroup_path ("4:cpu,cpuacct:/docker/abc\n")));
+    }
+
+    TEST (GovernorTest, TestThreads) {
+        EXPECT_EQ ((governor::limits {8, {}}).threads (), 8);
+        EXPECT_EQ ((governor::limits {8, {2.5}}).threads (), 2);
+        EXPECT_EQ ((governor::limits {2, {4}}).threads (), 2);
+        EXPECT_EQ ((governor::limits {8, {.5}}).threads (), 1);
+        EXPECT_EQ ((governor::limits {0, {}}).threads (), 1);
+    }
+
+    TEST (GovernorTest, TestDutyCycle) {
+        EXPECT_THROW (governor::set_duty_cycle (0), std::exception);
+        EXPECT_THROW (governor::set_duty_cycle (1.5), std::exception);
+
+        governor::set_duty_cycle (.5);
+        EXPECT_EQ (governor::duty_cycle (), .5);
+
+        // the thread sleeps about as long as it has been working.
+        governor::begin ();
+        auto start = std::chrono::steady_clock::now ();
+        while (std::chrono::steady_clock::now () - start < std::chrono::milliseconds (20));
+        governor::rest ();
+        EXPECT_GE (std::chrono::steady_clock::now () - start, std::chrono::milliseconds (40));
+
+        governor::set_duty_cycle (1);
+    }
+
+}
@@ -0,0 +1,99 @@
+#include <hedge.hpp>
+#include "gtest/gtest.h"
+#include <atomic>
+
+namespace BoostPOW {
+
+    TEST (HedgeTest, TestPercentile) {
+        latency l {};
+        EXPECT_EQ (l.percentile (.95, 7), 7);
+
+        for (int i = 1; i <= 100; i++) l.record (i / 100.);
+        EXPECT_EQ (l.count (), 100);
+        EXPECT_NEAR (l.percentile (.95, 7), .96, .011);
+        EXPECT_NEAR (l.percentile (.5, 7), .51, .011);
+
+        // only the last 128 are kept.
+        for (int i = 0; i < 128; i++) l.record (2);
+        EXPECT_EQ (l.percentile (.5, 7), 2);
+    }
+
+
+    TEST (HedgeTest, TestPrimary) {
+        auto primary = std::make_shared<latency> ();
+        auto secondary = std::make_shared<latency> ();
+        for (int i = 0; i < 20; i++) primary->record (.05);
+
+        std::atomic<int> secondary_calls {0};
+        int x = hedged<int> ({
+            {primary, [] () { return 1; }},
+            {secondary, [&secondary_calls] () { secondary_calls++; return 2; }}});
+
+        EXPECT_EQ (x, 1);
+        // the primary answered before the threshold, so no hedge was sent.
+        EXPECT_EQ (secondary_calls.load (), 0);
+    }
+
+    TEST (HedgeTest, TestSingle) {
+        auto only = std::make_shared<latency> ();
+
+        // there is nothing to race, so no thread is started.
+        std::thread::id reader {};
+        int x = hedged<int> ({{only, [&reader] () {
+            reader = std::this_thread::get_id ();
+            return 1;
+        }}});
+
+        EXPECT_EQ (x, 1);
+        EXPECT_EQ (reader, std::this_thread::get_id ());
+        EXPECT_EQ (only->count (), 1);
+
+        EXPECT_THROW (hedged<int> ({{only, [] () -> int { throw std::runtime_error {"only"}; }}}), std::runtime_error);
+    }
+
+    TEST (HedgeTest, TestSlowPrimary) {
+        auto primary = std::make_shared<latency> ();
+        auto secondary = std::make_shared<latency> ();
+        for (int i = 0; i < 20; i++) primary->record (.01);
+
+        auto begin = std::chrono::steady_clock::now ();
+        int x = hedged<int> ({
+            {primary, [] () {
+                std::this_thread::sleep_for (std::chrono::milliseconds (500));
+                return 1;
+            }},
+            {secondary, [] () { return 2; }}});
+
+        EXPECT_EQ (x, 2);
+        EXPECT_LT (std::chrono::steady_clock::now () - begin, std::chrono::milliseconds (400));
+
+        // the losing attempt is still running, and its latency is recorded when it ends.
+        primary->wait ();
+        EXPECT_EQ (primary->count (), 21);
+        EXPECT_EQ (secondary->count (), 1);
+    }
+
+    TEST (HedgeTest, TestFailures) {
+        auto primary = std::make_shared<latency> ();
+        auto secondary = std::make_shared<latency> ();
+
+        // a failure passes the request on without waiting for the threshold.
+        auto begin = std::chrono::steady_clock::now ();
+        int x = hedged<int> ({
+            {primary, [] () -> int { throw std::runtime_error {"primary"}; }},
+            {secondary, [] () { return 2; }}});
+        EXPECT_EQ (x, 2);
+        EXPECT_LT (std::chrono::steady_clock::now () - begin, std::chrono::milliseconds (500));
+
+        // if everything fails, the primary's exception is thrown.
+        try {
+            hedged<int> ({
+                {primary, [] () -> int { throw std::runtime_error {"primary"}; }},
+                {secondary, [] () -> int { throw std::runtime_error {"secondary"}; }}});
+            FAIL ();
+        } catch (const std::runtime_error &e) {
+            EXPECT_EQ (string {e.what ()}, "primary");
+        }
+    }
+
+}
@@ -0,0 +1,105 @@
+#include <job_board.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+
+namespace BoostPOW {
+
+    Bitcoin::prevout test_prevout (int64 value, uint32 user_nonce, uint32 index) {
+        return test_bounty_prevout (test_bounty_script (.001, user_nonce), index, value);
+    }
+
+    // every version of the table has a different number of jobs, all with the version as their value.
+    jobs test_jobs (uint64 version) {
+        jobs j {};
+        for (uint32 i = 0; i < version % 5 + 1; i++) j.add_prevout (test_prevout (int64 (version), i, i));
+        return j;
+    }
+
+    // names are shared by every process on the host.
+    string test_name () {
+        return "boostminer_test_" + std::to_string (::getpid ());
+    }
+
+    TEST (JobBoardTest, TestPublish) {
+        EXPECT_EQ (job_board::attach (test_name ()), nullptr);
+
+        auto publisher = job_board::create (test_name ());
+        auto reader = job_board::attach (test_name ());
+        ASSERT_NE (reader, nullptr);
+
+        EXPECT_EQ (reader->version (), 0);
+        EXPECT_FALSE (bool (reader->read ()));
+
+        for (uint64 v = 1; v <= 3; v++) {
+            publisher->publish (test_jobs (v));
+            EXPECT_EQ (reader->version (), v);
+
+            auto t = reader->read ();
+            ASSERT_TRUE (bool (t));
+            EXPECT_EQ (t->Version, v);
+            EXPECT_GT (t->Published, 0);
+            EXPECT_EQ (t->Jobs.Scripts, test_jobs (v).Scripts);
+        }
+
+        EXPECT_THROW (reader->publish (test_jobs (1)), data::exception);
+
+        EXPECT_FALSE (reader->closed ());
+        publisher = nullptr;
+        EXPECT_TRUE (reader->closed ());
+        EXPECT_EQ (job_board::attach (test_name ()), nullptr);
+    }
+
+    TEST (JobBoardTest, TestReplace) {
+        auto first = job_board::create (test_name ());
+        auto reader = job_board::attach (test_name ());
+        ASSERT_NE (reader, nullptr);
+
+        // a publisher that is started again replaces the board, and readers of the old one see it closed.
+        auto second = job_board::create (test_name ());
+        EXPECT_TRUE (reader->closed ());
+        EXPECT_FALSE (job_board::attach (test_name ())->closed ());
+
+        // the old publisher going away doesn't remove the new board.
+        first = nullptr;
+        EXPECT_NE (job_board::attach (test_name ()), nullptr);
+    }
+
+    TEST (JobBoardTest, TestTooBig) {
+        auto publisher = job_board::create (test_name (), 64);
+        EXPECT_THROW (publisher->publish (test_jobs (1)), data::exception);
+        EXPECT_EQ (publisher->version (), 0);
+    }
+
+    TEST (JobBoardTest, TestConcurrent) {
+        auto publisher = job_board::create (test_name ());
+        auto reader = job_board::attach (test_name ());
+        ASSERT_NE (reader, nullptr);
+
+        std::atomic<bool> done {false};
+        std::thread writer {[&publisher, &done] () {
+            for (uint64 v = 1; v <= 2000; v++) publisher->publish (test_jobs (v));
+            done = true;
+        }};
+
+        // every table that is read is one that was published, never a mixture.
+        uint32 reads = 0;
+        while (!done) if (auto t = reader->read (); bool (t)) {
+            reads++;
+            uint32 prevouts = 0;
+            for (const auto &[id, job] : t->Jobs.Jobs) for (const auto &p : job.Prevouts.values ()) {
+                EXPECT_EQ (int64 (p.Value), int64 (t->Version));
+                prevouts++;
+            }
+
+            EXPECT_EQ (prevouts, t->Version % 5 + 1);
+        }
+
+        writer.join ();
+        EXPECT_GT (reads, 0);
+        EXPECT_EQ (reader->read ()->Version, 2000);
+    }
+
+}
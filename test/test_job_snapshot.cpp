@@ -0,0 +1,94 @@
+#include <miner.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+#include <atomic>
+#include <thread>
+
+namespace BoostPOW {
+
+    Bitcoin::prevout test_prevout (double difficulty, uint32 user_nonce, uint32 index, int64 value = 10000) {
+        return test_bounty_prevout (test_bounty_script (difficulty, user_nonce), index, value);
+    }
+
+    snapshot make_snapshot (const digest256 &id, const working &job) {
+        return std::make_shared<const job_snapshot> (id, Boost::puzzle {job, test_key});
+    }
+
+    // wait for the builder, which works on a thread of its own.
+    bool wait_for (snapshot_builder &b, size_t ready) {
+        for (int i = 0; i < 500 && b.ready () < ready; i++) std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        return b.ready () == ready;
+    }
+
+    TEST (JobSnapshotTest, TestSolve) {
+        jobs j {};
+        j.add_prevout (test_prevout (.00001, 1, 0));
+        auto job = j.Jobs.begin ();
+
+        job_snapshot s {job->first, Boost::puzzle {job->second, test_key}};
+        EXPECT_EQ (s.Target, s.Work.Candidate.Target.expand ());
+
+        search_partition partition {0, 1};
+        std::atomic<uint64> hashes {0};
+        work::proof proof = solve (partition, s, 60, &hashes);
+        ASSERT_TRUE (proof.valid ());
+        EXPECT_TRUE ((work::proof {s.Work, proof.Solution}.valid ()));
+        EXPECT_GT (hashes, 0);
+    }
+
+    TEST (JobSnapshotTest, TestBuilder) {
+        std::atomic<int> made {0};
+        snapshot_builder b {[&made] (const digest256 &id, const working &job) -> snapshot {
+            made++;
+            return make_snapshot (id, job);
+        }};
+
+        jobs j {};
+        j.add_prevout (test_prevout (.01, 1, 0));
+        j.add_prevout (test_prevout (.01, 2, 1));
+        j.add_prevout (test_prevout (.01, 3, 2));
+
+        std::vector<std::pair<digest256, working>> wanted (j.Jobs.begin (), j.Jobs.end ());
+        b.prepare (wanted);
+        ASSERT_TRUE (wait_for (b, 3));
+        EXPECT_EQ (made, 3);
+
+        // asking again for the same jobs makes nothing new.
+        b.prepare (wanted);
+        EXPECT_EQ (b.ready (), 3);
+
+        auto first = j.Jobs.begin ();
+        snapshot s = b.take (first->first, first->second);
+        ASSERT_NE (s, nullptr);
+        EXPECT_EQ (s->ID, first->first);
+        EXPECT_TRUE (s->current (first->second));
+        EXPECT_EQ (b.take (first->first, first->second), nullptr);
+        EXPECT_EQ (b.ready (), 2);
+
+        // a job that has gained an output since its snapshot was made needs another.
+        auto second = std::next (first);
+        j.add_prevout (Bitcoin::prevout {
+            Bitcoin::outpoint {Bitcoin::txid {"0x00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"}, 7},
+            Bitcoin::output {Bitcoin::satoshi {5000}, second->second.Script}});
+        EXPECT_EQ (b.take (second->first, second->second), nullptr);
+
+        // jobs that are no longer wanted are dropped.
+        b.prepare ({});
+        EXPECT_EQ (b.ready (), 0);
+    }
+
+    TEST (JobSnapshotTest, TestError) {
+        snapshot_builder b {[] (const digest256 &, const working &) -> snapshot {
+            throw data::exception {"no key"};
+        }};
+
+        jobs j {};
+        j.add_prevout (test_prevout (.01, 1, 0));
+        b.prepare ({j.Jobs.begin (), j.Jobs.end ()});
+
+        std::this_thread::sleep_for (std::chrono::milliseconds (100));
+        EXPECT_EQ (b.ready (), 0);
+        EXPECT_EQ (b.take (j.Jobs.begin ()->first, j.Jobs.begin ()->second), nullptr);
+    }
+
+}
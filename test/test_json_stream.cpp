@@ -0,0 +1,87 @@
+#include <json_stream.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+
+namespace BoostPOW {
+
+    bytes test_script (uint32 user_nonce) {
+        return test_bounty_script (.01, user_nonce);
+    }
+
+    const string test_txid {"ffeeddccbbaa99887766554433221100ffeeddccbbaa99887766554433221100"};
+
+    TEST (JSONStreamTest, TestJobs) {
+        JSON body {
+            {"count", 2},
+            {"other", JSON::array ({JSON {{"txid", "00"}}})},
+            {"jobs", JSON::array ({
+                JSON {
+                    {"txid", test_txid}, {"vout", 1}, {"value", 1000},
+                    {"script", encoding::hex::write (test_script (1))},
+                    {"tags", JSON::array ({JSON {{"txid", "00"}}})},
+                    {"difficulty", .01}},
+                JSON {
+                    {"value", 2000}, {"script", encoding::hex::write (test_script (2))},
+                    {"vout", 0}, {"spent", false}, {"txid", test_txid}}})}};
+
+        auto jobs = json_stream::read_jobs (body.dump ());
+        ASSERT_EQ (jobs.size (), 2);
+
+        Bitcoin::txid txid {string {"0x"} + test_txid};
+        EXPECT_EQ (jobs[0].outpoint (), (Bitcoin::outpoint {txid, 1}));
+        EXPECT_EQ (jobs[0].value (), 1000);
+        EXPECT_EQ (jobs[0].script (), test_script (1));
+        EXPECT_EQ (jobs[1].outpoint (), (Bitcoin::outpoint {txid, 0}));
+        EXPECT_EQ (jobs[1].value (), 2000);
+        EXPECT_EQ (jobs[1].script (), test_script (2));
+
+        EXPECT_EQ (json_stream::read_jobs (R"({"jobs": []})").size (), 0);
+    }
+
+    TEST (JSONStreamTest, TestUnspent) {
+        JSON body = JSON::array ({
+            JSON {{"height", 800000}, {"tx_pos", 2}, {"tx_hash", test_txid}, {"value", 1234}},
+            JSON {{"tx_hash", test_txid}, {"value", 5}, {"tx_pos", 0}, {"height", 0}}});
+
+        auto utxos = json_stream::read_unspent (body.dump ());
+        ASSERT_EQ (utxos.size (), 2);
+
+        // the same as reading every entry as a JSON document.
+        for (size_t i = 0; i < utxos.size (); i++) EXPECT_EQ (utxos[i], UTXO {body[i]});
+
+        EXPECT_EQ (json_stream::read_unspent ("[]").size (), 0);
+    }
+
+    TEST (JSONStreamTest, TestInvalid) {
+        string script = encoding::hex::write (test_script (1));
+
+        std::vector<string> jobs {
+            "",
+            "{\"jobs\": [",
+            "{\"jobs\": {}}",
+            "{\"count\": 0}",
+            "[]",
+            // missing field.
+            R"({"jobs": [{"txid": ")" + test_txid + R"(", "vout": 0, "script": ")" + script + R"("}]})",
+            // wrong type.
+            R"({"jobs": [{"txid": ")" + test_txid + R"(", "vout": "0", "value": 1, "script": ")" + script + R"("}]})",
+            // not hex.
+            R"({"jobs": [{"txid": ")" + test_txid + R"(", "vout": 0, "value": 1, "script": "zz"}]})",
+            // not a boost script.
+            R"({"jobs": [{"txid": ")" + test_txid + R"(", "vout": 0, "value": 1, "script": "76a914"}]})",
+            // bad txid.
+            R"({"jobs": [{"txid": "1234", "vout": 0, "value": 1, "script": ")" + script + R"("}]})"};
+
+        for (const string &body : jobs) EXPECT_THROW (json_stream::read_jobs (body), data::exception) << body;
+
+        std::vector<string> unspent {
+            "",
+            "{}",
+            "[{\"tx_hash\": ",
+            R"([{"tx_hash": ")" + test_txid + R"(", "tx_pos": 0, "height": 1}])",
+            R"([{"tx_hash": ")" + test_txid + R"(", "tx_pos": 0, "value": 0, "height": 1}])"};
+
+        for (const string &body : unspent) EXPECT_THROW (json_stream::read_unspent (body), data::exception) << body;
+    }
+
+}
@@ -0,0 +1,111 @@
+#include <logger.hpp>
+#include "gtest/gtest.h"
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace logger {
+
+    // everything written while f runs.
+    std::string capture (std::function<void ()> f) {
+        std::stringstream out;
+        set_output (out);
+        f ();
+        flush ();
+        set_output (std::cout);
+        return out.str ();
+    }
+
+    std::vector<json> lines (const std::string &x) {
+        std::vector<json> events {};
+        std::stringstream ss {x};
+        std::string line;
+        while (std::getline (ss, line)) events.push_back (json::parse (line));
+        return events;
+    }
+
+    size_t count (const std::vector<json> &events, const std::string &event) {
+        size_t n = 0;
+        for (const json &j : events) if (j["event"] == event) n++;
+        return n;
+    }
+
+    TEST (LoggerTest, TestLevel) {
+        auto events = lines (capture ([] () {
+            set_level (warning);
+            log (debug, "test.level.debug", json {{"n", 1}});
+            log (info, "test.level.info", json {{"n", 2}});
+            log (warning, "test.level.warning", json {{"n", 3}});
+            log (error, "test.level.error", json {{"n", 4}});
+            set_level (info);
+            log (info, "test.level.info", json {{"n", 5}});
+        }));
+
+        EXPECT_EQ (count (events, "test.level.debug"), 0);
+        EXPECT_EQ (count (events, "test.level.info"), 1);
+        EXPECT_EQ (count (events, "test.level.warning"), 1);
+        EXPECT_EQ (count (events, "test.level.error"), 1);
+
+        for (const json &j : events) if (j["event"] == "test.level.warning") {
+            EXPECT_EQ (j["level"], "warning");
+            EXPECT_EQ (j["message"]["n"], 3);
+        }
+
+        EXPECT_EQ (read_level ("warning"), warning);
+        EXPECT_THROW (read_level ("loud"), std::invalid_argument);
+    }
+
+    TEST (LoggerTest, TestLimit) {
+        // all of these are in the same second.
+        limit ("test.limit", 5);
+        auto events = lines (capture ([] () {
+            for (int i = 0; i < 20; i++) log ("test.limit", json {{"i", i}});
+            log ("test.unlimited", json::object ());
+        }));
+
+        EXPECT_EQ (count (events, "test.limit"), 5);
+        EXPECT_EQ (count (events, "test.unlimited"), 1);
+
+        // the first ones are kept.
+        int i = 0;
+        for (const json &j : events) if (j["event"] == "test.limit") EXPECT_EQ (j["message"]["i"], i++);
+    }
+
+    TEST (LoggerTest, TestSample) {
+        sample ("test.sample", 4);
+        auto events = lines (capture ([] () {
+            for (int i = 0; i < 20; i++) log ("test.sample", json {{"i", i}});
+        }));
+
+        ASSERT_EQ (count (events, "test.sample"), 5);
+
+        int i = 0;
+        for (const json &j : events) if (j["event"] == "test.sample") {
+            EXPECT_EQ (j["message"]["i"], i);
+            i += 4;
+        }
+    }
+
+    TEST (LoggerTest, TestBinary) {
+        std::string out = capture ([] () {
+            set_format (format::binary);
+            log (warning, "test.binary", json {{"x", "y"}});
+            flush ();
+            set_format (format::JSON);
+        });
+
+        // a little-endian length and then CBOR.
+        ASSERT_GE (out.size (), 4);
+        uint32_t size = 0;
+        for (int i = 0; i < 4; i++) size |= uint32_t (uint8_t (out[i])) << (8 * i);
+        ASSERT_EQ (out.size (), 4 + size);
+
+        json j = json::from_cbor (std::vector<uint8_t> (out.begin () + 4, out.end ()));
+        EXPECT_EQ (j["event"], "test.binary");
+        EXPECT_EQ (j["level"], int (warning));
+        EXPECT_EQ (j["message"]["x"], "y");
+    }
+
+}
@@ -24,6 +24,14 @@ namespace BoostPOW {
         return 0;
     }
 
+    int worker (const worker_options &) {
+        return 0;
+    }
+
+    int tune (const tuning_options &) {
+        return 0;
+    }
+
     struct test_case {
         bool ExpectValid;
         stack<string> Input;
@@ -37,7 +45,7 @@ namespace BoostPOW {
         }
 
         void run () const {
-            bool valid = BoostPOW::run (argh::parser (ArgCount, ArgValues), help, version, spend, redeem, mine) == 0;
+            bool valid = BoostPOW::run (argh::parser (ArgCount, ArgValues), help, version, spend, redeem, mine, worker, tune) == 0;
             EXPECT_EQ (valid, ExpectValid) << "failure on input " << Input << "; expected " << std::boolalpha << ExpectValid;
         }
     };
@@ -130,6 +138,44 @@ namespace BoostPOW {
             test_case {true,  {"BoostMiner", "redeem", "0x00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff",
                 "0", "--key=KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--threads=1"}},
             test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--threads=1"}},
+            // threads may be chosen by the autotuner.
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--threads=auto"}},
+            test_case {true,  {"BoostMiner", "worker", "localhost:3333", "--threads=auto"}},
+            test_case {true,  {"BoostMiner", "tune"}},
+            test_case {true,  {"BoostMiner", "tune", "--seconds=1", "--tune_cache=tune.json"}},
+            test_case {false, {"BoostMiner", "tune", "--seconds=0"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--affinity=cores"}},
+            test_case {true,  {"BoostMiner", "worker", "localhost:3333", "--affinity=smt"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--affinity=numa"}},
+            // worker id is one number or host.process.
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--worker_id=3.7"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--worker_id=4294967295"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--worker_id=65536.0"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--worker_id=4294967296"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--worker_id=rig"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--control=/tmp/boostminer.sock"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--warm_start=/tmp/boostminer.state"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--duty_cycle=0.25"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--duty_cycle=1"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--duty_cycle=0"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--duty_cycle=2"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--api_host=pow.co,mirror.pow.co"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--api_host=,"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--record=/tmp/boostminer.traffic"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--replay=/tmp/boostminer.traffic", "--replay_speed=0"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--record=a", "--replay=b"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--replay=b", "--replay_speed=-1"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--publish_jobs=boostminer"}},
+            test_case {true,  {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--job_board=boostminer"}},
+            test_case {false, {"BoostMiner", "mine", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ", "--publish_jobs=a", "--job_board=a"}},
+            // worker needs a Stratum endpoint with a valid port.
+            test_case {true,  {"BoostMiner", "worker", "localhost:3333"}},
+            test_case {true,  {"BoostMiner", "worker", "--stratum=127.0.0.1:3333", "--name=rig1", "--threads=4"}},
+            test_case {false, {"BoostMiner", "worker"}},
+            test_case {false, {"BoostMiner", "worker", "localhost"}},
+            test_case {false, {"BoostMiner", "worker", "localhost:0"}},
+            test_case {false, {"BoostMiner", "worker", "localhost:70000"}},
+            test_case {false, {"BoostMiner", "worker", "localhost:3333", "--threads=0"}},
             // with script and sats
             test_case {true,  {"BoostMiner", "redeem", "0x00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff",
                 "0", "KwFevqMbSXhGxNWuVc6vuERwdXq7aDQtiLNkjPVokF87RsGMBYqZ",
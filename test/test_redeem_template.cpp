@@ -0,0 +1,86 @@
+#include <redeem_template.hpp>
+#include <miner.hpp>
+#include <gigamonkey/script/pattern/pay_to_address.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+#include <thread>
+
+namespace BoostPOW {
+
+    Boost::puzzle test_puzzle (bool version_2, uint32 outputs) {
+        bytes script = test_bounty_script (.00001, 7, version_2);
+
+        list<Bitcoin::prevout> prevouts {};
+        for (uint32 i = 0; i < outputs; i++) prevouts <<= test_bounty_prevout (script, i);
+
+        return Boost::puzzle {Boost::candidate {prevouts}, test_key};
+    }
+
+    list<Bitcoin::output> test_pay (const Boost::puzzle &p) {
+        return {Bitcoin::output {Bitcoin::satoshi {int64 (p.value ()) - 500}, pay_to_address::script (digest160 {})}};
+    }
+
+    // a template is only any use if it gives the transaction that would have been broadcast without it.
+    TEST (RedeemTemplateTest, TestRedeem) {
+        casual_random r {1};
+        for (bool version_2 : {false, true}) for (uint32 outputs : {1, 3}) {
+            Boost::puzzle p = test_puzzle (version_2, outputs);
+
+            redeem_template t = redeem_template::make (r, p, test_pay (p));
+            ASSERT_TRUE (t.valid ());
+
+            search_partition partition {0, 1};
+            work::proof proof = solve (partition, work::puzzle (p), 60, nullptr);
+            ASSERT_TRUE (proof.valid ());
+
+            bytes expected = bytes (redeem_puzzle (p, proof.Solution, test_pay (p)));
+            ASSERT_NE (expected.size (), 0);
+            EXPECT_EQ (t.redeem (proof.Solution), expected);
+        }
+    }
+
+    TEST (RedeemTemplateTest, TestBuilder) {
+        std::atomic<int> paid {0};
+        template_builder b {[&paid] (const Boost::puzzle &p) -> list<Bitcoin::output> {
+            paid++;
+            return test_pay (p);
+        }, 1};
+
+        Boost::puzzle p = test_puzzle (true, 2);
+        b.prepare (p.id (), p);
+        b.prepare (p.id (), p);
+
+        ptr<const redeem_template> t {};
+        for (int i = 0; i < 500 && t == nullptr; i++) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (10));
+            t = b.get (p.id (), p);
+        }
+
+        ASSERT_NE (t, nullptr);
+        EXPECT_EQ (paid, 1);
+
+        search_partition partition {0, 1};
+        work::proof proof = solve (partition, work::puzzle (p), 60, nullptr);
+        ASSERT_TRUE (proof.valid ());
+        EXPECT_EQ (t->redeem (proof.Solution), bytes (redeem_puzzle (p, proof.Solution, test_pay (p))));
+
+        // a job that gains an output gets a template that replaces the old one.
+        Boost::puzzle q = test_puzzle (true, 3);
+        ASSERT_EQ (q.id (), p.id ());
+        b.prepare (q.id (), q);
+
+        t = nullptr;
+        for (int i = 0; i < 500 && t == nullptr; i++) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (10));
+            t = b.get (q.id (), q);
+        }
+
+        ASSERT_NE (t, nullptr);
+        EXPECT_EQ (paid, 2);
+        EXPECT_EQ (b.get (p.id (), p), nullptr);
+
+        b.remove (q.id ());
+        EXPECT_EQ (b.get (q.id (), q), nullptr);
+    }
+
+}
@@ -0,0 +1,78 @@
+#include <scheduler.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+
+namespace BoostPOW {
+
+    working test_job (double difficulty, int64 value, uint32 user_nonce) {
+        return working {Boost::candidate {{test_bounty_prevout (test_bounty_script (difficulty, user_nonce), user_nonce, value)}}};
+    }
+
+    uint32 total (const std::map<digest256, uint32> &allocation) {
+        uint32 t = 0;
+        for (const auto &a : allocation) t += a.second;
+        return t;
+    }
+
+    TEST (SchedulerTest, TestExpectedRevenue) {
+        market m {};
+        m.ThreadHashrate = 1000000;
+        m.SwitchCost = .5;
+
+        working j = test_job (.001, 10000, 1);
+
+        EXPECT_EQ (expected_revenue (j, 0, m), 0);
+        EXPECT_GT (expected_revenue (j, 1, m), 0);
+
+        // diminishing returns for each additional thread.
+        for (uint32 n = 1; n < 8; n++)
+            EXPECT_LE (expected_revenue (j, n + 1, m) - expected_revenue (j, n, m),
+                expected_revenue (j, n, m) - expected_revenue (j, n - 1, m));
+
+        // a job worth less than the fee is worth nothing.
+        m.FeeRate = 1000;
+        EXPECT_EQ (expected_revenue (j, 1, m), 0);
+    }
+
+    TEST (SchedulerTest, TestExpectedValuePolicy) {
+        casual_random r {1};
+        expected_value_policy policy {};
+
+        market m {};
+        m.ThreadHashrate = 1000000;
+        m.SwitchCost = 0;
+
+        working better = test_job (1, 100000, 1);
+        working worse = test_job (1, 1000, 2);
+
+        std::map<digest256, working> jobs {{better.id (), better}, {worse.id (), worse}};
+
+        // with no cost to switching, everything goes to the most profitable job.
+        auto allocation = policy.allocate (jobs, 8, m, r);
+        EXPECT_EQ (total (allocation), 8);
+        EXPECT_EQ (allocation[better.id ()], 8);
+
+        // a job that is solved very quickly can't use many threads.
+        m.SwitchCost = .5;
+        working easy = test_job (.000466, 100000, 3);
+        auto easy_allocation = policy.allocate ({{easy.id (), easy}}, 8, m, r);
+        EXPECT_GE (easy_allocation[easy.id ()], 1);
+        EXPECT_LE (easy_allocation[easy.id ()], 3);
+
+        // nothing below the minimum profitability.
+        m.MinProfitability = 1000000;
+        EXPECT_EQ (total (policy.allocate (jobs, 8, m, r)), 0);
+    }
+
+    TEST (SchedulerTest, TestRandomPolicy) {
+        casual_random r {1};
+        random_policy policy {};
+
+        working a = test_job (1, 100000, 1);
+        working b = test_job (1, 1000, 2);
+
+        auto allocation = policy.allocate ({{a.id (), a}, {b.id (), b}}, 8, market {}, r);
+        EXPECT_EQ (total (allocation), 8);
+    }
+
+}
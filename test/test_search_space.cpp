@@ -0,0 +1,38 @@
+#include <search_space.hpp>
+#include "gtest/gtest.h"
+#include <set>
+
+namespace BoostPOW {
+
+    TEST (SearchSpaceTest, TestPartitionsAreDisjoint) {
+
+        work::puzzle p {};
+        p.Mask = -1;
+
+        std::set<std::pair<uint32, bytes>> seen {};
+
+        for (uint16 host : {0, 1}) for (uint16 process : {0, 1}) for (uint16 thread : {0, 1, 2}) {
+            // every thread starts at the same counter, which is the worst case.
+            search_partition s {search_partition::worker_id (host, process), thread, 1000};
+
+            for (int i = 0; i < 5; i++) {
+                work::solution x = s.next (p);
+                EXPECT_EQ (uint32 (x.ExtraNonce1), search_partition::worker_id (host, process));
+                EXPECT_EQ (x.Share.Nonce, 0);
+                EXPECT_TRUE (seen.insert ({uint32 (x.ExtraNonce1), bytes (x.Share.ExtraNonce2)}).second);
+            }
+
+            EXPECT_EQ (s.claimed (), 5);
+        }
+
+        EXPECT_EQ (seen.size (), 2 * 2 * 3 * 5);
+
+    }
+
+    TEST (SearchSpaceTest, TestWorkerID) {
+        EXPECT_EQ (search_partition::worker_id (0, 0), 0);
+        EXPECT_EQ (search_partition::worker_id (1, 2), 0x00010002);
+        EXPECT_EQ (search_partition::worker_id (0xffff, 0xffff), 0xffffffff);
+    }
+
+}
@@ -0,0 +1,197 @@
+#include <stratum.hpp>
+#include <gigamonkey/schema/hd.hpp>
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+#include "test_fixtures.hpp"
+
+namespace BoostPOW {
+
+    Boost::puzzle test_puzzle (uint32 version) {
+        bytes script = test_bounty_script (.001, 7, version == 2, bytes {1, 2, 3}, bytes {4, 5, 6});
+
+        digest512 bits = SHA2_512 (string {"stratum test"});
+        secp256k1::secret secret;
+        HD::chain_code chain_code (32);
+        std::copy (bits.begin (), bits.begin () + 32, secret.Value.begin ());
+        std::copy (bits.begin () + 32, bits.end (), chain_code.begin ());
+
+        return Boost::puzzle {Boost::candidate {{test_bounty_prevout (script, 0)}},
+            Bitcoin::secret (HD::BIP_32::secret {secret, chain_code, HD::BIP_32::main})};
+    }
+
+    work::solution test_solution (bool bits) {
+        uint64_big extra_nonce_2 {0x0102030405060708};
+        work::solution x {Bitcoin::timestamp {1650000000}, 12345, bytes_view (extra_nonce_2), Stratum::session_id {0xdeadbeef}};
+        if (bits) x.Share.Bits = 0x1234;
+        return x;
+    }
+
+    TEST (StratumTest, TestNotify) {
+        for (uint32 version : {1, 2}) {
+            work::puzzle p (test_puzzle (version));
+
+            JSON params = stratum::notify ("0000002a", p, Bitcoin::timestamp {1650000000}, true);
+            auto job = stratum::read_notify (JSON::parse (params.dump ()));
+
+            ASSERT_TRUE (bool (job));
+            EXPECT_EQ (job->ID, "0000002a");
+            EXPECT_TRUE (job->Clean);
+
+            // the worker must hash exactly what the server would.
+            work::solution x = test_solution (version == 2);
+            EXPECT_EQ (work::proof (p, x).string ().hash (), work::proof (job->Puzzle, x).string ().hash ());
+        }
+
+        EXPECT_FALSE (bool (stratum::read_notify (JSON::array ({"0000002a", "00", "", "", JSON::array (), "", "", "", true, ""}))));
+        EXPECT_FALSE (bool (stratum::read_notify (JSON::object ())));
+    }
+
+    TEST (StratumTest, TestSubmit) {
+        for (bool bits : {false, true}) {
+            work::solution x = test_solution (bits);
+
+            auto share = stratum::read_submit (JSON::parse (stratum::submit ("worker", "0000002a", x).dump ()), x.ExtraNonce1);
+
+            ASSERT_TRUE (bool (share));
+            EXPECT_EQ (share->Worker, "worker");
+            EXPECT_EQ (share->JobID, "0000002a");
+            EXPECT_EQ (share->Solution, x);
+        }
+
+        // extra nonce 2 has the wrong size.
+        EXPECT_FALSE (bool (stratum::read_submit (JSON::array ({"worker", "0000002a", "0102", "00000000", "00000000"}),
+            Stratum::session_id {1})));
+    }
+
+    TEST (StratumTest, TestShareTarget) {
+        work::puzzle p (test_puzzle (2));
+        uint256 target = p.Candidate.Target.expand ();
+
+        EXPECT_EQ (stratum::share_target (p, 0), target);
+        EXPECT_EQ (stratum::share_target (p, 1), target);
+        EXPECT_TRUE (target < stratum::share_target (p, .00001));
+
+        EXPECT_EQ (stratum::read_set_difficulty (JSON::parse (stratum::set_difficulty (.25).dump ())), maybe<double> {.25});
+        EXPECT_FALSE (bool (stratum::read_set_difficulty (JSON::array ({0}))));
+        EXPECT_FALSE (bool (stratum::read_set_difficulty (JSON::array ({"1"}))));
+        EXPECT_FALSE (bool (stratum::read_set_difficulty (JSON::array ())));
+    }
+
+    // a client that speaks Stratum one line at a time.
+    struct test_client {
+        net::asio::ip::tcp::socket Socket;
+        net::asio::streambuf Buffer;
+
+        test_client (net::asio::io_context &io, uint16 port) : Socket {io}, Buffer {} {
+            Socket.connect (net::asio::ip::tcp::endpoint {net::asio::ip::make_address ("127.0.0.1"), port});
+        }
+
+        JSON call (const JSON &request) {
+            net::asio::write (Socket, net::asio::buffer (request.dump () + "\n"));
+            net::asio::read_until (Socket, Buffer, '\n');
+
+            std::istream in {&Buffer};
+            string line;
+            std::getline (in, line);
+            return JSON::parse (line);
+        }
+    };
+
+    template <typename f> bool wait_until (f done, double seconds) {
+        auto end = std::chrono::steady_clock::now () + std::chrono::duration<double> (seconds);
+        while (!done ()) {
+            if (std::chrono::steady_clock::now () > end) return false;
+            std::this_thread::sleep_for (std::chrono::milliseconds {10});
+        }
+
+        return true;
+    }
+
+    TEST (StratumTest, TestLoopback) {
+        // broadcasts are skipped while a recording is played back.
+        network Net {};
+        Net.Player = std::make_shared<traffic::player> (std::vector<traffic::exchange> {}, 0);
+        Net.Pool->replay (Net.Player);
+
+        given_fees fees {.5};
+        map_key_database keys {std::static_pointer_cast<key_source> (std::make_shared<single_key_source> (test_key))};
+        single_address_source addresses {test_key.address ()};
+        auto m = std::make_shared<manager> (Net, fees, keys, addresses, 1, -1, 0, 0);
+
+        auto threads = [m] () -> uint64 {
+            return m->status ()["threads"];
+        };
+
+        net::asio::io_context io {};
+        auto server = std::make_shared<stratum_server> (m, io, 0, 1, .00002);
+        server->start ();
+        std::thread serving {[&io] () {
+            io.run ();
+        }};
+
+        uint16 port = server->port ();
+
+        {
+            net::asio::io_context client_io {};
+            test_client a {client_io, port};
+            test_client b {client_io, port};
+
+            JSON subscribed_a = a.call (stratum::request (1, "mining.subscribe", JSON::array ({"test"})));
+            JSON subscribed_b = b.call (stratum::request (1, "mining.subscribe", JSON::array ({"test"})));
+            ASSERT_TRUE (subscribed_a["result"].is_array ());
+            ASSERT_TRUE (subscribed_b["result"].is_array ());
+            EXPECT_NE (subscribed_a["result"][1], subscribed_b["result"][1]);
+
+            EXPECT_EQ (a.call (stratum::request (2, "mining.authorize", JSON::array ({"a", ""})))["result"], true);
+            EXPECT_EQ (b.call (stratum::request (2, "mining.authorize", JSON::array ({"b", ""})))["result"], true);
+
+            // there are no jobs yet.
+            JSON rejected = a.call (stratum::request (3, "mining.submit", stratum::submit ("a", "00000000", test_solution (false))));
+            EXPECT_TRUE (rejected["result"].is_null ());
+            EXPECT_FALSE (rejected["error"].is_null ());
+        }
+
+        EXPECT_TRUE (wait_until ([&threads] () {
+            return threads () == 0;
+        }, 10));
+
+        stratum_worker first {1};
+        stratum_worker second {1};
+        std::thread running_first {[&first, port] () {
+            first.run ("127.0.0.1", port, "first");
+        }};
+        std::thread running_second {[&second, port] () {
+            second.run ("127.0.0.1", port, "second");
+        }};
+
+        EXPECT_TRUE (wait_until ([&threads] () {
+            return threads () == 2;
+        }, 10));
+
+        // every share below the puzzle's difficulty is counted, and only the one that
+        // solves the puzzle is redeemed.
+        BoostPOW::jobs j {};
+        j.add_prevout (test_bounty_prevout (test_bounty_script (.0005, 1), 0, 100000));
+        m->update_jobs (j);
+
+        EXPECT_TRUE (wait_until ([m] () {
+            return m->status ()["jobs"] == 0;
+        }, 60));
+
+        EXPECT_GT (server->shares (), 1);
+
+        first.stop ();
+        second.stop ();
+        running_first.join ();
+        running_second.join ();
+
+        EXPECT_TRUE (wait_until ([&threads] () {
+            return threads () == 0;
+        }, 10));
+
+        io.stop ();
+        serving.join ();
+    }
+
+}
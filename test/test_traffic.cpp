@@ -0,0 +1,118 @@
+#include <traffic.hpp>
+#include "gtest/gtest.h"
+#include <filesystem>
+
+namespace BoostPOW {
+
+    traffic::exchange test_exchange (double time, const string &url, uint32 status, const string &body) {
+        traffic::exchange x {};
+        x.Kind = traffic::exchange::http;
+        x.Time = time;
+        x.Duration = .25;
+        x.Method = "GET";
+        x.URL = url;
+        x.Status = status;
+        x.Body = body;
+        return x;
+    }
+
+    bytes test_recording (const std::vector<traffic::exchange> &xx) {
+        bytes b = traffic::write_header ();
+        for (const auto &x : xx) {
+            bytes w = traffic::write (x);
+            b.insert (b.end (), w.begin (), w.end ());
+        }
+        return b;
+    }
+
+    TEST (TrafficTest, TestRoundTrip) {
+        traffic::exchange message {};
+        message.Kind = traffic::exchange::websocket;
+        message.Time = 12.5;
+        message.Body = R"({"type":"boostpow.job.created"})";
+
+        traffic::exchange failed = test_exchange (3, "https://pow.co/api/v1/boost/jobs", 0, "");
+        failed.Error = "connection reset";
+
+        std::vector<traffic::exchange> xx {
+            test_exchange (0, "https://pow.co/api/v1/boost/jobs?limit=300", 200, "[]"),
+            failed, message};
+
+        bytes b = test_recording (xx);
+        EXPECT_EQ (traffic::read (b.data (), b.size ()), xx);
+
+        // a recording that was cut off gives whatever was complete.
+        for (size_t cut = 1; cut < 20; cut++) {
+            auto read = traffic::read (b.data (), b.size () - cut);
+            EXPECT_EQ (read.size (), 2);
+            EXPECT_EQ (read[0], xx[0]);
+        }
+
+        bytes wrong = b;
+        wrong[0] = 'X';
+        EXPECT_THROW (traffic::read (wrong.data (), wrong.size ()), std::exception);
+    }
+
+    TEST (TrafficTest, TestReplay) {
+        net::HTTP::REST api {"https", "pow.co"};
+        auto jobs = api.GET ("/api/v1/boost/jobs");
+        auto other = api.GET ("/api/v1/boost/other");
+
+        std::stringstream url;
+        url << jobs.URL;
+
+        traffic::exchange message {};
+        message.Kind = traffic::exchange::websocket;
+        message.Time = 10;
+        message.Body = "hello";
+
+        traffic::player p {{
+            test_exchange (0, url.str (), 200, "first"),
+            test_exchange (1, url.str (), 500, "second"),
+            message}, 0};
+
+        EXPECT_EQ (p.messages ().size (), 1);
+        EXPECT_EQ (p.when (p.messages ()[0]).count (), 0);
+
+        // responses come in the order they were recorded and the last one repeats.
+        auto r = p (jobs);
+        EXPECT_EQ (r.Status, net::HTTP::status::ok);
+        EXPECT_EQ (r.Body, "first");
+        EXPECT_EQ (p (jobs).Body, "second");
+        EXPECT_EQ (p (jobs).Body, "second");
+
+        EXPECT_THROW (p (other), std::exception);
+
+        traffic::player fast {{message}, 4};
+        EXPECT_EQ (fast.when (fast.messages ()[0]).count (), 2.5);
+    }
+
+    TEST (TrafficTest, TestRecordToFile) {
+        auto path = std::filesystem::temp_directory_path () / "boostminer_test.traffic";
+        net::HTTP::REST api {"https", "pow.co"};
+        auto jobs = api.GET ("/api/v1/boost/jobs");
+
+        {
+            traffic::recorder r {path};
+            auto begin = std::chrono::steady_clock::now ();
+
+            net::HTTP::response res {};
+            res.Status = net::HTTP::status::ok;
+            res.Body = "[]";
+
+            r.http (jobs, res, begin, begin + std::chrono::milliseconds (100));
+            r.http_failed (jobs, "timeout", begin, begin + std::chrono::milliseconds (200));
+            r.websocket ("hello");
+            EXPECT_EQ (r.count (), 3);
+        }
+
+        traffic::player p {path, 0};
+        EXPECT_EQ (p.messages ().size (), 1);
+        EXPECT_EQ (p.messages ()[0].Body, "hello");
+        EXPECT_EQ (p (jobs).Body, "[]");
+        EXPECT_THROW (p (jobs), std::exception);
+
+        std::filesystem::remove (path);
+    }
+
+}
@@ -0,0 +1,61 @@
+#include <warm_start.hpp>
+#include "gtest/gtest.h"
+#include "test_fixtures.hpp"
+
+namespace BoostPOW {
+
+    Bitcoin::prevout test_prevout (double difficulty, int64 value, uint32 user_nonce, uint32 index) {
+        return test_bounty_prevout (test_bounty_script (difficulty, user_nonce), index, value);
+    }
+
+    TEST (WarmStartTest, TestRoundTrip) {
+        warm_start::state s {};
+        s.Saved = 1700000000;
+        s.FeeRate = .05;
+        s.KeysDrawn = 17;
+        s.Jobs.add_prevout (test_prevout (.001, 10000, 1, 0));
+        // two outputs with the same script are one job.
+        s.Jobs.add_prevout (test_prevout (.001, 20000, 1, 1));
+        s.Jobs.add_prevout (test_prevout (.01, 5000, 2, 2));
+
+        bytes b = warm_start::write (s);
+        auto r = warm_start::read (b.data (), b.size ());
+        ASSERT_TRUE (bool (r));
+
+        EXPECT_EQ (r->Saved, s.Saved);
+        EXPECT_EQ (r->FeeRate, s.FeeRate);
+        EXPECT_EQ (r->KeysDrawn, s.KeysDrawn);
+        EXPECT_EQ (r->Jobs.Jobs.size (), 2);
+        EXPECT_EQ (r->Jobs.Scripts, s.Jobs.Scripts);
+
+        for (const auto &[id, job] : s.Jobs.Jobs) {
+            auto x = r->Jobs.Jobs.find (id);
+            ASSERT_NE (x, r->Jobs.Jobs.end ());
+            EXPECT_EQ (x->second.Script, job.Script);
+            EXPECT_EQ (x->second.value (), job.value ());
+            EXPECT_EQ (data::size (x->second.Prevouts), data::size (job.Prevouts));
+        }
+    }
+
+    TEST (WarmStartTest, TestInvalid) {
+        warm_start::state s {};
+        s.Jobs.add_prevout (test_prevout (.001, 10000, 1, 0));
+        bytes b = warm_start::write (s);
+
+        // every truncation fails.
+        for (size_t size = 0; size < b.size (); size++) EXPECT_FALSE (bool (warm_start::read (b.data (), size)));
+
+        bytes extra = b;
+        extra.push_back (0);
+        EXPECT_FALSE (bool (warm_start::read (extra.data (), extra.size ())));
+
+        bytes wrong_magic = b;
+        wrong_magic[0] = 'X';
+        EXPECT_FALSE (bool (warm_start::read (wrong_magic.data (), wrong_magic.size ())));
+
+        bytes wrong_version = b;
+        wrong_version[4] = 2;
+        EXPECT_FALSE (bool (warm_start::read (wrong_version.data (), wrong_version.size ())));
+    }
+
+}